@@ -2,16 +2,137 @@
 #define SHL_STRIP_PREFIX
 #include "./build.h"
 
+#include <sys/wait.h>
+
 Cmd cmd = {0};
 
-int main() {
+// `./build test` also runs every examples/NAME.fu that has an expected
+// examples/NAME.out under each engine, and once more unoptimized. The
+// expected file holds the program's stdout followed by a line with its exit
+// status; stderr is not compared, as the engines trace errors differently.
+// A first line "// args: ..." in the program passes extra arguments to
+// fulani. The examples listed in `compiled` are also built with --build and
+// the binary is checked the same way.
+static const char* engines[] = {"", "--vm", "--no-jit", "-O0"};
+static const char* compiled[] = {"deep_recursion.fu", "tail_calls.fu"};
+
+static char* read_text(const char* path) {
+    FILE* file = fopen(path, "rb");
+    if (file == NULL) return NULL;
+
+    size_t length = 0;
+    size_t capacity = 4096;
+    char* text = malloc(capacity);
+    size_t read;
+    while ((read = fread(text + length, 1, capacity - length - 1, file)) > 0) {
+        length += read;
+        if (capacity - length == 1) text = realloc(text, capacity *= 2);
+    }
+    text[length] = '\0';
+    fclose(file);
+    return text;
+}
+
+static bool is_compiled(const char* name) {
+    for (size_t i = 0; i < sizeof(compiled) / sizeof(compiled[0]); i++) {
+        if (strcmp(compiled[i], name) == 0) return true;
+    }
+    return false;
+}
+
+static char* run_example(const char* path, const char* engine) {
+    char args[256] = "";
+    FILE* source = fopen(path, "r");
+    if (source != NULL) {
+        char line[256];
+        if (fgets(line, sizeof(line), source) != NULL && strncmp(line, "// args:", 8) == 0) {
+            line[strcspn(line, "\n")] = '\0';
+            snprintf(args, sizeof(args), "%s", line + 8);
+        }
+        fclose(source);
+    }
+
+    char command[1024];
+    if (strcmp(engine, "--build") == 0) {
+        // A failed build leaves nothing to run and shows up as its exit status
+        const char* binary = "/tmp/fulani-example";
+        snprintf(command, sizeof(command), "rm -f %s && ./fulani --build %s %s -o %s >/dev/null 2>&1 && %s 2>/dev/null",
+                 binary, args, path, binary, binary);
+    } else {
+        snprintf(command, sizeof(command), "./fulani %s %s %s 2>/dev/null", engine, args, path);
+    }
+    FILE* pipe = popen(command, "r");
+    if (pipe == NULL) return NULL;
+
+    size_t length = 0;
+    size_t capacity = 4096;
+    char* output = malloc(capacity);
+    size_t read;
+    while ((read = fread(output + length, 1, capacity - length - 1, pipe)) > 0) {
+        length += read;
+        if (capacity - length < 64) output = realloc(output, capacity *= 2);
+    }
+    int status = pclose(pipe);
+    snprintf(output + length, capacity - length, "exit: %d\n", WIFEXITED(status) ? WEXITSTATUS(status) : -1);
+    return output;
+}
+
+static bool test_examples(void) {
+    DIR* dir = opendir("examples");
+    if (dir == NULL) {
+        error("Could not open examples.\n");
+        return false;
+    }
+
+    int passed = 0;
+    int failed = 0;
+    struct dirent* entry;
+    while ((entry = readdir(dir)) != NULL) {
+        size_t length = strlen(entry->d_name);
+        if (length < 4 || strcmp(entry->d_name + length - 3, ".fu") != 0) continue;
+
+        char path[512];
+        char expected_path[512];
+        snprintf(path, sizeof(path), "examples/%s", entry->d_name);
+        snprintf(expected_path, sizeof(expected_path), "examples/%.*s.out", (int)length - 3, entry->d_name);
+        char* expected = read_text(expected_path);
+        if (expected == NULL) continue;
+
+        size_t engine_count = sizeof(engines) / sizeof(engines[0]);
+        for (size_t i = 0; i <= engine_count; i++) {
+            if (i == engine_count && !is_compiled(entry->d_name)) break;
+            const char* engine = i < engine_count ? engines[i] : "--build";
+            char* output = run_example(path, engine);
+            if (output != NULL && strcmp(output, expected) == 0) {
+                passed++;
+            } else {
+                warn("%s (%s) does not match %s\n", path, engine[0] ? engine : "default", expected_path);
+                failed++;
+            }
+            free(output);
+        }
+        free(expected);
+    }
+    closedir(dir);
+
+    info("%d passed, %d failed\n", passed, failed);
+    return failed == 0;
+}
+
+int main(int argc, char** argv) {
     auto_rebuild("build.c");
 
     push(&cmd, "gcc");
     push(&cmd, "src/fulani.c", "src/lexer.c", "src/parser.c", "src/ast.c", "src/interpreter.c");
-    push(&cmd, "-Wall", "-Wextra", "-std=c11");
-    push(&cmd, "-o", "fulani");
+    push(&cmd, "src/resolver.c", "src/arena.c", "src/pool.c", "src/value.c", "src/module.c");
+    push(&cmd, "src/native.c", "src/output.c", "src/chunk.c", "src/compiler.c", "src/vm.c");
+    push(&cmd, "src/jit.c", "src/emit.c", "src/optimizer.c", "src/checker.c", "src/reduce.c");
+    push(&cmd, "src/sort.c");
+    push(&cmd, "-Wall", "-Wextra", "-std=c11", "-D_DEFAULT_SOURCE");
+    push(&cmd, "-o", "fulani", "-lm", "-pthread");
     if (!run_always(&cmd)) return 1;
 
+    if (argc > 1 && strcmp(argv[1], "test") == 0 && !test_examples()) return 1;
+
     return 0;
 }
@@ -0,0 +1,58 @@
+#include <stdalign.h>
+#include <stdlib.h>
+#include <string.h>
+#include "headers/arena.h"
+
+#define ARENA_BLOCK_SIZE (64 * 1024)
+
+struct ArenaBlock {
+    ArenaBlock* next;
+    size_t used;
+    size_t capacity;
+    alignas(max_align_t) char data[];
+};
+
+static size_t align_up(size_t size) {
+    return (size + alignof(max_align_t) - 1) & ~(alignof(max_align_t) - 1);
+}
+
+void arena_init(Arena* arena) {
+    arena->blocks = NULL;
+}
+
+void* arena_alloc(Arena* arena, size_t size) {
+    size = align_up(size);
+
+    ArenaBlock* block = arena->blocks;
+    if (block == NULL || block->capacity - block->used < size) {
+        // Oversized requests get a block of their own
+        size_t capacity = size > ARENA_BLOCK_SIZE ? size : ARENA_BLOCK_SIZE;
+        block = malloc(sizeof(ArenaBlock) + capacity);
+        block->next = arena->blocks;
+        block->used = 0;
+        block->capacity = capacity;
+        arena->blocks = block;
+    }
+
+    void* memory = block->data + block->used;
+    block->used += size;
+    return memory;
+}
+
+void* arena_copy(Arena* arena, const void* data, size_t size) {
+    if (size == 0) return NULL;
+
+    void* memory = arena_alloc(arena, size);
+    memcpy(memory, data, size);
+    return memory;
+}
+
+void arena_free(Arena* arena) {
+    ArenaBlock* block = arena->blocks;
+    while (block != NULL) {
+        ArenaBlock* next = block->next;
+        free(block);
+        block = next;
+    }
+    arena->blocks = NULL;
+}
@@ -1,7 +1,11 @@
+#include <errno.h>
+#include <limits.h>
 #include <stdlib.h>
 #include <string.h>
 #include <stdio.h>
 #include "headers/ast.h"
+#include "headers/pool.h"
+#include "headers/value.h"
 
 // AST debugging and pretty printing functions
 static void print_indent(int indent) {
@@ -83,7 +87,7 @@ void print_expr(Expr* expr, int indent) {
         }
         case EXPR_LITERAL: {
             print_indent(indent);
-            printf("Literal(%s)\n", expr->as.literal.value->lexeme);
+            printf("Literal(%s)\n", expr->as.literal.value.lexeme);
             break;
         }
         case EXPR_VARIABLE: {
@@ -125,7 +129,9 @@ void print_expr(Expr* expr, int indent) {
         }
         case EXPR_LIST_METHOD: {
             print_indent(indent);
-            printf("ListMethod(%s):\n", expr->as.list_method.method == TOKEN_ADD ? "add" : "remove");
+            printf("ListMethod(%s):\n", expr->as.list_method.method == TOKEN_ADD ? "add" :
+                   expr->as.list_method.method == TOKEN_REMOVE ? "remove" :
+                   expr->as.list_method.method == TOKEN_RESERVE ? "reserve" : "sort");
             print_indent(indent + 1);
             printf("List:\n");
             print_expr(expr->as.list_method.list, indent + 2);
@@ -254,8 +260,8 @@ void print_stmt(Stmt* stmt, int indent) {
     }
 }
 
-void print_ast(Stmt** statements, int count) {
-    printf("\n===== AST DUMP =====\n\n");
+void print_ast(Stmt** statements, int count, const char* title) {
+    printf("\n===== %s =====\n\n", title);
     for (int i = 0; i < count; i++) {
         printf("Statement %d:\n", i);
         print_stmt(statements[i], 1);
@@ -264,108 +270,253 @@ void print_ast(Stmt** statements, int count) {
     printf("===== END AST DUMP =====\n\n");
 }
 
+// Tokens point into the source text, which is freed once parsing is done.
+// Every token the tree keeps gets its lexeme from the constant pool instead.
+static Token keep_token(Token token) {
+    token.lexeme = pool_intern_length(token.lexeme, token.length);
+    return token;
+}
+
+// String literals only need a copy when an escaped quote must be rewritten
+static String* decode_string(Token token) {
+    if (memchr(token.lexeme, '\\', token.length) == NULL) {
+        return pool_string(token.lexeme, token.length);
+    }
+
+    char* text = malloc(token.length + 1);
+    int length = 0;
+    for (int i = 0; i < token.length; i++) {
+        if (token.lexeme[i] == '\\' && i + 1 < token.length && token.lexeme[i + 1] == '"') {
+            i++;
+        }
+        text[length++] = token.lexeme[i];
+    }
+    
+    String* string = pool_string(text, length);
+    free(text);
+    return string;
+}
+
+BinaryKind binary_kind(TokenType op, DataType type) {
+    if (type == TYPE_INT || type == TYPE_LONG) {
+        BinaryKind base = type == TYPE_INT ? BINARY_INT_ADD : BINARY_LONG_ADD;
+        switch (op) {
+            case TOKEN_PLUS:          return base;
+            case TOKEN_MINUS:         return base + 1;
+            case TOKEN_MULTIPLY:      return base + 2;
+            case TOKEN_DIVIDE:        return base + 3;
+            case TOKEN_MODULO:        return base + 4;
+            case TOKEN_EQUALS:        return base + 5;
+            case TOKEN_NOT_EQUALS:    return base + 6;
+            case TOKEN_LESS:          return base + 7;
+            case TOKEN_LESS_EQUAL:    return base + 8;
+            case TOKEN_GREATER:       return base + 9;
+            case TOKEN_GREATER_EQUAL: return base + 10;
+            default:                  return BINARY_GENERIC;
+        }
+    }
+    
+    if (type == TYPE_FLOAT || type == TYPE_DOUBLE) {
+        BinaryKind base = type == TYPE_FLOAT ? BINARY_FLOAT_ADD : BINARY_DOUBLE_ADD;
+        switch (op) {
+            case TOKEN_PLUS:          return base;
+            case TOKEN_MINUS:         return base + 1;
+            case TOKEN_MULTIPLY:      return base + 2;
+            case TOKEN_DIVIDE:        return base + 3;
+            case TOKEN_EQUALS:        return base + 4;
+            case TOKEN_NOT_EQUALS:    return base + 5;
+            case TOKEN_LESS:          return base + 6;
+            case TOKEN_LESS_EQUAL:    return base + 7;
+            case TOKEN_GREATER:       return base + 8;
+            case TOKEN_GREATER_EQUAL: return base + 9;
+            default:                  return BINARY_GENERIC;
+        }
+    }
+    
+    return BINARY_GENERIC;
+}
+
+DataType binary_kind_type(BinaryKind kind) {
+    if (kind >= BINARY_DOUBLE_ADD) return TYPE_DOUBLE;
+    if (kind >= BINARY_LONG_ADD) return TYPE_LONG;
+    if (kind >= BINARY_FLOAT_ADD) return TYPE_FLOAT;
+    return TYPE_INT;
+}
+
+int assign_append_operands(AssignExpr* assign, Expr** operands) {
+    // Additions nest to the left, so the variable is at the bottom
+    int count = 0;
+    Expr* expr = assign->value;
+    while (expr->type == EXPR_BINARY && expr->as.binary.operator.type == TOKEN_PLUS) {
+        if (count == APPEND_MAX_OPERANDS) return 0;
+        operands[count++] = expr->as.binary.right;
+        expr = expr->as.binary.left;
+    }
+    if (count == 0 || expr->type != EXPR_VARIABLE || expr->as.variable.name.lexeme != assign->name.lexeme) {
+        return 0;
+    }
+
+    for (int i = 0; i < count / 2; i++) {
+        Expr* swap = operands[i];
+        operands[i] = operands[count - 1 - i];
+        operands[count - 1 - i] = swap;
+    }
+    return count;
+}
+
+// Every expression starts out untyped
+static Expr* new_expr(Arena* arena, ExprType type) {
+    Expr* expr = arena_alloc(arena, sizeof(Expr));
+    expr->type = type;
+    expr->typed = false;
+    return expr;
+}
+
 // Expression creation functions
-Expr* create_binary_expr(Token op, Expr* left, Expr* right) {
-    Expr* expr = (Expr*)malloc(sizeof(Expr));
-    expr->type = EXPR_BINARY;
-    expr->as.binary.operator = op;
+Expr* create_binary_expr(Arena* arena, Token op, Expr* left, Expr* right) {
+    Expr* expr = new_expr(arena, EXPR_BINARY);
+    expr->as.binary.operator = keep_token(op);
     expr->as.binary.left = left;
     expr->as.binary.right = right;
+    expr->as.binary.kind = BINARY_GENERIC;
+    expr->as.binary.deopts = 0;
+    expr->as.binary.checked = false;
     return expr;
 }
 
-Expr* create_unary_expr(Token op, Expr* operand) {
-    Expr* expr = (Expr*)malloc(sizeof(Expr));
-    expr->type = EXPR_UNARY;
-    expr->as.unary.operator = op;
+Expr* create_unary_expr(Arena* arena, Token op, Expr* operand) {
+    Expr* expr = new_expr(arena, EXPR_UNARY);
+    expr->as.unary.operator = keep_token(op);
     expr->as.unary.operand = operand;
     return expr;
 }
 
-Expr* create_literal_expr(Token* value) {
-    Expr* expr = (Expr*)malloc(sizeof(Expr));
-    expr->type = EXPR_LITERAL;
+Expr* create_literal_expr(Arena* arena, Token value) {
+    Expr* expr = new_expr(arena, EXPR_LITERAL);
+    
+    String* string = NULL;
+    if (value.type == TOKEN_STRING_LITERAL) {
+        string = decode_string(value);
+        value.lexeme = string->chars;
+        value.length = string->length;
+    } else {
+        value = keep_token(value);
+    }
     expr->as.literal.value = value;
+    
+    switch (value.type) {
+        case TOKEN_INTEGER_LITERAL: {
+            // Literals past the int range are longs; past the long range
+            // they stay untyped for the parser to report
+            errno = 0;
+            long long number = strtoll(value.lexeme, NULL, 10);
+            if (errno == ERANGE || number > LONG_MAX) {
+                expr->as.literal.type = TYPE_VOID;
+            } else if (number > INT_MAX) {
+                expr->as.literal.type = TYPE_LONG;
+                expr->as.literal.as.long_val = (long)number;
+            } else {
+                expr->as.literal.type = TYPE_INT;
+                expr->as.literal.as.int_val = (int)number;
+            }
+            break;
+        }
+        case TOKEN_FLOAT_LITERAL:
+            expr->as.literal.type = TYPE_FLOAT;
+            expr->as.literal.as.float_val = atof(value.lexeme);
+            break;
+        case TOKEN_STRING_LITERAL:
+            expr->as.literal.type = TYPE_STRING;
+            expr->as.literal.as.string_val = string;
+            break;
+        case TOKEN_BOOL_LITERAL:
+            expr->as.literal.type = TYPE_BOOL;
+            expr->as.literal.as.bool_val = strcmp(value.lexeme, "true") == 0;
+            break;
+        default:
+            expr->as.literal.type = TYPE_VOID;
+            break;
+    }
     return expr;
 }
 
-Expr* create_variable_expr(Token name, DataType type) {
-    Expr* expr = (Expr*)malloc(sizeof(Expr));
-    expr->type = EXPR_VARIABLE;
-    expr->as.variable.name = name;
+Expr* create_variable_expr(Arena* arena, Token name, DataType type) {
+    Expr* expr = new_expr(arena, EXPR_VARIABLE);
+    expr->as.variable.name = keep_token(name);
     expr->as.variable.type = type;
+    expr->as.variable.depth = -1;
+    expr->as.variable.slot = -1;
     return expr;
 }
 
-Expr* create_call_expr(Expr* callee, Expr** arguments, int arg_count) {
-    Expr* expr = (Expr*)malloc(sizeof(Expr));
-    expr->type = EXPR_CALL;
+Expr* create_call_expr(Arena* arena, Expr* callee, Expr** arguments, int arg_count) {
+    Expr* expr = new_expr(arena, EXPR_CALL);
     expr->as.call.callee = callee;
     expr->as.call.arguments = arguments;
     expr->as.call.arg_count = arg_count;
     return expr;
 }
 
-Expr* create_assign_expr(Token name, Expr* value) {
-    Expr* expr = (Expr*)malloc(sizeof(Expr));
-    expr->type = EXPR_ASSIGN;
-    expr->as.assign.name = name;
+Expr* create_assign_expr(Arena* arena, Token name, Expr* value) {
+    Expr* expr = new_expr(arena, EXPR_ASSIGN);
+    expr->as.assign.name = keep_token(name);
     expr->as.assign.value = value;
+    expr->as.assign.depth = -1;
+    expr->as.assign.slot = -1;
     return expr;
 }
 
-Expr* create_list_access_expr(Expr* list, Expr* index) {
-    Expr* expr = (Expr*)malloc(sizeof(Expr));
-    expr->type = EXPR_LIST_ACCESS;
+Expr* create_list_access_expr(Arena* arena, Expr* list, Expr* index) {
+    Expr* expr = new_expr(arena, EXPR_LIST_ACCESS);
     expr->as.list_access.list = list;
     expr->as.list_access.index = index;
     return expr;
 }
 
-Expr* create_list_method_expr(Expr* list, TokenType method, Expr* argument) {
-    Expr* expr = (Expr*)malloc(sizeof(Expr));
-    expr->type = EXPR_LIST_METHOD;
+Expr* create_list_method_expr(Arena* arena, Expr* list, TokenType method, Expr* argument) {
+    Expr* expr = new_expr(arena, EXPR_LIST_METHOD);
     expr->as.list_method.list = list;
     expr->as.list_method.method = method;
     expr->as.list_method.argument = argument;
     return expr;
 }
 
-Expr* create_list_property_expr(Expr* list, TokenType property) {
-    Expr* expr = (Expr*)malloc(sizeof(Expr));
-    expr->type = EXPR_LIST_PROPERTY;
+Expr* create_list_property_expr(Arena* arena, Expr* list, TokenType property) {
+    Expr* expr = new_expr(arena, EXPR_LIST_PROPERTY);
     expr->as.list_property.list = list;
     expr->as.list_property.property = property;
     return expr;
 }
 
 // Statement creation functions
-Stmt* create_expression_stmt(Expr* expression) {
-    Stmt* stmt = (Stmt*)malloc(sizeof(Stmt));
+Stmt* create_expression_stmt(Arena* arena, Expr* expression) {
+    Stmt* stmt = arena_alloc(arena, sizeof(Stmt));
     stmt->type = STMT_EXPRESSION;
     stmt->as.expression = expression;
     return stmt;
 }
 
-Stmt* create_var_decl_stmt(Token name, DataType type, Expr* initializer) {
-    Stmt* stmt = (Stmt*)malloc(sizeof(Stmt));
+Stmt* create_var_decl_stmt(Arena* arena, Token name, DataType type, Expr* initializer) {
+    Stmt* stmt = arena_alloc(arena, sizeof(Stmt));
     stmt->type = STMT_VAR_DECL;
-    stmt->as.var_decl.name = name;
+    stmt->as.var_decl.name = keep_token(name);
     stmt->as.var_decl.type = type;
     stmt->as.var_decl.initializer = initializer;
+    stmt->as.var_decl.slot = -1;
     return stmt;
 }
 
-Stmt* create_block_stmt(Stmt** statements, int count) {
-    Stmt* stmt = (Stmt*)malloc(sizeof(Stmt));
+Stmt* create_block_stmt(Arena* arena, Stmt** statements, int count) {
+    Stmt* stmt = arena_alloc(arena, sizeof(Stmt));
     stmt->type = STMT_BLOCK;
     stmt->as.block.statements = statements;
     stmt->as.block.count = count;
+    stmt->as.block.scope_size = 0;
     return stmt;
 }
 
-Stmt* create_if_stmt(Expr* condition, Stmt* then_branch, Stmt* else_branch) {
-    Stmt* stmt = (Stmt*)malloc(sizeof(Stmt));
+Stmt* create_if_stmt(Arena* arena, Expr* condition, Stmt* then_branch, Stmt* else_branch) {
+    Stmt* stmt = arena_alloc(arena, sizeof(Stmt));
     stmt->type = STMT_IF;
     stmt->as.if_stmt.condition = condition;
     stmt->as.if_stmt.then_branch = then_branch;
@@ -373,133 +524,54 @@ Stmt* create_if_stmt(Expr* condition, Stmt* then_branch, Stmt* else_branch) {
     return stmt;
 }
 
-Stmt* create_while_stmt(Expr* condition, Stmt* body) {
-    Stmt* stmt = (Stmt*)malloc(sizeof(Stmt));
+Stmt* create_while_stmt(Arena* arena, Expr* condition, Stmt* body) {
+    Stmt* stmt = arena_alloc(arena, sizeof(Stmt));
     stmt->type = STMT_WHILE;
     stmt->as.while_stmt.condition = condition;
     stmt->as.while_stmt.body = body;
     return stmt;
 }
 
-Stmt* create_return_stmt(Expr* expression) {
-    Stmt* stmt = (Stmt*)malloc(sizeof(Stmt));
+Stmt* create_return_stmt(Arena* arena, Expr* expression) {
+    Stmt* stmt = arena_alloc(arena, sizeof(Stmt));
     stmt->type = STMT_RETURN;
     stmt->as.return_stmt.expression = expression;
+    stmt->as.return_stmt.tail_call = false;
     return stmt;
 }
 
-Stmt* create_function_stmt(Token name, DataType return_type, Token* params, DataType* param_types, int param_count, Stmt* body) {
-    Stmt* stmt = malloc(sizeof(Stmt));
+Stmt* create_function_stmt(Arena* arena, Token name, DataType return_type, Token* params, DataType* param_types, int param_count, Stmt* body) {
+    Stmt* stmt = arena_alloc(arena, sizeof(Stmt));
     stmt->type = STMT_FUNCTION;
-    stmt->as.function.name = name;
+    stmt->as.function.name = keep_token(name);
     stmt->as.function.return_type = return_type;
+    for (int i = 0; i < param_count; i++) {
+        params[i] = keep_token(params[i]);
+    }
     stmt->as.function.params = params;
     stmt->as.function.param_types = param_types;
     stmt->as.function.param_count = param_count;
     stmt->as.function.body = body;
+    stmt->as.function.scope_size = 0;
+    stmt->as.function.call_count = 0;
+    stmt->as.function.jit = NULL;
     return stmt;
 }
 
-Stmt* create_include_stmt(Token path) {
-    Stmt* stmt = malloc(sizeof(Stmt));
+Stmt* create_include_stmt(Arena* arena, Token path) {
+    Stmt* stmt = arena_alloc(arena, sizeof(Stmt));
     stmt->type = STMT_INCLUDE;
-    stmt->as.include.path = path;
+    stmt->as.include.path = keep_token(path);
     return stmt;
 }
 
-Stmt* create_for_stmt(Stmt* init, Expr* condition, Expr* increment, Stmt* body) {
-    Stmt* stmt = (Stmt*)malloc(sizeof(Stmt));
+Stmt* create_for_stmt(Arena* arena, Stmt* init, Expr* condition, Expr* increment, Stmt* body) {
+    Stmt* stmt = arena_alloc(arena, sizeof(Stmt));
     stmt->type = STMT_FOR;
     stmt->as.for_stmt.init = init;
     stmt->as.for_stmt.condition = condition;
     stmt->as.for_stmt.increment = increment;
     stmt->as.for_stmt.body = body;
+    stmt->as.for_stmt.scope_size = 0;
     return stmt;
 }
-
-// Memory management functions
-void free_expr(Expr* expr) {
-    if (expr == NULL) return;
-    
-    switch (expr->type) {
-        case EXPR_BINARY:
-            free_expr(expr->as.binary.left);
-            free_expr(expr->as.binary.right);
-            break;
-        case EXPR_UNARY:
-            free_expr(expr->as.unary.operand);
-            break;
-        case EXPR_CALL:
-            free_expr(expr->as.call.callee);
-            for (int i = 0; i < expr->as.call.arg_count; i++) {
-                free_expr(expr->as.call.arguments[i]);
-            }
-            free(expr->as.call.arguments);
-            break;
-        case EXPR_ASSIGN:
-            free_expr(expr->as.assign.value);
-            break;
-        case EXPR_LIST_ACCESS:
-            free_expr(expr->as.list_access.list);
-            free_expr(expr->as.list_access.index);
-            break;
-        case EXPR_LIST_METHOD:
-            free_expr(expr->as.list_method.list);
-            free_expr(expr->as.list_method.argument);
-            break;
-        case EXPR_LIST_PROPERTY:
-            free_expr(expr->as.list_property.list);
-            break;
-        default:
-            break;
-    }
-    
-    free(expr);
-}
-
-void free_stmt(Stmt* stmt) {
-    if (stmt == NULL) return;
-    
-    switch (stmt->type) {
-        case STMT_EXPRESSION:
-            free_expr(stmt->as.expression);
-            break;
-        case STMT_INCLUDE:
-            // No dynamic memory to free in include statement
-            break;
-        case STMT_VAR_DECL:
-            free_expr(stmt->as.var_decl.initializer);
-            break;
-        case STMT_BLOCK:
-            for (int i = 0; i < stmt->as.block.count; i++) {
-                free_stmt(stmt->as.block.statements[i]);
-            }
-            free(stmt->as.block.statements);
-            break;
-        case STMT_IF:
-            free_expr(stmt->as.if_stmt.condition);
-            free_stmt(stmt->as.if_stmt.then_branch);
-            free_stmt(stmt->as.if_stmt.else_branch);
-            break;
-        case STMT_WHILE:
-            free_expr(stmt->as.while_stmt.condition);
-            free_stmt(stmt->as.while_stmt.body);
-            break;
-        case STMT_RETURN:
-            free_expr(stmt->as.return_stmt.expression);
-            break;
-        case STMT_FUNCTION:
-            free(stmt->as.function.params);
-            free(stmt->as.function.param_types);
-            free_stmt(stmt->as.function.body);
-            break;
-        case STMT_FOR:
-            free_stmt(stmt->as.for_stmt.init);
-            free_expr(stmt->as.for_stmt.condition);
-            free_expr(stmt->as.for_stmt.increment);
-            free_stmt(stmt->as.for_stmt.body);
-            break;
-    }
-    
-    free(stmt);
-} 
@@ -0,0 +1,560 @@
+#include <stdarg.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "headers/checker.h"
+#include "headers/pool.h"
+#include "headers/value.h"
+
+// Types are only inferred where every engine agrees on them. A local's type
+// is known when all declarations of its name in the function have the same
+// type, so it does not matter which of them an engine resolves a reference
+// to. Globals can be redeclared by included files and stay unknown. A call
+// has its function's return type when every return statement of that
+// function produces exactly that type; the interpreter does not convert
+// returned values. Which functions qualify is settled by checking the
+// program until nothing changes, then once more to report errors.
+
+// How a name is declared in the function being checked
+typedef struct {
+    const char* name;
+    DataType type;
+    bool consistent;     // Every declaration of the name has this type
+} Name;
+
+// A local in scope at the current point of the walk
+typedef struct {
+    const char* name;
+    bool typed;
+    DataType type;
+} Local;
+
+typedef struct {
+    const char* name;
+    FunctionStmt* function;
+    bool unique;         // Declared once, and never as a global variable
+    bool exact;          // Every return produces a value of the return type
+} Function;
+
+typedef struct {
+    Function* functions;
+    int function_count;
+    int function_capacity;
+    const char** globals;    // Variables declared at the top level or in main
+    int global_count;
+    int global_capacity;
+    Name* names;
+    int name_count;
+    int name_capacity;
+    Local* locals;
+    int local_count;
+    int local_capacity;
+    bool in_function;
+    const char* main_name;   // Interned "main"
+    Function* current;       // Function being checked, NULL if it is not tracked
+    bool report;
+    bool had_error;
+    bool changed;
+} Checker;
+
+static Checker checker;
+
+static void check_stmt(Stmt* stmt);
+static void check_expr(Expr* expr);
+
+static void error(int line, const char* format, ...) {
+    if (!checker.report) return;
+
+    va_list args;
+    va_start(args, format);
+    output_error("[line %d] Error: ", line);
+    vfprintf(stderr, format, args);
+    fputs("\n", stderr);
+    va_end(args);
+    checker.had_error = true;
+}
+
+static int expr_line(Expr* expr) {
+    switch (expr->type) {
+        case EXPR_BINARY:        return expr->as.binary.operator.line;
+        case EXPR_UNARY:         return expr->as.unary.operator.line;
+        case EXPR_LITERAL:       return expr->as.literal.value.line;
+        case EXPR_VARIABLE:      return expr->as.variable.name.line;
+        case EXPR_CALL:          return expr_line(expr->as.call.callee);
+        case EXPR_ASSIGN:        return expr->as.assign.name.line;
+        case EXPR_LIST_ACCESS:   return expr_line(expr->as.list_access.list);
+        case EXPR_LIST_METHOD:   return expr_line(expr->as.list_method.list);
+        case EXPR_LIST_PROPERTY: return expr_line(expr->as.list_property.list);
+    }
+    return 0;
+}
+
+static const char* type_name(DataType type) {
+    switch (type) {
+        case TYPE_INT:    return "int";
+        case TYPE_FLOAT:  return "float";
+        case TYPE_STRING: return "string";
+        case TYPE_VOID:   return "void";
+        case TYPE_BOOL:   return "bool";
+        case TYPE_LIST:   return "list";
+        case TYPE_DOUBLE: return "double";
+        case TYPE_LONG:   return "long";
+    }
+    return "unknown";
+}
+
+// The conversions value_coerce makes when a value is stored in a declaration
+// or parameter of another type
+static bool coercible(DataType from, DataType to) {
+    return from == to || (to == TYPE_BOOL && from == TYPE_INT) ||
+           (to == TYPE_LONG && from == TYPE_INT) || (to == TYPE_DOUBLE && from == TYPE_FLOAT);
+}
+
+static bool is_number(DataType type) {
+    return type == TYPE_INT || type == TYPE_LONG || type == TYPE_FLOAT || type == TYPE_DOUBLE;
+}
+
+static void set_type(Expr* expr, DataType type) {
+    expr->typed = true;
+    expr->value_type = type;
+}
+
+static void add_global(const char* name) {
+    if (checker.global_count == checker.global_capacity) {
+        checker.global_capacity = checker.global_capacity < 8 ? 8 : checker.global_capacity * 2;
+        checker.globals = realloc(checker.globals, sizeof(const char*) * checker.global_capacity);
+    }
+    checker.globals[checker.global_count++] = name;
+}
+
+static bool is_global(const char* name) {
+    for (int i = 0; i < checker.global_count; i++) {
+        if (checker.globals[i] == name) return true;
+    }
+    return false;
+}
+
+static Function* find_function(const char* name) {
+    for (int i = 0; i < checker.function_count; i++) {
+        if (checker.functions[i].name == name) return &checker.functions[i];
+    }
+    return NULL;
+}
+
+static void add_function(FunctionStmt* function) {
+    Function* existing = find_function(function->name.lexeme);
+    if (existing != NULL) {
+        existing->unique = false;
+        return;
+    }
+
+    if (checker.function_count == checker.function_capacity) {
+        checker.function_capacity = checker.function_capacity < 8 ? 8 : checker.function_capacity * 2;
+        checker.functions = realloc(checker.functions, sizeof(Function) * checker.function_capacity);
+    }
+    Function* entry = &checker.functions[checker.function_count++];
+    entry->name = function->name.lexeme;
+    entry->function = function;
+    entry->unique = true;
+    entry->exact = true;
+}
+
+// Global variables are the top level's declarations and main's, which runs
+// in the global environment
+static void collect_globals(Stmt* stmt) {
+    if (stmt == NULL) return;
+
+    switch (stmt->type) {
+        case STMT_VAR_DECL:
+            add_global(stmt->as.var_decl.name.lexeme);
+            break;
+        case STMT_BLOCK:
+            for (int i = 0; i < stmt->as.block.count; i++) {
+                collect_globals(stmt->as.block.statements[i]);
+            }
+            break;
+        case STMT_IF:
+            collect_globals(stmt->as.if_stmt.then_branch);
+            collect_globals(stmt->as.if_stmt.else_branch);
+            break;
+        case STMT_WHILE:
+            collect_globals(stmt->as.while_stmt.body);
+            break;
+        case STMT_FOR:
+            collect_globals(stmt->as.for_stmt.init);
+            collect_globals(stmt->as.for_stmt.body);
+            break;
+        case STMT_FUNCTION:
+            add_function(&stmt->as.function);
+            if (stmt->as.function.name.lexeme == checker.main_name) {
+                collect_globals(stmt->as.function.body);
+            }
+            break;
+        default:
+            break;
+    }
+}
+
+static void declare_name(const char* name, DataType type) {
+    for (int i = 0; i < checker.name_count; i++) {
+        if (checker.names[i].name == name) {
+            if (checker.names[i].type != type) checker.names[i].consistent = false;
+            return;
+        }
+    }
+
+    if (checker.name_count == checker.name_capacity) {
+        checker.name_capacity = checker.name_capacity < 8 ? 8 : checker.name_capacity * 2;
+        checker.names = realloc(checker.names, sizeof(Name) * checker.name_capacity);
+    }
+    checker.names[checker.name_count].name = name;
+    checker.names[checker.name_count].type = type;
+    checker.names[checker.name_count].consistent = true;
+    checker.name_count++;
+}
+
+static void collect_names(Stmt* stmt) {
+    if (stmt == NULL) return;
+
+    switch (stmt->type) {
+        case STMT_VAR_DECL:
+            declare_name(stmt->as.var_decl.name.lexeme, stmt->as.var_decl.type);
+            break;
+        case STMT_BLOCK:
+            for (int i = 0; i < stmt->as.block.count; i++) {
+                collect_names(stmt->as.block.statements[i]);
+            }
+            break;
+        case STMT_IF:
+            collect_names(stmt->as.if_stmt.then_branch);
+            collect_names(stmt->as.if_stmt.else_branch);
+            break;
+        case STMT_WHILE:
+            collect_names(stmt->as.while_stmt.body);
+            break;
+        case STMT_FOR:
+            collect_names(stmt->as.for_stmt.init);
+            collect_names(stmt->as.for_stmt.body);
+            break;
+        default:
+            break;
+    }
+}
+
+static void declare_local(const char* name) {
+    if (checker.local_count == checker.local_capacity) {
+        checker.local_capacity = checker.local_capacity < 8 ? 8 : checker.local_capacity * 2;
+        checker.locals = realloc(checker.locals, sizeof(Local) * checker.local_capacity);
+    }
+
+    Local* local = &checker.locals[checker.local_count++];
+    local->name = name;
+    local->typed = false;
+    for (int i = 0; i < checker.name_count; i++) {
+        if (checker.names[i].name == name) {
+            local->typed = checker.names[i].consistent;
+            local->type = checker.names[i].type;
+            break;
+        }
+    }
+}
+
+static Local* find_local(const char* name) {
+    for (int i = checker.local_count - 1; i >= 0; i--) {
+        if (checker.locals[i].name == name) return &checker.locals[i];
+    }
+    return NULL;
+}
+
+static void check_index(Expr* index) {
+    check_expr(index);
+    if (index->typed && index->value_type != TYPE_INT) {
+        error(expr_line(index), "List index must be an integer");
+    }
+}
+
+static void check_binary(Expr* expr) {
+    BinaryExpr* binary = &expr->as.binary;
+    TokenType op = binary->operator.type;
+    binary->kind = BINARY_GENERIC;
+    binary->checked = false;
+
+    // List index assignment
+    if (op == TOKEN_ASSIGN) {
+        check_expr(binary->left->as.list_access.list);
+        check_index(binary->left->as.list_access.index);
+        check_expr(binary->right);
+        if (binary->right->typed) set_type(expr, binary->right->value_type);
+        return;
+    }
+
+    check_expr(binary->left);
+    check_expr(binary->right);
+    Expr* left = binary->left;
+    Expr* right = binary->right;
+    bool comparison = op == TOKEN_EQUALS || op == TOKEN_NOT_EQUALS || op == TOKEN_LESS ||
+                      op == TOKEN_LESS_EQUAL || op == TOKEN_GREATER || op == TOKEN_GREATER_EQUAL;
+
+    if (left->typed && right->typed) {
+        DataType type;
+        if (op == TOKEN_PLUS && left->value_type == TYPE_STRING && right->value_type == TYPE_STRING) {
+            set_type(expr, TYPE_STRING);
+        } else if (!value_common_type(left->value_type, right->value_type, &type)) {
+            error(binary->operator.line, "Operands must be of the same type (%s %s %s)",
+                  type_name(left->value_type), binary->operator.lexeme, type_name(right->value_type));
+        } else if (!value_binary_supported(op, type)) {
+            error(binary->operator.line, "Operator '%s' is not defined for %s values",
+                  binary->operator.lexeme, type_name(type));
+        } else {
+            set_type(expr, comparison ? TYPE_INT : type);
+            // Mixed operands are widened on the generic path
+            if (left->value_type == right->value_type) {
+                binary->kind = binary_kind(op, type);
+                binary->checked = binary->kind != BINARY_GENERIC;
+            }
+        }
+        return;
+    }
+
+    // With one operand known the result type still follows when the
+    // operation succeeds, unless an int or float operand gets widened
+    Expr* known = left->typed ? left : right->typed ? right : NULL;
+    if (comparison) {
+        set_type(expr, TYPE_INT);
+    } else if (known != NULL && (known->value_type == TYPE_LONG || known->value_type == TYPE_DOUBLE ||
+                                 (op == TOKEN_PLUS && known->value_type == TYPE_STRING))) {
+        set_type(expr, known->value_type);
+    }
+}
+
+static void check_call(Expr* expr) {
+    CallExpr* call = &expr->as.call;
+    for (int i = 0; i < call->arg_count; i++) {
+        check_expr(call->arguments[i]);
+    }
+
+    Expr* callee = call->callee;
+    if (callee->type != EXPR_VARIABLE) {
+        check_expr(callee);
+        return;
+    }
+
+    const char* name = callee->as.variable.name.lexeme;
+    Function* function = find_local(name) == NULL ? find_function(name) : NULL;
+    if (function == NULL || !function->unique) return;
+
+    FunctionStmt* declaration = function->function;
+    for (int i = 0; i < call->arg_count && i < declaration->param_count; i++) {
+        Expr* argument = call->arguments[i];
+        if (argument->typed && !coercible(argument->value_type, declaration->param_types[i])) {
+            error(expr_line(argument), "Type mismatch in argument %d of '%s' (%s for %s)", i + 1, name,
+                  type_name(argument->value_type), type_name(declaration->param_types[i]));
+        }
+    }
+    if (function->exact) {
+        set_type(expr, declaration->return_type);
+    }
+}
+
+static void check_expr(Expr* expr) {
+    if (expr == NULL) return;
+    expr->typed = false;
+
+    switch (expr->type) {
+        case EXPR_LITERAL:
+            if (expr->as.literal.type != TYPE_VOID) set_type(expr, expr->as.literal.type);
+            break;
+        case EXPR_VARIABLE: {
+            Local* local = find_local(expr->as.variable.name.lexeme);
+            if (local != NULL && local->typed) set_type(expr, local->type);
+            break;
+        }
+        case EXPR_UNARY: {
+            Expr* operand = expr->as.unary.operand;
+            check_expr(operand);
+            if (!operand->typed) break;
+            if (is_number(operand->value_type)) {
+                set_type(expr, operand->value_type);
+            } else {
+                error(expr->as.unary.operator.line, "Operand of '-' must be a number, not %s",
+                      type_name(operand->value_type));
+            }
+            break;
+        }
+        case EXPR_BINARY:
+            check_binary(expr);
+            break;
+        case EXPR_CALL:
+            check_call(expr);
+            break;
+        case EXPR_ASSIGN: {
+            Expr* value = expr->as.assign.value;
+            check_expr(value);
+            if (!value->typed) break;
+
+            // Assignments do not convert
+            Local* local = find_local(expr->as.assign.name.lexeme);
+            if (local != NULL && local->typed && local->type != value->value_type) {
+                error(expr->as.assign.name.line, "Type mismatch in assignment to '%s' (%s for %s)",
+                      expr->as.assign.name.lexeme, type_name(value->value_type), type_name(local->type));
+            }
+            set_type(expr, value->value_type);
+            break;
+        }
+        case EXPR_LIST_ACCESS:
+            check_expr(expr->as.list_access.list);
+            check_index(expr->as.list_access.index);
+            break;
+        case EXPR_LIST_METHOD:
+            check_expr(expr->as.list_method.list);
+            check_expr(expr->as.list_method.argument);
+            break;
+        case EXPR_LIST_PROPERTY:
+            check_expr(expr->as.list_property.list);
+            set_type(expr, TYPE_INT);
+            break;
+    }
+}
+
+static void check_condition(Expr* condition, const char* what) {
+    check_expr(condition);
+    if (condition->typed && condition->value_type != TYPE_INT && condition->value_type != TYPE_BOOL) {
+        error(expr_line(condition), "%s must be an integer or boolean, not %s", what,
+              type_name(condition->value_type));
+    }
+}
+
+// Statements that may not run leave their locals behind when they end
+static void check_nested(Stmt* stmt) {
+    int local_count = checker.local_count;
+    check_stmt(stmt);
+    checker.local_count = local_count;
+}
+
+static void check_function(FunctionStmt* function) {
+    Checker enclosing = checker;
+    checker.names = NULL;
+    checker.name_count = 0;
+    checker.name_capacity = 0;
+    checker.locals = NULL;
+    checker.local_count = 0;
+    checker.local_capacity = 0;
+    checker.in_function = true;
+    checker.current = find_function(function->name.lexeme);
+    if (checker.current != NULL && checker.current->function != function) checker.current = NULL;
+
+    for (int i = 0; i < function->param_count; i++) {
+        declare_name(function->params[i].lexeme, function->param_types[i]);
+    }
+    collect_names(function->body);
+    for (int i = 0; i < function->param_count; i++) {
+        declare_local(function->params[i].lexeme);
+    }
+    check_stmt(function->body);
+
+    free(checker.names);
+    free(checker.locals);
+    enclosing.had_error = checker.had_error;
+    enclosing.changed = checker.changed;
+    checker = enclosing;
+}
+
+static void check_stmt(Stmt* stmt) {
+    if (stmt == NULL) return;
+
+    switch (stmt->type) {
+        case STMT_EXPRESSION:
+            check_expr(stmt->as.expression);
+            break;
+        case STMT_VAR_DECL: {
+            VarDeclStmt* decl = &stmt->as.var_decl;
+            // The variable is defined before its initializer runs
+            if (checker.in_function) declare_local(decl->name.lexeme);
+
+            Expr* initializer = decl->initializer;
+            check_expr(initializer);
+            if (initializer != NULL && initializer->typed && !coercible(initializer->value_type, decl->type)) {
+                error(decl->name.line, "Type mismatch in variable initialization of '%s' (%s for %s)",
+                      decl->name.lexeme, type_name(initializer->value_type), type_name(decl->type));
+            }
+            break;
+        }
+        case STMT_BLOCK: {
+            int local_count = checker.local_count;
+            for (int i = 0; i < stmt->as.block.count; i++) {
+                check_stmt(stmt->as.block.statements[i]);
+            }
+            checker.local_count = local_count;
+            break;
+        }
+        case STMT_IF:
+            check_condition(stmt->as.if_stmt.condition, "Condition");
+            check_nested(stmt->as.if_stmt.then_branch);
+            check_nested(stmt->as.if_stmt.else_branch);
+            break;
+        case STMT_WHILE:
+            check_condition(stmt->as.while_stmt.condition, "Condition");
+            check_nested(stmt->as.while_stmt.body);
+            break;
+        case STMT_FOR: {
+            int local_count = checker.local_count;
+            check_stmt(stmt->as.for_stmt.init);
+            if (stmt->as.for_stmt.condition != NULL) {
+                check_condition(stmt->as.for_stmt.condition, "For loop condition");
+            }
+            check_nested(stmt->as.for_stmt.body);
+            check_expr(stmt->as.for_stmt.increment);
+            checker.local_count = local_count;
+            break;
+        }
+        case STMT_RETURN: {
+            Expr* value = stmt->as.return_stmt.expression;
+            check_expr(value);
+
+            Function* function = checker.current;
+            if (function == NULL || !function->exact) break;
+            bool exact = value == NULL ? function->function->return_type == TYPE_VOID
+                                       : value->typed && value->value_type == function->function->return_type;
+            if (!exact) {
+                function->exact = false;
+                checker.changed = true;
+            }
+            break;
+        }
+        case STMT_FUNCTION:
+            check_function(&stmt->as.function);
+            break;
+        case STMT_INCLUDE:
+            // Included files are checked when they are loaded
+            break;
+    }
+}
+
+bool check(Stmt** statements, int count) {
+    checker = (Checker){0};
+    checker.main_name = pool_intern("main");
+    for (int i = 0; i < count; i++) {
+        collect_globals(statements[i]);
+    }
+    for (int i = 0; i < checker.function_count; i++) {
+        if (is_global(checker.functions[i].name)) checker.functions[i].unique = false;
+    }
+
+    // Return types only ever become unknown, so this settles
+    do {
+        checker.changed = false;
+        for (int i = 0; i < count; i++) {
+            check_stmt(statements[i]);
+        }
+    } while (checker.changed);
+
+    checker.report = true;
+    for (int i = 0; i < count; i++) {
+        check_stmt(statements[i]);
+    }
+
+    free(checker.functions);
+    free(checker.globals);
+    return !checker.had_error;
+}
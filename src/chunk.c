@@ -0,0 +1,177 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include "headers/chunk.h"
+
+void init_chunk(Chunk* chunk) {
+    chunk->count = 0;
+    chunk->capacity = 0;
+    chunk->code = NULL;
+    chunk->lines = NULL;
+    chunk->constant_count = 0;
+    chunk->constant_capacity = 0;
+    chunk->constants = NULL;
+}
+
+void write_chunk(Chunk* chunk, uint8_t byte, int line) {
+    if (chunk->count == chunk->capacity) {
+        chunk->capacity = chunk->capacity < 8 ? 8 : chunk->capacity * 2;
+        chunk->code = realloc(chunk->code, chunk->capacity);
+        chunk->lines = realloc(chunk->lines, sizeof(int) * chunk->capacity);
+    }
+
+    chunk->code[chunk->count] = byte;
+    chunk->lines[chunk->count] = line;
+    chunk->count++;
+}
+
+int add_constant(Chunk* chunk, Value value) {
+    if (chunk->constant_count == chunk->constant_capacity) {
+        chunk->constant_capacity = chunk->constant_capacity < 8 ? 8 : chunk->constant_capacity * 2;
+        chunk->constants = realloc(chunk->constants, sizeof(Value) * chunk->constant_capacity);
+    }
+
+    chunk->constants[chunk->constant_count] = value;
+    return chunk->constant_count++;
+}
+
+void free_chunk(Chunk* chunk) {
+    for (int i = 0; i < chunk->constant_count; i++) {
+        value_release(&chunk->constants[i]);
+    }
+
+    free(chunk->code);
+    free(chunk->lines);
+    free(chunk->constants);
+    init_chunk(chunk);
+}
+
+// Bytecode debugging functions
+static const char* opcode_name(uint8_t op) {
+    switch (op) {
+        case OP_CONSTANT: return "OP_CONSTANT";
+        case OP_DEFAULT: return "OP_DEFAULT";
+        case OP_POP: return "OP_POP";
+        case OP_GET_LOCAL: return "OP_GET_LOCAL";
+        case OP_SET_LOCAL: return "OP_SET_LOCAL";
+        case OP_DEFINE_LOCAL: return "OP_DEFINE_LOCAL";
+        case OP_GET_GLOBAL: return "OP_GET_GLOBAL";
+        case OP_SET_GLOBAL: return "OP_SET_GLOBAL";
+        case OP_DEFINE_GLOBAL: return "OP_DEFINE_GLOBAL";
+        case OP_ADD: return "OP_ADD";
+        case OP_SUBTRACT: return "OP_SUBTRACT";
+        case OP_MULTIPLY: return "OP_MULTIPLY";
+        case OP_DIVIDE: return "OP_DIVIDE";
+        case OP_MODULO: return "OP_MODULO";
+        case OP_EQUAL: return "OP_EQUAL";
+        case OP_NOT_EQUAL: return "OP_NOT_EQUAL";
+        case OP_LESS: return "OP_LESS";
+        case OP_LESS_EQUAL: return "OP_LESS_EQUAL";
+        case OP_GREATER: return "OP_GREATER";
+        case OP_GREATER_EQUAL: return "OP_GREATER_EQUAL";
+        case OP_NEGATE: return "OP_NEGATE";
+        case OP_JUMP: return "OP_JUMP";
+        case OP_JUMP_IF_FALSE: return "OP_JUMP_IF_FALSE";
+        case OP_LOOP: return "OP_LOOP";
+        case OP_CALL: return "OP_CALL";
+        case OP_TAIL_CALL: return "OP_TAIL_CALL";
+        case OP_RETURN: return "OP_RETURN";
+        case OP_GET_INDEX: return "OP_GET_INDEX";
+        case OP_SET_INDEX: return "OP_SET_INDEX";
+        case OP_LIST_ADD: return "OP_LIST_ADD";
+        case OP_LIST_REMOVE: return "OP_LIST_REMOVE";
+        case OP_LIST_RESERVE: return "OP_LIST_RESERVE";
+        case OP_LIST_SORT: return "OP_LIST_SORT";
+        case OP_LIST_LENGTH: return "OP_LIST_LENGTH";
+        case OP_APPEND: return "OP_APPEND";
+        default: return NULL;
+    }
+}
+
+static uint16_t read_short(Chunk* chunk, int offset) {
+    return (uint16_t)((chunk->code[offset] << 8) | chunk->code[offset + 1]);
+}
+
+int disassemble_instruction(Chunk* chunk, int offset) {
+    printf("%04d ", offset);
+    if (offset > 0 && chunk->lines[offset] == chunk->lines[offset - 1]) {
+        printf("   | ");
+    } else {
+        printf("%4d ", chunk->lines[offset]);
+    }
+
+    uint8_t op = chunk->code[offset];
+    const char* name = opcode_name(op);
+    if (name == NULL) {
+        printf("Unknown opcode %d\n", op);
+        return offset + 1;
+    }
+
+    switch (op) {
+        case OP_CONSTANT: {
+            uint16_t constant = read_short(chunk, offset + 1);
+            printf("%-18s %4d '", name, constant);
+            Value value = chunk->constants[constant];
+            if (value.is_function) {
+                printf("<fn>");
+            } else {
+                // Shares the formatting of print, through a small stdout buffer
+                Output output;
+                output_init(&output, STDOUT_FILENO, 64);
+                print_value(&output, value);
+                output_free(&output);
+            }
+            printf("'\n");
+            return offset + 3;
+        }
+        case OP_DEFAULT:
+        case OP_GET_LOCAL:
+        case OP_SET_LOCAL:
+        case OP_CALL:
+        case OP_TAIL_CALL:
+            printf("%-18s %4d\n", name, chunk->code[offset + 1]);
+            return offset + 2;
+        case OP_DEFINE_LOCAL:
+            printf("%-18s %4d (type %d)\n", name, chunk->code[offset + 1], chunk->code[offset + 2]);
+            return offset + 3;
+        case OP_GET_GLOBAL:
+        case OP_SET_GLOBAL:
+            printf("%-18s %4d\n", name, read_short(chunk, offset + 1));
+            return offset + 3;
+        case OP_DEFINE_GLOBAL:
+            printf("%-18s %4d (type %d)\n", name, read_short(chunk, offset + 1), chunk->code[offset + 3]);
+            return offset + 4;
+        case OP_JUMP:
+        case OP_JUMP_IF_FALSE:
+            printf("%-18s %4d -> %d\n", name, offset, offset + 3 + read_short(chunk, offset + 1));
+            return offset + 3;
+        case OP_LOOP:
+            printf("%-18s %4d -> %d\n", name, offset, offset + 3 - read_short(chunk, offset + 1));
+            return offset + 3;
+        case OP_GET_INDEX:
+        case OP_SET_INDEX:
+        case OP_LIST_ADD:
+        case OP_LIST_REMOVE:
+        case OP_LIST_RESERVE:
+        case OP_LIST_SORT:
+        case OP_LIST_LENGTH:
+            printf("%-18s %s %d\n", name, chunk->code[offset + 1] ? "global" : "local",
+                   read_short(chunk, offset + 2));
+            return offset + 4;
+        case OP_APPEND:
+            printf("%-18s %s %d (%d operands)\n", name, chunk->code[offset + 1] ? "global" : "local",
+                   read_short(chunk, offset + 2), chunk->code[offset + 4]);
+            return offset + 5;
+        default:
+            printf("%s\n", name);
+            return offset + 1;
+    }
+}
+
+void disassemble_chunk(Chunk* chunk, const char* name) {
+    printf("== %s ==\n", name);
+    for (int offset = 0; offset < chunk->count;) {
+        offset = disassemble_instruction(chunk, offset);
+    }
+    printf("\n");
+}
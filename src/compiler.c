@@ -0,0 +1,617 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "headers/compiler.h"
+#include "headers/module.h"
+#include "headers/pool.h"
+
+#define MAX_LOCALS 256
+
+typedef enum {
+    FUNC_SCRIPT,  // Top-level statements
+    FUNC_MAIN,    // main() runs in the global scope, like the tree walker
+    FUNC_USER     // Any other function
+} FunctionKind;
+
+typedef struct {
+    const char* name;
+    int depth;
+} Local;
+
+typedef struct {
+    Function* function;
+    FunctionKind kind;
+    Local locals[MAX_LOCALS];
+    int local_count;
+    int scope_depth;
+} Compiler;
+
+typedef struct {
+    Program* program;
+    Compiler* current;
+    const char* main_name;  // Interned "main"
+    int line;
+    bool had_error;
+} CompileState;
+
+static CompileState state;
+
+static void compile_stmt(Stmt* stmt);
+static void compile_expr(Expr* expr);
+
+static void compile_error(const char* message) {
+    output_error("[line %d] Error: %s\n", state.line, message);
+    state.had_error = true;
+}
+
+static Chunk* current_chunk(void) {
+    return &state.current->function->chunk;
+}
+
+static void emit_byte(uint8_t byte) {
+    write_chunk(current_chunk(), byte, state.line);
+}
+
+static void emit_bytes(uint8_t byte1, uint8_t byte2) {
+    emit_byte(byte1);
+    emit_byte(byte2);
+}
+
+static void emit_short(uint16_t value) {
+    emit_byte((value >> 8) & 0xff);
+    emit_byte(value & 0xff);
+}
+
+static void emit_constant(Value value) {
+    int constant = add_constant(current_chunk(), value);
+    if (constant > UINT16_MAX) {
+        compile_error("Too many constants in one chunk.");
+        return;
+    }
+    emit_byte(OP_CONSTANT);
+    emit_short((uint16_t)constant);
+}
+
+static int emit_jump(uint8_t instruction) {
+    emit_byte(instruction);
+    emit_short(0xffff);
+    return current_chunk()->count - 2;
+}
+
+static void patch_jump(int offset) {
+    // -2 to adjust for the bytecode for the jump offset itself
+    int jump = current_chunk()->count - offset - 2;
+    if (jump > UINT16_MAX) {
+        compile_error("Too much code to jump over.");
+    }
+
+    current_chunk()->code[offset] = (jump >> 8) & 0xff;
+    current_chunk()->code[offset + 1] = jump & 0xff;
+}
+
+static void emit_loop(int loop_start) {
+    emit_byte(OP_LOOP);
+
+    int offset = current_chunk()->count - loop_start + 2;
+    if (offset > UINT16_MAX) compile_error("Loop body too large.");
+    emit_short((uint16_t)offset);
+}
+
+static Function* new_function(const char* name) {
+    Function* function = malloc(sizeof(Function));
+    function->name = name;
+    function->arity = 0;
+    function->param_types = NULL;
+    function->return_type = TYPE_VOID;
+    function->slot_count = 0;
+    function->slot_names = NULL;
+    init_chunk(&function->chunk);
+    function->callable = (Callable){0};
+    function->callable.compiled = function;
+
+    Program* program = state.program;
+    program->functions = realloc(program->functions, sizeof(Function*) * (program->function_count + 1));
+    program->functions[program->function_count++] = function;
+    return function;
+}
+
+static void init_compiler(Compiler* compiler, Function* function, FunctionKind kind) {
+    compiler->function = function;
+    compiler->kind = kind;
+    compiler->local_count = 0;
+    // Script and main declarations at depth 0 live in the global scope
+    compiler->scope_depth = kind == FUNC_USER ? 1 : 0;
+    state.current = compiler;
+}
+
+// Scopes and variable resolution
+
+static void begin_scope(void) {
+    state.current->scope_depth++;
+}
+
+static void end_scope(void) {
+    Compiler* compiler = state.current;
+    compiler->scope_depth--;
+
+    while (compiler->local_count > 0 &&
+           compiler->locals[compiler->local_count - 1].depth > compiler->scope_depth) {
+        compiler->local_count--;
+    }
+}
+
+static int resolve_local(Compiler* compiler, const char* name) {
+    for (int i = compiler->local_count - 1; i >= 0; i--) {
+        if (compiler->locals[i].name == name) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+static int resolve_global(const char* name) {
+    Program* program = state.program;
+    for (int i = 0; i < program->global_count; i++) {
+        if (program->global_names[i] == name) {
+            return i;
+        }
+    }
+
+    if (program->global_count > UINT16_MAX) {
+        compile_error("Too many global variables.");
+        return 0;
+    }
+
+    program->global_names = realloc(program->global_names, sizeof(const char*) * (program->global_count + 1));
+    program->global_names[program->global_count] = name;
+    return program->global_count++;
+}
+
+// Declare a local in the current scope, reusing the slot of an existing
+// variable with the same name (the tree walker redefines it in place)
+static int declare_local(const char* name) {
+    Compiler* compiler = state.current;
+    for (int i = compiler->local_count - 1; i >= 0; i--) {
+        if (compiler->locals[i].depth < compiler->scope_depth) break;
+        if (compiler->locals[i].name == name) return i;
+    }
+
+    if (compiler->local_count == MAX_LOCALS) {
+        compile_error("Too many local variables in function.");
+        return 0;
+    }
+
+    int slot = compiler->local_count++;
+    compiler->locals[slot].name = name;
+    compiler->locals[slot].depth = compiler->scope_depth;
+
+    Function* function = compiler->function;
+    if (slot >= function->slot_count) {
+        function->slot_count = slot + 1;
+        function->slot_names = realloc(function->slot_names, sizeof(const char*) * function->slot_count);
+    }
+    function->slot_names[slot] = name;
+    return slot;
+}
+
+static bool is_global_scope(void) {
+    return state.current->kind != FUNC_USER && state.current->scope_depth == 0;
+}
+
+static void emit_get_variable(const char* name) {
+    int slot = resolve_local(state.current, name);
+    if (slot != -1) {
+        emit_bytes(OP_GET_LOCAL, (uint8_t)slot);
+    } else {
+        emit_byte(OP_GET_GLOBAL);
+        emit_short((uint16_t)resolve_global(name));
+    }
+}
+
+static void emit_set_variable(const char* name) {
+    int slot = resolve_local(state.current, name);
+    if (slot != -1) {
+        emit_bytes(OP_SET_LOCAL, (uint8_t)slot);
+    } else {
+        emit_byte(OP_SET_GLOBAL);
+        emit_short((uint16_t)resolve_global(name));
+    }
+}
+
+static void emit_define_variable(const char* name, DataType type) {
+    if (is_global_scope()) {
+        emit_byte(OP_DEFINE_GLOBAL);
+        emit_short((uint16_t)resolve_global(name));
+        emit_byte((uint8_t)type);
+    } else {
+        int slot = declare_local(name);
+        emit_byte(OP_DEFINE_LOCAL);
+        emit_bytes((uint8_t)slot, (uint8_t)type);
+    }
+}
+
+// List instructions and OP_APPEND address their variable directly
+static void emit_variable_op(OpCode op, const char* name) {
+    int slot = resolve_local(state.current, name);
+    emit_byte(op);
+    if (slot != -1) {
+        emit_byte(0);
+        emit_short((uint16_t)slot);
+    } else {
+        emit_byte(1);
+        emit_short((uint16_t)resolve_global(name));
+    }
+}
+
+static void emit_list_op(OpCode op, Expr* list) {
+    if (list->type != EXPR_VARIABLE) {
+        compile_error("List operations require a list variable.");
+        return;
+    }
+    emit_variable_op(op, list->as.variable.name.lexeme);
+}
+
+// Expressions
+
+static void compile_literal(LiteralExpr* literal) {
+    Value value = {0};
+    value.type = literal->type;
+    value.is_function = false;
+
+    switch (literal->type) {
+        case TYPE_INT:
+            value.value.int_val = literal->as.int_val;
+            break;
+        case TYPE_LONG:
+            value.value.long_val = literal->as.long_val;
+            break;
+        case TYPE_FLOAT:
+            value.value.float_val = literal->as.float_val;
+            break;
+        case TYPE_STRING:
+            value = value_constant_string(literal->as.string_val);
+            break;
+        case TYPE_BOOL:
+            value.value.bool_val = literal->as.bool_val;
+            break;
+        default:
+            compile_error("Invalid literal type.");
+            return;
+    }
+
+    emit_constant(value);
+}
+
+static void compile_binary(Expr* expr) {
+    // Special case for list index assignment
+    if (expr->as.binary.operator.type == TOKEN_ASSIGN &&
+        expr->as.binary.left->type == EXPR_LIST_ACCESS) {
+        compile_expr(expr->as.binary.left->as.list_access.index);
+        compile_expr(expr->as.binary.right);
+        emit_list_op(OP_SET_INDEX, expr->as.binary.left->as.list_access.list);
+        return;
+    }
+
+    compile_expr(expr->as.binary.left);
+    compile_expr(expr->as.binary.right);
+
+    state.line = expr->as.binary.operator.line;
+    switch (expr->as.binary.operator.type) {
+        case TOKEN_PLUS: emit_byte(OP_ADD); break;
+        case TOKEN_MINUS: emit_byte(OP_SUBTRACT); break;
+        case TOKEN_MULTIPLY: emit_byte(OP_MULTIPLY); break;
+        case TOKEN_DIVIDE: emit_byte(OP_DIVIDE); break;
+        case TOKEN_MODULO: emit_byte(OP_MODULO); break;
+        case TOKEN_EQUALS: emit_byte(OP_EQUAL); break;
+        case TOKEN_NOT_EQUALS: emit_byte(OP_NOT_EQUAL); break;
+        case TOKEN_LESS: emit_byte(OP_LESS); break;
+        case TOKEN_LESS_EQUAL: emit_byte(OP_LESS_EQUAL); break;
+        case TOKEN_GREATER: emit_byte(OP_GREATER); break;
+        case TOKEN_GREATER_EQUAL: emit_byte(OP_GREATER_EQUAL); break;
+        default:
+            compile_error("Invalid binary operator.");
+    }
+}
+
+// op is OP_CALL, or OP_TAIL_CALL for a call whose result is returned
+static void compile_call(CallExpr* call, OpCode op) {
+    compile_expr(call->callee);
+    for (int i = 0; i < call->arg_count; i++) {
+        compile_expr(call->arguments[i]);
+    }
+    emit_bytes(op, (uint8_t)call->arg_count);
+}
+
+static void compile_expr(Expr* expr) {
+    if (expr == NULL) {
+        compile_error("Expect expression.");
+        return;
+    }
+
+    switch (expr->type) {
+        case EXPR_LITERAL:
+            state.line = expr->as.literal.value.line;
+            compile_literal(&expr->as.literal);
+            break;
+        case EXPR_BINARY:
+            compile_binary(expr);
+            break;
+        case EXPR_UNARY:
+            compile_expr(expr->as.unary.operand);
+            state.line = expr->as.unary.operator.line;
+            emit_byte(OP_NEGATE);
+            break;
+        case EXPR_VARIABLE:
+            state.line = expr->as.variable.name.line;
+            emit_get_variable(expr->as.variable.name.lexeme);
+            break;
+        case EXPR_ASSIGN: {
+            const char* name = expr->as.assign.name.lexeme;
+            Expr* operands[APPEND_MAX_OPERANDS];
+            int count = 0;
+            if (!expr->typed || expr->value_type == TYPE_STRING) {
+                count = assign_append_operands(&expr->as.assign, operands);
+            }
+            if (count > 0) {
+                state.line = expr->as.assign.name.line;
+                emit_get_variable(name);
+                for (int i = 0; i < count; i++) {
+                    compile_expr(operands[i]);
+                }
+                state.line = expr->as.assign.value->as.binary.operator.line;
+                emit_variable_op(OP_APPEND, name);
+                emit_byte((uint8_t)count);
+                break;
+            }
+            compile_expr(expr->as.assign.value);
+            state.line = expr->as.assign.name.line;
+            emit_set_variable(name);
+            break;
+        }
+        case EXPR_CALL:
+            compile_call(&expr->as.call, OP_CALL);
+            break;
+        case EXPR_LIST_ACCESS:
+            compile_expr(expr->as.list_access.index);
+            emit_list_op(OP_GET_INDEX, expr->as.list_access.list);
+            break;
+        case EXPR_LIST_METHOD:
+            compile_expr(expr->as.list_method.argument);
+            switch (expr->as.list_method.method) {
+                case TOKEN_ADD: emit_list_op(OP_LIST_ADD, expr->as.list_method.list); break;
+                case TOKEN_REMOVE: emit_list_op(OP_LIST_REMOVE, expr->as.list_method.list); break;
+                case TOKEN_RESERVE: emit_list_op(OP_LIST_RESERVE, expr->as.list_method.list); break;
+                default: emit_list_op(OP_LIST_SORT, expr->as.list_method.list); break;
+            }
+            break;
+        case EXPR_LIST_PROPERTY:
+            emit_list_op(OP_LIST_LENGTH, expr->as.list_property.list);
+            break;
+    }
+}
+
+// Statements
+
+static void compile_function(Stmt* stmt) {
+    FunctionStmt* decl = &stmt->as.function;
+    bool is_main = decl->name.lexeme == state.main_name;
+
+    Function* function = new_function(decl->name.lexeme);
+    function->arity = decl->param_count;
+    function->return_type = decl->return_type;
+    if (decl->param_count > 0) {
+        function->param_types = malloc(sizeof(DataType) * decl->param_count);
+        memcpy(function->param_types, decl->param_types, sizeof(DataType) * decl->param_count);
+    }
+
+    Compiler* enclosing = state.current;
+    Compiler compiler;
+    init_compiler(&compiler, function, is_main ? FUNC_MAIN : FUNC_USER);
+
+    for (int i = 0; i < decl->param_count; i++) {
+        declare_local(decl->params[i].lexeme);
+    }
+
+    compile_stmt(decl->body);
+
+    // Falling off the end returns the default value of the return type
+    emit_bytes(OP_DEFAULT, (uint8_t)decl->return_type);
+    emit_byte(OP_RETURN);
+
+    state.current = enclosing;
+    state.line = decl->name.line;
+
+    Value value = {0};
+    value.type = decl->return_type;
+    value.is_function = true;
+    value.value.function = &function->callable;
+    emit_constant(value);
+    emit_define_variable(decl->name.lexeme, decl->return_type);
+
+    // The main function runs as soon as it is declared
+    if (is_main) {
+        emit_get_variable(decl->name.lexeme);
+        emit_bytes(OP_CALL, 0);
+        emit_byte(OP_POP);
+    }
+}
+
+static void compile_include(Stmt* stmt) {
+    state.line = stmt->as.include.path.line;
+
+    char* path = module_include_path(stmt->as.include.path.lexeme);
+    bool first_load;
+    Module* module = module_load(path, &first_load);
+    free(path);
+
+    if (module == NULL) {
+        state.had_error = true;
+        return;
+    }
+
+    // Included statements are compiled in place, in the including scope, at
+    // the first include of the file only
+    if (!first_load) return;
+    for (int i = 0; i < module->count; i++) {
+        compile_stmt(module->statements[i]);
+    }
+}
+
+static void compile_stmt(Stmt* stmt) {
+    if (stmt == NULL) {
+        compile_error("Expect statement.");
+        return;
+    }
+
+    switch (stmt->type) {
+        case STMT_EXPRESSION:
+            compile_expr(stmt->as.expression);
+            emit_byte(OP_POP);
+            break;
+        case STMT_VAR_DECL: {
+            VarDeclStmt* decl = &stmt->as.var_decl;
+            if (decl->initializer != NULL) {
+                compile_expr(decl->initializer);
+            } else {
+                emit_bytes(OP_DEFAULT, (uint8_t)decl->type);
+            }
+            state.line = decl->name.line;
+            emit_define_variable(decl->name.lexeme, decl->type);
+            break;
+        }
+        case STMT_BLOCK: {
+            // Only open a new scope if this is not a variable declaration block
+            bool scoped = stmt->as.block.count == 0 || stmt->as.block.statements[0]->type != STMT_VAR_DECL;
+            if (scoped) begin_scope();
+            for (int i = 0; i < stmt->as.block.count; i++) {
+                compile_stmt(stmt->as.block.statements[i]);
+            }
+            if (scoped) end_scope();
+            break;
+        }
+        case STMT_IF: {
+            compile_expr(stmt->as.if_stmt.condition);
+            int then_jump = emit_jump(OP_JUMP_IF_FALSE);
+            compile_stmt(stmt->as.if_stmt.then_branch);
+
+            if (stmt->as.if_stmt.else_branch != NULL) {
+                int else_jump = emit_jump(OP_JUMP);
+                patch_jump(then_jump);
+                compile_stmt(stmt->as.if_stmt.else_branch);
+                patch_jump(else_jump);
+            } else {
+                patch_jump(then_jump);
+            }
+            break;
+        }
+        case STMT_WHILE: {
+            int loop_start = current_chunk()->count;
+            compile_expr(stmt->as.while_stmt.condition);
+            int exit_jump = emit_jump(OP_JUMP_IF_FALSE);
+            compile_stmt(stmt->as.while_stmt.body);
+            emit_loop(loop_start);
+            patch_jump(exit_jump);
+            break;
+        }
+        case STMT_FOR: {
+            // The loop variable gets its own scope
+            begin_scope();
+            if (stmt->as.for_stmt.init != NULL) {
+                compile_stmt(stmt->as.for_stmt.init);
+            }
+
+            int loop_start = current_chunk()->count;
+            int exit_jump = -1;
+            if (stmt->as.for_stmt.condition != NULL) {
+                compile_expr(stmt->as.for_stmt.condition);
+                exit_jump = emit_jump(OP_JUMP_IF_FALSE);
+            }
+
+            compile_stmt(stmt->as.for_stmt.body);
+
+            if (stmt->as.for_stmt.increment != NULL) {
+                compile_expr(stmt->as.for_stmt.increment);
+                emit_byte(OP_POP);
+            }
+            emit_loop(loop_start);
+
+            if (exit_jump != -1) patch_jump(exit_jump);
+            end_scope();
+            break;
+        }
+        case STMT_FUNCTION:
+            compile_function(stmt);
+            break;
+        case STMT_RETURN: {
+            Expr* value = stmt->as.return_stmt.expression;
+            if (state.current->kind == FUNC_SCRIPT) {
+                // A top-level return only evaluates its expression
+                if (value != NULL) {
+                    compile_expr(value);
+                    emit_byte(OP_POP);
+                }
+                break;
+            }
+
+            if (value != NULL && value->type == EXPR_CALL) {
+                // The return after it only runs if the call did not take over the frame
+                compile_call(&value->as.call, OP_TAIL_CALL);
+            } else if (value != NULL) {
+                compile_expr(value);
+            } else {
+                emit_bytes(OP_DEFAULT, (uint8_t)state.current->function->return_type);
+            }
+            emit_byte(OP_RETURN);
+            break;
+        }
+        case STMT_INCLUDE:
+            compile_include(stmt);
+            break;
+    }
+}
+
+bool compile(Stmt** statements, int count, Program* program) {
+    program->script = NULL;
+    program->functions = NULL;
+    program->function_count = 0;
+    program->global_names = NULL;
+    program->global_count = 0;
+
+    state.program = program;
+    state.main_name = pool_intern("main");
+    state.line = 1;
+    state.had_error = false;
+
+    Compiler compiler;
+    program->script = new_function("script");
+    init_compiler(&compiler, program->script, FUNC_SCRIPT);
+
+    for (int i = 0; i < count; i++) {
+        compile_stmt(statements[i]);
+    }
+
+    emit_bytes(OP_DEFAULT, TYPE_VOID);
+    emit_byte(OP_RETURN);
+
+    state.current = NULL;
+    return !state.had_error;
+}
+
+void free_program(Program* program) {
+    for (int i = 0; i < program->function_count; i++) {
+        Function* function = program->functions[i];
+        free(function->slot_names);
+        free(function->param_types);
+        free_chunk(&function->chunk);
+        free(function);
+    }
+    free(program->functions);
+
+    free(program->global_names);
+
+    program->script = NULL;
+    program->functions = NULL;
+    program->function_count = 0;
+    program->global_names = NULL;
+    program->global_count = 0;
+}
@@ -0,0 +1,1468 @@
+#include <limits.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "headers/emit.h"
+#include "headers/module.h"
+#include "headers/pool.h"
+#include "headers/native.h"
+
+// build.h spells typeof the GNU way; this file is compiled as ISO C
+#define typeof __typeof__
+#define SHL_IMPLEMENTATION
+#include "../build.h"
+
+#define MAX_LOCALS 256
+// Signatures found late (functions and globals used before their
+// declaration, functions that must return a Value) cost another pass
+#define MAX_PASSES 32
+
+typedef enum {
+    FUNC_SCRIPT,  // Top-level statements
+    FUNC_MAIN,    // main() declares globals at depth 0, like in the VM
+    FUNC_USER     // Any other function
+} FunctionKind;
+
+typedef struct {
+    char* text;
+    size_t length;
+    size_t capacity;
+} Buffer;
+
+typedef struct {
+    const char* name;
+    int depth;
+    DataType type;
+    int id;            // The C variable is l<id>_<name>
+} Local;
+
+// The VM's globals are typed by their latest definition. A name defined
+// again with another type gets a C variable per type, and references use the
+// one defined last in the program text.
+typedef struct {
+    const char* name;
+    DataType type;
+    int variant;       // Index among globals of the same name
+    int defined;       // Order of the definition in this pass, 0 if none yet
+} Global;
+
+typedef struct {
+    FunctionStmt* declaration;
+    bool boxed;        // Returns a Value instead of the C int of its type
+    bool bounces;      // Leaves a tail call to another function to the trampoline
+    bool tail_target;  // Called by the trampoline with the arguments in tc<id>_<n>
+} FunctionInfo;
+
+// A translated expression. Int and bool values are plain C ints unless they
+// come out of something dynamic; everything else is a Value. Temporaries
+// own their value. Any other text is free of side effects and can be
+// evaluated later, unless something it reads is assigned first.
+typedef struct {
+    char* text;
+    bool boxed;
+    bool known;        // The value always has the static type below
+    DataType type;
+    bool temporary;
+    bool constant;
+} Operand;
+
+typedef struct Emitter {
+    struct Emitter* enclosing;
+    FunctionKind kind;
+    FunctionInfo* info;
+    Local locals[MAX_LOCALS];
+    int local_count;
+    int scope_depth;
+    Buffer declarations;
+    Buffer body;
+    Buffer releases;   // Owned locals released when the function returns
+    int indent;
+    bool has_return;
+    bool restarts;     // A tail call to itself jumps back to start
+} Emitter;
+
+typedef struct {
+    Emitter* current;
+    Global* globals;
+    int global_count;
+    int global_capacity;
+    FunctionInfo* functions;
+    int function_count;
+    int function_capacity;
+    const char** natives;
+    int native_count;
+    int native_capacity;
+    Module** modules;
+    int module_count;
+    int module_capacity;
+    Buffer prototypes;
+    Buffer code;
+    int string_count;  // String literals, each cached in a static s<n>
+    int temp_count;
+    int local_id;
+    int definitions;
+    const char* main_name;  // Interned "main"
+    int line;
+    bool changed;      // A signature was learned during this pass
+    bool had_error;
+} EmitState;
+
+static EmitState state;
+
+static const char* type_names[] = {
+    "TYPE_INT", "TYPE_FLOAT", "TYPE_STRING", "TYPE_VOID",
+    "TYPE_BOOL", "TYPE_LIST", "TYPE_DOUBLE", "TYPE_LONG"
+};
+
+static Operand emit_expr(Expr* expr);
+static void emit_stmt(Stmt* stmt);
+
+static void buffer_vprintf(Buffer* buffer, const char* format, va_list args) {
+    va_list copy;
+    va_copy(copy, args);
+    int length = vsnprintf(NULL, 0, format, copy);
+    va_end(copy);
+
+    if (buffer->length + length + 1 > buffer->capacity) {
+        buffer->capacity = buffer->capacity < 256 ? 256 : buffer->capacity * 2;
+        if (buffer->capacity < buffer->length + length + 1) buffer->capacity = buffer->length + length + 1;
+        buffer->text = realloc(buffer->text, buffer->capacity);
+    }
+    vsnprintf(buffer->text + buffer->length, length + 1, format, args);
+    buffer->length += length;
+}
+
+static void buffer_printf(Buffer* buffer, const char* format, ...) {
+    va_list args;
+    va_start(args, format);
+    buffer_vprintf(buffer, format, args);
+    va_end(args);
+}
+
+static const char* buffer_text(Buffer* buffer) {
+    return buffer->text != NULL ? buffer->text : "";
+}
+
+static void buffer_free(Buffer* buffer) {
+    free(buffer->text);
+    buffer->text = NULL;
+    buffer->length = 0;
+    buffer->capacity = 0;
+}
+
+static char* format(const char* format, ...) {
+    Buffer buffer = {0};
+    va_list args;
+    va_start(args, format);
+    buffer_vprintf(&buffer, format, args);
+    va_end(args);
+    return buffer.text;
+}
+
+static void emit_error(const char* message) {
+    fprintf(stderr, "[line %d] Error: %s\n", state.line, message);
+    state.had_error = true;
+}
+
+// Write one line of C into the current function
+static void emit_line(const char* format, ...) {
+    Emitter* emitter = state.current;
+    for (int i = 0; i < emitter->indent; i++) {
+        buffer_printf(&emitter->body, "    ");
+    }
+
+    va_list args;
+    va_start(args, format);
+    buffer_vprintf(&emitter->body, format, args);
+    va_end(args);
+    buffer_printf(&emitter->body, "\n");
+}
+
+static bool is_unboxed(DataType type) {
+    return type == TYPE_INT || type == TYPE_BOOL;
+}
+
+static const char* c_type(DataType type) {
+    return is_unboxed(type) ? "int" : "Value";
+}
+
+// Operands
+
+static Operand unboxed(char* text, DataType type) {
+    Operand operand = {text, false, true, type, false, false};
+    return operand;
+}
+
+static Operand constant_int(int value) {
+    Operand operand = unboxed(format("%d", value), TYPE_INT);
+    operand.constant = true;
+    return operand;
+}
+
+static Operand temp_variable(char* init, bool known, DataType type) {
+    int temp = state.temp_count++;
+    emit_line("Value t%d = %s;", temp, init);
+    free(init);
+
+    Operand operand = {format("t%d", temp), true, known, type, true, false};
+    // A known int or bool owns nothing and is read directly
+    if (known && is_unboxed(type)) {
+        free(operand.text);
+        operand.text = format("t%d.value.int_val", temp);
+        operand.boxed = false;
+    }
+    return operand;
+}
+
+static Operand temp_int(char* init, DataType type) {
+    int temp = state.temp_count++;
+    emit_line("int t%d = %s;", temp, init);
+    free(init);
+
+    Operand operand = unboxed(format("t%d", temp), type);
+    operand.temporary = true;
+    return operand;
+}
+
+// Evaluate an operand now, before code with side effects runs
+static void materialize(Operand* operand) {
+    if (operand->temporary || operand->constant) return;
+
+    if (operand->boxed) {
+        *operand = temp_variable(operand->text, operand->known, operand->type);
+    } else {
+        *operand = temp_int(operand->text, operand->type);
+    }
+}
+
+static Operand box(Operand operand) {
+    if (operand.boxed) return operand;
+
+    char* text = format(operand.type == TYPE_BOOL ? "rt_bool(%s)" : "rt_int(%s)", operand.text);
+    free(operand.text);
+    operand.text = text;
+    operand.boxed = true;
+    operand.temporary = false;
+    return operand;
+}
+
+// Discard the value of an expression statement
+static void drop(Operand operand) {
+    if (operand.boxed && operand.temporary) {
+        emit_line("value_release(&%s);", operand.text);
+    } else if (!operand.boxed && !operand.temporary && !operand.constant) {
+        // Still evaluated for its errors, like a division by zero
+        emit_line("(void)(%s);", operand.text);
+    }
+    free(operand.text);
+}
+
+static bool has_side_effects(Expr* expr) {
+    if (expr == NULL) return false;
+
+    switch (expr->type) {
+        case EXPR_ASSIGN:
+        case EXPR_CALL:
+        case EXPR_LIST_METHOD:
+            return true;
+        case EXPR_BINARY:
+            return expr->as.binary.operator.type == TOKEN_ASSIGN ||
+                   has_side_effects(expr->as.binary.left) ||
+                   has_side_effects(expr->as.binary.right);
+        case EXPR_UNARY:
+            return has_side_effects(expr->as.unary.operand);
+        case EXPR_LIST_ACCESS:
+            return has_side_effects(expr->as.list_access.index);
+        default:
+            return false;
+    }
+}
+
+// Scopes and variable resolution, mirroring the bytecode compiler
+
+static void begin_scope(void) {
+    state.current->scope_depth++;
+}
+
+static void end_scope(void) {
+    Emitter* emitter = state.current;
+    emitter->scope_depth--;
+
+    while (emitter->local_count > 0 &&
+           emitter->locals[emitter->local_count - 1].depth > emitter->scope_depth) {
+        emitter->local_count--;
+    }
+}
+
+static bool is_global_scope(void) {
+    return state.current->kind != FUNC_USER && state.current->scope_depth == 0;
+}
+
+static Local* resolve_local(const char* name) {
+    Emitter* emitter = state.current;
+    for (int i = emitter->local_count - 1; i >= 0; i--) {
+        if (emitter->locals[i].name == name) {
+            return &emitter->locals[i];
+        }
+    }
+    return NULL;
+}
+
+static Global* find_global(const char* name) {
+    Global* found = NULL;
+    for (int i = 0; i < state.global_count; i++) {
+        Global* global = &state.globals[i];
+        if (global->name == name && (found == NULL || global->defined > found->defined)) {
+            found = global;
+        }
+    }
+    return found;
+}
+
+static char* global_name(Global* global) {
+    if (global->variant == 0) return format("g_%s", global->name);
+    return format("g%d_%s", global->variant, global->name);
+}
+
+static FunctionInfo* find_function(const char* name) {
+    for (int i = 0; i < state.function_count; i++) {
+        if (state.functions[i].declaration->name.lexeme == name) return &state.functions[i];
+    }
+    return NULL;
+}
+
+// The C variable a name refers to, or NULL if there is none
+static char* resolve_variable(const char* name, DataType* type) {
+    Local* local = resolve_local(name);
+    if (local != NULL) {
+        *type = local->type;
+        return format("l%d_%s", local->id, local->name);
+    }
+
+    Global* global = find_global(name);
+    if (global != NULL) {
+        *type = global->type;
+        return global_name(global);
+    }
+    return NULL;
+}
+
+static Local* add_local(const char* name, DataType type) {
+    Emitter* emitter = state.current;
+    if (emitter->local_count == MAX_LOCALS) {
+        emit_error("Too many local variables in function.");
+        return NULL;
+    }
+
+    Local* local = &emitter->locals[emitter->local_count++];
+    local->name = name;
+    local->depth = emitter->scope_depth;
+    local->type = type;
+    local->id = state.local_id++;
+    if (!is_unboxed(type)) {
+        buffer_printf(&emitter->releases, "    value_release(&l%d_%s);\n", local->id, name);
+    }
+    return local;
+}
+
+// Locals are declared at the top of the C function. Like the VM, a name
+// declared again in the same scope reuses its variable.
+static char* declare_local(const char* name, DataType type) {
+    Emitter* emitter = state.current;
+    for (int i = emitter->local_count - 1; i >= 0; i--) {
+        Local* local = &emitter->locals[i];
+        if (local->depth < emitter->scope_depth) break;
+        if (local->name == name && local->type == type) {
+            return format("l%d_%s", local->id, name);
+        }
+    }
+
+    Local* local = add_local(name, type);
+    if (local == NULL) return strdup("l0_error");
+
+    buffer_printf(&state.current->declarations, "    %s l%d_%s = %s;\n",
+                  c_type(type), local->id, name, is_unboxed(type) ? "0" : "{0}");
+    return format("l%d_%s", local->id, name);
+}
+
+static char* declare_global(const char* name, DataType type) {
+    Global* global = NULL;
+    int variants = 0;
+    for (int i = 0; i < state.global_count; i++) {
+        if (state.globals[i].name != name) continue;
+        variants++;
+        if (state.globals[i].type == type) global = &state.globals[i];
+    }
+
+    if (global == NULL) {
+        if (state.global_count == state.global_capacity) {
+            state.global_capacity = state.global_capacity < 8 ? 8 : state.global_capacity * 2;
+            state.globals = realloc(state.globals, sizeof(Global) * state.global_capacity);
+        }
+        global = &state.globals[state.global_count++];
+        global->name = name;
+        global->type = type;
+        global->variant = variants;
+        state.changed = true;
+    }
+    global->defined = ++state.definitions;
+    return global_name(global);
+}
+
+static const char* native_name(const Native* native) {
+    for (int i = 0; i < state.native_count; i++) {
+        if (strcmp(state.natives[i], native->name) == 0) return native->name;
+    }
+
+    if (state.native_count == state.native_capacity) {
+        state.native_capacity = state.native_capacity < 8 ? 8 : state.native_capacity * 2;
+        state.natives = realloc(state.natives, sizeof(const char*) * state.native_capacity);
+    }
+    state.natives[state.native_count++] = native->name;
+    return native->name;
+}
+
+static void emit_undefined(const char* name) {
+    emit_line("rt_error(%d, \"Undefined variable '%s'\");", state.line, name);
+}
+
+// Expressions
+
+static char* quote_string(const char* text) {
+    Buffer buffer = {0};
+    buffer_printf(&buffer, "\"");
+    for (const unsigned char* c = (const unsigned char*)text; *c != '\0'; c++) {
+        if (*c == '"' || *c == '\\') {
+            buffer_printf(&buffer, "\\%c", *c);
+        } else if (*c == '\n') {
+            buffer_printf(&buffer, "\\n");
+        } else if (*c < 0x20 || *c >= 0x7f) {
+            buffer_printf(&buffer, "\\%03o", *c);
+        } else {
+            buffer_printf(&buffer, "%c", *c);
+        }
+    }
+    buffer_printf(&buffer, "\"");
+    return buffer.text;
+}
+
+static Operand emit_literal(LiteralExpr* literal) {
+    Operand operand;
+    switch (literal->type) {
+        case TYPE_INT:
+            return constant_int(literal->as.int_val);
+        case TYPE_BOOL:
+            operand = unboxed(format("%d", literal->as.bool_val ? 1 : 0), TYPE_BOOL);
+            break;
+        case TYPE_LONG:
+            operand = unboxed(format("rt_long(%ldL)", literal->as.long_val), TYPE_LONG);
+            operand.boxed = true;
+            break;
+        case TYPE_FLOAT: {
+            // Hexadecimal keeps the exact value
+            operand = unboxed(format("rt_float(%af)", (double)literal->as.float_val), TYPE_FLOAT);
+            operand.boxed = true;
+            break;
+        }
+        case TYPE_STRING: {
+            char* quoted = quote_string(literal->as.string_val->chars);
+            operand = unboxed(format("rt_string(&s%d, %s, %d)", state.string_count++, quoted,
+                                     literal->as.string_val->length), TYPE_STRING);
+            operand.boxed = true;
+            free(quoted);
+            break;
+        }
+        default:
+            emit_error("Invalid literal type.");
+            return constant_int(0);
+    }
+    operand.constant = true;
+    return operand;
+}
+
+static Operand emit_variable(VariableExpr* variable) {
+    const char* name = variable->name.lexeme;
+    DataType type;
+    char* target = resolve_variable(name, &type);
+    if (target == NULL) {
+        if (find_function(name) != NULL || native_lookup(name) != NULL) {
+            emit_error("Functions can only be called in compiled programs.");
+        } else {
+            emit_undefined(name);
+        }
+        return constant_int(0);
+    }
+
+    if (is_unboxed(type)) return unboxed(target, type);
+
+    Operand operand = temp_variable(format("value_copy(%s)", target), true, type);
+    free(target);
+    return operand;
+}
+
+// name = name + a + b ... on a string variable, extended in place when it can be
+static Operand emit_append(AssignExpr* assign, const char* target, Expr** operands, int count) {
+    Operand left = temp_variable(format("value_copy(%s)", target), true, TYPE_STRING);
+    Operand right[APPEND_MAX_OPERANDS];
+    Buffer list = {0};
+    for (int i = 0; i < count; i++) {
+        // Earlier operands are evaluated before the side effects of this one
+        if (has_side_effects(operands[i])) {
+            for (int j = 0; j < i; j++) {
+                materialize(&right[j]);
+            }
+        }
+        right[i] = box(emit_expr(operands[i]));
+    }
+    for (int i = 0; i < count; i++) {
+        buffer_printf(&list, "%s%s", i > 0 ? ", " : "", right[i].text);
+        free(right[i].text);
+    }
+    state.line = assign->value->as.binary.operator.line;
+
+    Operand result = temp_variable(format("rt_append(%d, &%s, %s, (Value[]){%s}, %d, \"%s\")", state.line,
+                                          target, left.text, list.text, count, assign->name.lexeme),
+                                   true, TYPE_STRING);
+    free(left.text);
+    buffer_free(&list);
+    return result;
+}
+
+static Operand emit_assign(AssignExpr* assign) {
+    const char* name = assign->name.lexeme;
+    DataType type;
+    char* target = resolve_variable(name, &type);
+    Expr* operands[APPEND_MAX_OPERANDS];
+    int count = assign_append_operands(assign, operands);
+    if (target != NULL && type == TYPE_STRING && count > 0) {
+        Operand result = emit_append(assign, target, operands, count);
+        free(target);
+        return result;
+    }
+
+    Operand value = emit_expr(assign->value);
+    state.line = assign->name.line;
+    if (target == NULL) {
+        emit_undefined(name);
+        return value;
+    }
+
+    if (is_unboxed(type) && !value.boxed && value.type == type) {
+        emit_line("%s = %s;", target, value.text);
+        free(value.text);
+        return unboxed(target, type);
+    }
+
+    // Assignment does not convert; the runtime reports a mismatch
+    value = box(value);
+    if (is_unboxed(type)) {
+        emit_line("rt_store_int(&%s, %s, %s, \"%s\");", target, type_names[type], value.text, name);
+    } else {
+        emit_line("rt_assign(&%s, %s, \"%s\");", target, value.text, name);
+    }
+    free(target);
+    return value;
+}
+
+// The list variable a list operation works on, or NULL after reporting why
+// there is none
+static char* list_target(Expr* list, const char* message) {
+    if (list->type != EXPR_VARIABLE) {
+        emit_error("List operations require a list variable.");
+        return NULL;
+    }
+
+    DataType type;
+    char* target = resolve_variable(list->as.variable.name.lexeme, &type);
+    if (target == NULL) {
+        emit_undefined(list->as.variable.name.lexeme);
+        return NULL;
+    }
+    if (type != TYPE_LIST) {
+        emit_line("rt_error(%d, \"%s\");", state.line, message);
+        free(target);
+        return NULL;
+    }
+    return target;
+}
+
+static Operand emit_binary(BinaryExpr* binary) {
+    // Special case for list index assignment
+    if (binary->operator.type == TOKEN_ASSIGN) {
+        if (binary->left->type != EXPR_LIST_ACCESS) {
+            emit_error("Invalid binary operator.");
+            return constant_int(0);
+        }
+
+        ListAccessExpr* access = &binary->left->as.list_access;
+        Operand index = emit_expr(access->index);
+        if (has_side_effects(binary->right)) materialize(&index);
+        Operand value = box(emit_expr(binary->right));
+        index = box(index);
+
+        char* target = list_target(access->list, "Cannot assign to index of non-list value");
+        if (target == NULL) {
+            free(index.text);
+            return value;
+        }
+        Operand result = temp_variable(format("rt_set_index(%d, &%s, %s, %s)",
+                                              state.line, target, index.text, value.text),
+                                       value.known, value.type);
+        free(target);
+        free(index.text);
+        free(value.text);
+        return result;
+    }
+
+    Operand left = emit_expr(binary->left);
+    if (has_side_effects(binary->right)) materialize(&left);
+    Operand right = emit_expr(binary->right);
+    state.line = binary->operator.line;
+
+    const char* op;
+    const char* token;
+    bool comparison = false;
+    switch (binary->operator.type) {
+        case TOKEN_PLUS:          op = "+";  token = "TOKEN_PLUS"; break;
+        case TOKEN_MINUS:         op = "-";  token = "TOKEN_MINUS"; break;
+        case TOKEN_MULTIPLY:      op = "*";  token = "TOKEN_MULTIPLY"; break;
+        case TOKEN_DIVIDE:        op = "/";  token = "TOKEN_DIVIDE"; break;
+        case TOKEN_MODULO:        op = "%";  token = "TOKEN_MODULO"; break;
+        case TOKEN_EQUALS:        op = "=="; token = "TOKEN_EQUALS"; comparison = true; break;
+        case TOKEN_NOT_EQUALS:    op = "!="; token = "TOKEN_NOT_EQUALS"; comparison = true; break;
+        case TOKEN_LESS:          op = "<";  token = "TOKEN_LESS"; comparison = true; break;
+        case TOKEN_LESS_EQUAL:    op = "<="; token = "TOKEN_LESS_EQUAL"; comparison = true; break;
+        case TOKEN_GREATER:       op = ">";  token = "TOKEN_GREATER"; comparison = true; break;
+        case TOKEN_GREATER_EQUAL: op = ">="; token = "TOKEN_GREATER_EQUAL"; comparison = true; break;
+        default:
+            emit_error("Invalid binary operator.");
+            free(left.text);
+            free(right.text);
+            return constant_int(0);
+    }
+
+    // Two ints take the VM's inline fast path as plain C
+    if (!left.boxed && !right.boxed && left.type == TYPE_INT && right.type == TYPE_INT) {
+        char* text;
+        if (binary->operator.type == TOKEN_DIVIDE) {
+            text = format("rt_divide(%d, %s, %s)", state.line, left.text, right.text);
+        } else if (binary->operator.type == TOKEN_MODULO) {
+            text = format("rt_modulo(%d, %s, %s)", state.line, left.text, right.text);
+        } else {
+            text = format("(%s %s %s)", left.text, op, right.text);
+        }
+        free(left.text);
+        free(right.text);
+        return unboxed(text, TYPE_INT);
+    }
+
+    left = box(left);
+    right = box(right);
+    bool known = comparison || (left.known && right.known && left.type == right.type);
+    DataType type = comparison ? TYPE_INT : left.type;
+    Operand result = temp_variable(format("rt_binary(%d, %s, %s, %s)", state.line, token, left.text, right.text),
+                                   known, type);
+    free(left.text);
+    free(right.text);
+    return result;
+}
+
+static Operand emit_unary(UnaryExpr* unary) {
+    Operand operand = emit_expr(unary->operand);
+    state.line = unary->operator.line;
+
+    if (!operand.boxed && operand.type == TYPE_INT) {
+        char* text = format("(-%s)", operand.text);
+        free(operand.text);
+        return unboxed(text, TYPE_INT);
+    }
+
+    operand = box(operand);
+    Operand result = temp_variable(format("rt_negate(%s)", operand.text), operand.known, operand.type);
+    free(operand.text);
+    return result;
+}
+
+// Convert an argument to the parameter type the way the VM's call does
+static char* emit_argument(Operand arg, DataType type, int index, const char* function) {
+    char* text;
+    if (is_unboxed(type)) {
+        if (!arg.boxed && arg.type == type) return arg.text;
+        if (!arg.boxed && arg.type == TYPE_INT && type == TYPE_BOOL) {
+            text = format("(%s != 0)", arg.text);
+            free(arg.text);
+            return text;
+        }
+
+        arg = box(arg);
+        Operand converted = temp_int(format("rt_argument_int(%d, %s, %s, %d, \"%s\")",
+                                            state.line, arg.text, type_names[type], index, function),
+                                     type);
+        free(arg.text);
+        return converted.text;
+    }
+
+    arg = box(arg);
+    if (arg.known && arg.type == type) return arg.text;
+
+    text = format("rt_argument(%d, %s, %s, %d, \"%s\")", state.line, arg.text, type_names[type], index, function);
+    free(arg.text);
+    return text;
+}
+
+// Evaluate the arguments of a call in order
+static Operand* emit_arguments(CallExpr* call, bool boxed) {
+    Operand* args = malloc(sizeof(Operand) * (call->arg_count > 0 ? call->arg_count : 1));
+    for (int i = 0; i < call->arg_count; i++) {
+        if (has_side_effects(call->arguments[i])) {
+            for (int j = 0; j < i; j++) materialize(&args[j]);
+        }
+        args[i] = emit_expr(call->arguments[i]);
+    }
+    // Boxing waits until no later argument can spill an earlier one
+    for (int i = 0; boxed && i < call->arg_count; i++) {
+        args[i] = box(args[i]);
+    }
+    return args;
+}
+
+static void free_arguments(Operand* args, int count) {
+    for (int i = 0; i < count; i++) free(args[i].text);
+    free(args);
+}
+
+// A call to a function that may leave a tail call behind runs the
+// trampoline until the last function in the chain has returned
+static char* trampoline_call(FunctionInfo* function, char* call) {
+    if (!function->bounces) return call;
+    char* text = format("trampoline_%s(%s)", function->boxed ? "value" : "int", call);
+    free(call);
+    return text;
+}
+
+static Operand emit_call(CallExpr* call) {
+    if (call->callee->type != EXPR_VARIABLE) {
+        emit_error("Can only call functions.");
+        return constant_int(0);
+    }
+
+    const char* name = call->callee->as.variable.name.lexeme;
+    state.line = call->callee->as.variable.name.line;
+
+    // Calls are bound when the program is translated: a local or global
+    // variable of that name hides the function, as it does in the VM
+    FunctionInfo* function = find_function(name);
+    const Native* native = native_lookup(name);
+    if (resolve_local(name) != NULL || (function == NULL && find_global(name) != NULL)) {
+        emit_line("rt_error(%d, \"Can only call functions\");", state.line);
+        return constant_int(0);
+    }
+    if (function == NULL && native == NULL) {
+        emit_undefined(name);
+        return constant_int(0);
+    }
+
+    if (function == NULL) {
+        Operand* args = emit_arguments(call, true);
+        const char* builtin = native_name(native);
+        Operand result;
+        if (call->arg_count == 0) {
+            result = temp_variable(format("rt_native(%d, n_%s, NULL, 0)", state.line, builtin),
+                                   true, native->return_type);
+        } else {
+            Buffer list = {0};
+            for (int i = 0; i < call->arg_count; i++) {
+                buffer_printf(&list, "%s%s", i > 0 ? ", " : "", args[i].text);
+            }
+            int array = state.temp_count++;
+            emit_line("Value t%d[] = {%s};", array, list.text);
+            buffer_free(&list);
+            result = temp_variable(format("rt_native(%d, n_%s, t%d, %d)", state.line, builtin, array, call->arg_count),
+                                   true, native->return_type);
+        }
+        free_arguments(args, call->arg_count);
+        return result;
+    }
+
+    FunctionStmt* declaration = function->declaration;
+    Operand* args = emit_arguments(call, false);
+    if (call->arg_count != declaration->param_count) {
+        emit_line("rt_error(%d, \"Expected %d arguments but got %d\");",
+                  state.line, declaration->param_count, call->arg_count);
+        free_arguments(args, call->arg_count);
+        return constant_int(0);
+    }
+
+    Buffer list = {0};
+    for (int i = 0; i < call->arg_count; i++) {
+        char* text = emit_argument(args[i], declaration->param_types[i], i + 1, name);
+        buffer_printf(&list, "%s%s", i > 0 ? ", " : "", text);
+        free(text);
+    }
+    free(args);
+
+    char* text = trampoline_call(function, format("fu_%s(%s)", name, buffer_text(&list)));
+    buffer_free(&list);
+    // Returned values are not converted to the declared type
+    if (function->boxed) return temp_variable(text, false, declaration->return_type);
+    return temp_int(text, declaration->return_type);
+}
+
+static Operand emit_expr(Expr* expr) {
+    if (expr == NULL) {
+        emit_error("Expect expression.");
+        return constant_int(0);
+    }
+
+    switch (expr->type) {
+        case EXPR_LITERAL:
+            state.line = expr->as.literal.value.line;
+            return emit_literal(&expr->as.literal);
+        case EXPR_BINARY:
+            return emit_binary(&expr->as.binary);
+        case EXPR_UNARY:
+            return emit_unary(&expr->as.unary);
+        case EXPR_VARIABLE:
+            state.line = expr->as.variable.name.line;
+            return emit_variable(&expr->as.variable);
+        case EXPR_ASSIGN:
+            return emit_assign(&expr->as.assign);
+        case EXPR_CALL:
+            return emit_call(&expr->as.call);
+        case EXPR_LIST_ACCESS: {
+            Operand index = box(emit_expr(expr->as.list_access.index));
+            char* target = list_target(expr->as.list_access.list, "Cannot access index on a non-list value");
+            if (target == NULL) {
+                free(index.text);
+                return constant_int(0);
+            }
+            Operand result = temp_variable(format("rt_get_index(%d, &%s, %s)", state.line, target, index.text),
+                                           false, TYPE_INT);
+            free(target);
+            free(index.text);
+            return result;
+        }
+        case EXPR_LIST_METHOD: {
+            Operand argument = box(emit_expr(expr->as.list_method.argument));
+            char* target = list_target(expr->as.list_method.list, "Cannot call method on a non-list value");
+            if (target == NULL) {
+                free(argument.text);
+                return constant_int(0);
+            }
+            const char* method = "rt_list_reserve";
+            if (expr->as.list_method.method == TOKEN_ADD) method = "rt_list_add";
+            if (expr->as.list_method.method == TOKEN_REMOVE) method = "rt_list_remove";
+            if (expr->as.list_method.method == TOKEN_SORT) method = "rt_list_sort";
+            Operand result = temp_variable(format("%s(%d, &%s, %s)", method, state.line, target, argument.text),
+                                           true, TYPE_VOID);
+            free(target);
+            free(argument.text);
+            return result;
+        }
+        case EXPR_LIST_PROPERTY: {
+            char* target = list_target(expr->as.list_property.list, "Cannot access property on a non-list value");
+            if (target == NULL) return constant_int(0);
+            Operand result = unboxed(format("rt_length(%d, &%s)", state.line, target), TYPE_INT);
+            free(target);
+            return result;
+        }
+    }
+    return constant_int(0);
+}
+
+// Statements
+
+static char* emit_condition(Expr* condition) {
+    Operand operand = emit_expr(condition);
+    if (!operand.boxed) return operand.text;
+
+    char* text = format("rt_truthy(%d, %s)", state.line, operand.text);
+    free(operand.text);
+    return text;
+}
+
+// Evaluate an expression statement or loop increment
+static void emit_discarded(Expr* expr) {
+    Operand value = emit_expr(expr);
+    // An int assignment leaves nothing to evaluate
+    if (expr != NULL && expr->type == EXPR_ASSIGN && !value.boxed) {
+        free(value.text);
+        return;
+    }
+    drop(value);
+}
+
+static void emit_var_decl(VarDeclStmt* decl) {
+    Operand value = {0};
+    if (decl->initializer != NULL) value = emit_expr(decl->initializer);
+    state.line = decl->name.line;
+
+    // The variable is declared after its initializer, like in the VM
+    const char* name = decl->name.lexeme;
+    DataType type = decl->type;
+    char* target = is_global_scope() ? declare_global(name, type) : declare_local(name, type);
+
+    if (decl->initializer == NULL) {
+        if (is_unboxed(type)) {
+            emit_line("%s = 0;", target);
+        } else {
+            emit_line("rt_define(%d, &%s, %s, value_default(%s));", state.line, target, type_names[type], type_names[type]);
+        }
+    } else if (is_unboxed(type) && !value.boxed && value.type == type) {
+        emit_line("%s = %s;", target, value.text);
+    } else if (is_unboxed(type) && !value.boxed && value.type == TYPE_INT) {
+        emit_line("%s = %s != 0;", target, value.text);
+    } else {
+        value = box(value);
+        if (is_unboxed(type)) {
+            emit_line("%s = rt_define_int(%d, %s, %s);", target, state.line, value.text, type_names[type]);
+        } else {
+            emit_line("rt_define(%d, &%s, %s, %s);", state.line, target, type_names[type], value.text);
+        }
+    }
+    free(value.text);
+    free(target);
+}
+
+// The function a returned call can replace the current call with, or NULL
+// if it has to be an ordinary call
+static FunctionInfo* tail_callee(Expr* expr) {
+    if (expr->type != EXPR_CALL || expr->as.call.callee->type != EXPR_VARIABLE) return NULL;
+
+    CallExpr* call = &expr->as.call;
+    const char* name = call->callee->as.variable.name.lexeme;
+    FunctionInfo* function = find_function(name);
+    if (function == NULL || resolve_local(name) != NULL) return NULL;
+    if (call->arg_count != function->declaration->param_count) return NULL;
+
+    // The trampoline passes the callee's result on as the caller's, so both
+    // must return the same C type
+    FunctionInfo* info = state.current->info;
+    if (function == info) return function;
+    if (info->boxed != function->boxed) return NULL;
+    if (!info->boxed && info->declaration->return_type != function->declaration->return_type) return NULL;
+    return function;
+}
+
+// A call in return position does not nest. A call to the function itself
+// reassigns the parameters and jumps back to the start of the body; a call
+// to another function leaves its arguments in the callee's slots for the
+// trampoline of the nearest ordinary call, which makes it once this call
+// has returned.
+static void emit_tail_call(CallExpr* call, FunctionInfo* function) {
+    Emitter* emitter = state.current;
+    FunctionStmt* declaration = function->declaration;
+    const char* name = declaration->name.lexeme;
+    state.line = call->callee->as.variable.name.line;
+
+    // Every argument is evaluated before the first parameter changes
+    Operand* args = emit_arguments(call, false);
+    int* temps = malloc(sizeof(int) * (call->arg_count > 0 ? call->arg_count : 1));
+    for (int i = 0; i < call->arg_count; i++) {
+        char* text = emit_argument(args[i], declaration->param_types[i], i + 1, name);
+        temps[i] = state.temp_count++;
+        emit_line("%s t%d = %s;", c_type(declaration->param_types[i]), temps[i], text);
+        free(text);
+    }
+    free(args);
+
+    if (function == emitter->info) {
+        for (int i = 0; i < call->arg_count && i < emitter->local_count; i++) {
+            Local* param = &emitter->locals[i];
+            if (!is_unboxed(param->type)) emit_line("value_release(&l%d_%s);", param->id, param->name);
+            emit_line("l%d_%s = t%d;", param->id, param->name, temps[i]);
+        }
+        emit_line("goto start;");
+        emitter->restarts = true;
+    } else {
+        int id = (int)(function - state.functions) + 1;
+        for (int i = 0; i < call->arg_count; i++) {
+            emit_line("tc%d_%d = t%d;", id, i, temps[i]);
+        }
+        emit_line("tc_next = %d;", id);
+        // Replaced by the callee's result before anyone reads it
+        emit_line(emitter->info->boxed ? "result = rt_int(0);" : "result = 0;");
+        emit_line("goto done;");
+        emitter->has_return = true;
+
+        if (!emitter->info->bounces || !function->tail_target) state.changed = true;
+        emitter->info->bounces = true;
+        function->tail_target = true;
+    }
+    free(temps);
+}
+
+static void emit_return(ReturnStmt* stmt) {
+    Emitter* emitter = state.current;
+    if (emitter->kind == FUNC_SCRIPT) {
+        // A top-level return only evaluates its expression
+        if (stmt->expression != NULL) drop(emit_expr(stmt->expression));
+        return;
+    }
+
+    FunctionInfo* info = emitter->info;
+    DataType return_type = info->declaration->return_type;
+    FunctionInfo* callee = stmt->expression != NULL ? tail_callee(stmt->expression) : NULL;
+    if (callee != NULL) {
+        emit_tail_call(&stmt->expression->as.call, callee);
+        return;
+    }
+    emitter->has_return = true;
+
+    if (stmt->expression == NULL) {
+        if (info->boxed) {
+            emit_line("result = value_default(%s);", type_names[return_type]);
+        } else {
+            emit_line("result = 0;");
+        }
+        emit_line("goto done;");
+        return;
+    }
+
+    Operand value = emit_expr(stmt->expression);
+    if (!info->boxed) {
+        if (!value.boxed && value.type == return_type) {
+            emit_line("result = %s;", value.text);
+        } else {
+            // The value is returned as it is, which a C int cannot hold
+            info->boxed = true;
+            state.changed = true;
+        }
+    } else {
+        value = box(value);
+        emit_line("result = %s;", value.text);
+    }
+    emit_line("goto done;");
+    free(value.text);
+}
+
+static void init_emitter(Emitter* emitter, FunctionKind kind, FunctionInfo* info) {
+    memset(emitter, 0, sizeof(Emitter));
+    emitter->enclosing = state.current;
+    emitter->kind = kind;
+    emitter->info = info;
+    // Script and main declarations at depth 0 live in the global scope
+    emitter->scope_depth = kind == FUNC_USER ? 1 : 0;
+    emitter->indent = 1;
+    state.current = emitter;
+}
+
+static void free_emitter(Emitter* emitter) {
+    buffer_free(&emitter->declarations);
+    buffer_free(&emitter->body);
+    buffer_free(&emitter->releases);
+    state.current = emitter->enclosing;
+}
+
+static FunctionInfo* register_function(FunctionStmt* declaration) {
+    FunctionInfo* info = find_function(declaration->name.lexeme);
+    if (info != NULL) {
+        if (info->declaration != declaration) emit_error("Function declared more than once.");
+        return info;
+    }
+
+    if (state.function_count == state.function_capacity) {
+        state.function_capacity = state.function_capacity < 8 ? 8 : state.function_capacity * 2;
+        state.functions = realloc(state.functions, sizeof(FunctionInfo) * state.function_capacity);
+    }
+    info = &state.functions[state.function_count++];
+    info->declaration = declaration;
+    // Assume the declared int or bool comes back until a return says otherwise
+    info->boxed = !is_unboxed(declaration->return_type);
+    state.changed = true;
+    return info;
+}
+
+static void emit_function(FunctionStmt* declaration) {
+    const char* name = declaration->name.lexeme;
+    bool is_main = name == state.main_name;
+    state.line = declaration->name.line;
+    FunctionInfo* info = register_function(declaration);
+    // Looked up again after the body, which may register more functions
+    int index = (int)(info - state.functions);
+
+    Emitter emitter;
+    init_emitter(&emitter, is_main ? FUNC_MAIN : FUNC_USER, info);
+
+    Buffer params = {0};
+    for (int i = 0; i < declaration->param_count; i++) {
+        Local* local = add_local(declaration->params[i].lexeme, declaration->param_types[i]);
+        if (local == NULL) break;
+        buffer_printf(&params, "%s%s l%d_%s", i > 0 ? ", " : "", c_type(local->type), local->id, local->name);
+    }
+    const char* param_list = declaration->param_count > 0 ? buffer_text(&params) : "void";
+
+    emit_stmt(declaration->body);
+
+    info = &state.functions[index];
+    DataType return_type = declaration->return_type;
+    const char* result_type = info->boxed ? "Value" : "int";
+    buffer_printf(&state.prototypes, "static %s fu_%s(%s);\n", result_type, name, param_list);
+
+    Buffer* code = &state.code;
+    buffer_printf(code, "static %s fu_%s(%s) {\n", result_type, name, param_list);
+    buffer_printf(code, "    %s result;\n", result_type);
+    buffer_printf(code, "%s", buffer_text(&emitter.declarations));
+    buffer_printf(code, "    rt_enter(%d);\n", declaration->name.line);
+    if (emitter.restarts) buffer_printf(code, "start:\n");
+    buffer_printf(code, "%s", buffer_text(&emitter.body));
+    // Falling off the end returns the default value of the return type
+    if (info->boxed) {
+        buffer_printf(code, "    result = value_default(%s);\n", type_names[return_type]);
+    } else {
+        buffer_printf(code, "    result = 0;\n");
+    }
+    if (emitter.has_return) buffer_printf(code, "done:\n");
+    buffer_printf(code, "    rt_leave();\n");
+    buffer_printf(code, "%s", buffer_text(&emitter.releases));
+    buffer_printf(code, "    return result;\n}\n\n");
+
+    buffer_free(&params);
+    free_emitter(&emitter);
+
+    // The main function runs as soon as it is declared
+    if (is_main) {
+        if (declaration->param_count != 0) {
+            emit_line("rt_error(%d, \"Expected %d arguments but got 0\");", state.line, declaration->param_count);
+        } else if (info->boxed) {
+            drop(temp_variable(trampoline_call(info, strdup("fu_main()")), false, return_type));
+        } else {
+            char* call = trampoline_call(info, strdup("fu_main()"));
+            emit_line("%s;", call);
+            free(call);
+        }
+    }
+}
+
+static void emit_include(IncludeStmt* include) {
+    state.line = include->path.line;
+
+    char* path = module_include_path(include->path.lexeme);
+    bool first_load;
+    Module* module = module_load(path, &first_load);
+    free(path);
+
+    if (module == NULL) {
+        state.had_error = true;
+        return;
+    }
+
+    // Every pass translates a file at its first include only
+    for (int i = 0; i < state.module_count; i++) {
+        if (state.modules[i] == module) return;
+    }
+    if (state.module_count == state.module_capacity) {
+        state.module_capacity = state.module_capacity < 8 ? 8 : state.module_capacity * 2;
+        state.modules = realloc(state.modules, sizeof(Module*) * state.module_capacity);
+    }
+    state.modules[state.module_count++] = module;
+
+    for (int i = 0; i < module->count; i++) {
+        emit_stmt(module->statements[i]);
+    }
+}
+
+static void emit_stmt(Stmt* stmt) {
+    if (stmt == NULL) {
+        emit_error("Expect statement.");
+        return;
+    }
+
+    switch (stmt->type) {
+        case STMT_EXPRESSION:
+            emit_discarded(stmt->as.expression);
+            break;
+        case STMT_VAR_DECL:
+            emit_var_decl(&stmt->as.var_decl);
+            break;
+        case STMT_BLOCK: {
+            // Only open a new scope if this is not a variable declaration block
+            bool scoped = stmt->as.block.count == 0 || stmt->as.block.statements[0]->type != STMT_VAR_DECL;
+            if (scoped) begin_scope();
+            emit_line("{");
+            state.current->indent++;
+            for (int i = 0; i < stmt->as.block.count; i++) {
+                emit_stmt(stmt->as.block.statements[i]);
+            }
+            state.current->indent--;
+            emit_line("}");
+            if (scoped) end_scope();
+            break;
+        }
+        case STMT_IF: {
+            emit_line("{");
+            state.current->indent++;
+            char* condition = emit_condition(stmt->as.if_stmt.condition);
+            emit_line("if (%s) {", condition);
+            free(condition);
+            state.current->indent++;
+            emit_stmt(stmt->as.if_stmt.then_branch);
+            state.current->indent--;
+            if (stmt->as.if_stmt.else_branch != NULL) {
+                emit_line("} else {");
+                state.current->indent++;
+                emit_stmt(stmt->as.if_stmt.else_branch);
+                state.current->indent--;
+            }
+            emit_line("}");
+            state.current->indent--;
+            emit_line("}");
+            break;
+        }
+        case STMT_WHILE: {
+            emit_line("for (;;) {");
+            state.current->indent++;
+            char* condition = emit_condition(stmt->as.while_stmt.condition);
+            emit_line("if (!(%s)) break;", condition);
+            free(condition);
+            emit_stmt(stmt->as.while_stmt.body);
+            state.current->indent--;
+            emit_line("}");
+            break;
+        }
+        case STMT_FOR: {
+            // The loop variable gets its own scope
+            begin_scope();
+            emit_line("{");
+            state.current->indent++;
+            if (stmt->as.for_stmt.init != NULL) {
+                emit_stmt(stmt->as.for_stmt.init);
+            }
+
+            emit_line("for (;;) {");
+            state.current->indent++;
+            if (stmt->as.for_stmt.condition != NULL) {
+                char* condition = emit_condition(stmt->as.for_stmt.condition);
+                emit_line("if (!(%s)) break;", condition);
+                free(condition);
+            }
+            emit_stmt(stmt->as.for_stmt.body);
+            if (stmt->as.for_stmt.increment != NULL) {
+                emit_discarded(stmt->as.for_stmt.increment);
+            }
+            state.current->indent--;
+            emit_line("}");
+
+            state.current->indent--;
+            emit_line("}");
+            end_scope();
+            break;
+        }
+        case STMT_FUNCTION:
+            emit_function(&stmt->as.function);
+            break;
+        case STMT_RETURN:
+            emit_return(&stmt->as.return_stmt);
+            break;
+        case STMT_INCLUDE:
+            emit_include(&stmt->as.include);
+            break;
+    }
+}
+
+// Translate the whole program once. Returns the C text of run_script().
+static char* emit_pass(Stmt** statements, int count) {
+    state.current = NULL;
+    state.native_count = 0;
+    state.module_count = 0;
+    state.string_count = 0;
+    state.temp_count = 0;
+    state.local_id = 0;
+    state.definitions = 0;
+    state.main_name = pool_intern("main");
+    for (int i = 0; i < state.global_count; i++) {
+        state.globals[i].defined = 0;
+    }
+    state.line = 1;
+    state.changed = false;
+    state.had_error = false;
+    buffer_free(&state.prototypes);
+    buffer_free(&state.code);
+
+    Emitter script;
+    init_emitter(&script, FUNC_SCRIPT, NULL);
+    for (int i = 0; i < count; i++) {
+        emit_stmt(statements[i]);
+    }
+
+    char* text = format("static void run_script(void) {\n%s%s%s}\n",
+                        buffer_text(&script.declarations), buffer_text(&script.body),
+                        buffer_text(&script.releases));
+    free_emitter(&script);
+    return text;
+}
+
+// Makes the tail calls left behind by functions returning the given C type,
+// each with the arguments waiting in its callee's slots
+static void write_trampoline(FILE* file, bool boxed) {
+    const char* type = boxed ? "Value" : "int";
+    fprintf(file, "static %s trampoline_%s(%s result) {\n", type, boxed ? "value" : "int", type);
+    fprintf(file, "    while (tc_next != 0) {\n");
+    fprintf(file, "        int next = tc_next;\n");
+    fprintf(file, "        tc_next = 0;\n");
+    fprintf(file, "        switch (next) {\n");
+    for (int i = 0; i < state.function_count; i++) {
+        FunctionInfo* function = &state.functions[i];
+        if (!function->tail_target || function->boxed != boxed) continue;
+
+        fprintf(file, "            case %d: result = fu_%s(", i + 1, function->declaration->name.lexeme);
+        for (int j = 0; j < function->declaration->param_count; j++) {
+            fprintf(file, "%stc%d_%d", j > 0 ? ", " : "", i + 1, j);
+        }
+        fprintf(file, "); break;\n");
+    }
+    fprintf(file, "        }\n");
+    fprintf(file, "    }\n");
+    fprintf(file, "    return result;\n");
+    fprintf(file, "}\n\n");
+}
+
+static bool write_program(const char* source_path, const char* output_path, const char* script, int max_stack) {
+    FILE* file = fopen(output_path, "w");
+    if (file == NULL) {
+        fprintf(stderr, "Could not open output file \"%s\".\n", output_path);
+        return false;
+    }
+
+    fprintf(file, "// Translated from %s by fulani --emit-c\n", source_path);
+    fprintf(file, "#include \"runtime.h\"\n\n");
+
+    for (int i = 0; i < state.native_count; i++) {
+        fprintf(file, "static const Native* n_%s;\n", state.natives[i]);
+    }
+    for (int i = 0; i < state.string_count; i++) {
+        fprintf(file, "static String* s%d;\n", i);
+    }
+    for (int i = 0; i < state.global_count; i++) {
+        char* name = global_name(&state.globals[i]);
+        fprintf(file, "static %s %s;\n", c_type(state.globals[i].type), name);
+        free(name);
+    }
+
+    bool bounces = false;
+    for (int i = 0; i < state.function_count; i++) {
+        if (state.functions[i].bounces) bounces = true;
+    }
+    if (bounces) {
+        fprintf(file, "static int tc_next;\n");
+        for (int i = 0; i < state.function_count; i++) {
+            FunctionStmt* declaration = state.functions[i].declaration;
+            for (int j = 0; state.functions[i].tail_target && j < declaration->param_count; j++) {
+                fprintf(file, "static %s tc%d_%d;\n", c_type(declaration->param_types[j]), i + 1, j);
+            }
+        }
+        fprintf(file, "static int trampoline_int(int result);\n");
+        fprintf(file, "static Value trampoline_value(Value result);\n");
+    }
+    fprintf(file, "\n%s\n", buffer_text(&state.prototypes));
+    fprintf(file, "%s", buffer_text(&state.code));
+    if (bounces) {
+        write_trampoline(file, false);
+        write_trampoline(file, true);
+    }
+    fprintf(file, "%s\n", script);
+
+    fprintf(file, "int main(void) {\n");
+    fprintf(file, "    rt_init(%d);\n", max_stack);
+    for (int i = 0; i < state.native_count; i++) {
+        fprintf(file, "    n_%s = native_lookup(\"%s\");\n", state.natives[i], state.natives[i]);
+    }
+    fprintf(file, "    rt_run(run_script);\n");
+    fprintf(file, "    return rt_finish();\n");
+    fprintf(file, "}\n");
+
+    bool ok = !ferror(file);
+    if (fclose(file) != 0) ok = false;
+    if (!ok) fprintf(stderr, "Could not write output file \"%s\".\n", output_path);
+    return ok;
+}
+
+static void free_state(void) {
+    free(state.globals);
+    free(state.functions);
+    free(state.natives);
+    free(state.modules);
+    buffer_free(&state.prototypes);
+    buffer_free(&state.code);
+    memset(&state, 0, sizeof(state));
+}
+
+bool emit_program(Stmt** statements, int count, const char* source_path, const char* output_path, int max_stack) {
+    bool ok = false;
+    for (int pass = 0; pass < MAX_PASSES; pass++) {
+        char* script = emit_pass(statements, count);
+        if (state.had_error) {
+            free(script);
+            break;
+        }
+
+        if (!state.changed) {
+            ok = write_program(source_path, output_path, script, max_stack);
+            free(script);
+            free_state();
+            return ok;
+        }
+        free(script);
+    }
+
+    if (!state.had_error) fprintf(stderr, "Error: Could not settle the signatures of the program.\n");
+    free_state();
+    return false;
+}
+
+// Where the runtime sources live: FULANI_HOME when it is set, otherwise the
+// directory of the running fulani binary, which is built at the top of the
+// source tree
+static char* runtime_root(void) {
+    const char* home = getenv("FULANI_HOME");
+    if (home != NULL && home[0] != '\0') return format("%s", home);
+
+    char exe[PATH_MAX];
+    ssize_t length = readlink("/proc/self/exe", exe, sizeof(exe) - 1);
+    if (length <= 0) return format(".");
+    exe[length] = '\0';
+    char* slash = strrchr(exe, '/');
+    if (slash == NULL) return format(".");
+    *slash = '\0';
+    return format("%s", exe[0] == '\0' ? "/" : exe);
+}
+
+static const char* runtime_sources[] = {
+    "runtime.c", "value.c", "native.c", "reduce.c", "sort.c", "output.c"
+};
+
+#define RUNTIME_SOURCE_COUNT (int)(sizeof(runtime_sources) / sizeof(runtime_sources[0]))
+
+bool emit_build(const char* c_path, const char* binary_path) {
+    char* root = runtime_root();
+    char* include = format("-I%s/src/headers", root);
+    char* sources[RUNTIME_SOURCE_COUNT];
+    bool found = true;
+    for (int i = 0; i < RUNTIME_SOURCE_COUNT; i++) {
+        sources[i] = format("%s/src/%s", root, runtime_sources[i]);
+        if (access(sources[i], R_OK) != 0) found = false;
+    }
+
+    bool ok = false;
+    if (!found) {
+        fprintf(stderr, "Error: The runtime sources were not found in '%s/src'. "
+                        "Set FULANI_HOME to the Fulani source tree.\n", root);
+    } else {
+        SHL_Cmd cmd = {0};
+        shl_push(&cmd, "gcc", "-O2", "-std=c11", "-fwrapv", "-D_DEFAULT_SOURCE", include, c_path);
+        for (int i = 0; i < RUNTIME_SOURCE_COUNT; i++) {
+            shl_push(&cmd, sources[i]);
+        }
+        shl_push(&cmd, "-o", binary_path, "-lm", "-pthread");
+        ok = shl_run_always(&cmd);
+    }
+
+    for (int i = 0; i < RUNTIME_SOURCE_COUNT; i++) {
+        free(sources[i]);
+    }
+    free(include);
+    free(root);
+    return ok;
+}
@@ -1,9 +1,23 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <unistd.h>
 #include "headers/lexer.h"
 #include "headers/parser.h"
 #include "headers/interpreter.h"
+#include "headers/resolver.h"
+#include "headers/compiler.h"
+#include "headers/vm.h"
+#include "headers/pool.h"
+#include "headers/output.h"
+#include "headers/module.h"
+#include "headers/emit.h"
+#include "headers/optimizer.h"
+#include "headers/checker.h"
+
+#define USAGE "Usage: fulani [--debug] [-O0 | -O1] [--vm] [--jit | --no-jit] [--output file] [--output-buffer bytes] [--max-stack calls] script\n" \
+              "       fulani --emit-c [-O0 | -O1] [--max-stack calls] script [-o file.c]\n" \
+              "       fulani --build [-O0 | -O1] [--max-stack calls] script [-o binary]\n"
 
 static char* read_file(const char* path) {
     FILE* file = fopen(path, "rb");
@@ -34,80 +48,215 @@ static char* read_file(const char* path) {
     return buffer;
 }
 
-static void run_file(const char* path, bool debug) {
+// Parse a script into arena, optimize and type check it. Exits on a syntax
+// or type error.
+static Stmt** parse_file(const char* path, bool debug, Arena* arena, int* count) {
     char* source = read_file(path);
     
+    // Lex the whole script up front so the parser walks a flat token array
     Lexer lexer;
     lexer_init(&lexer, source);
+    int token_count;
+    Token* tokens = lexer_tokenize(&lexer, &token_count);
     
+    // The whole tree is allocated in one arena and released with it
+    arena_init(arena);
     Parser parser;
-    parser_init(&parser, &lexer);
+    parser_init_tokens(&parser, tokens, arena);
     
-    int count;
-    Stmt** statements = parse(&parser, &count);
+    Stmt** statements = parse(&parser, count);
+    free(tokens);
+    // Nothing in the tree points into the source any more
+    free(source);
     
     if (parser.had_error) {
-        free(source);
-        // Free statements
-        for (int i = 0; i < count; i++) {
-            free_stmt(statements[i]);
-        }
-        free(statements);
+        arena_free(arena);
         exit(65);
     }
     
-    // Print AST if debug mode is enabled
+    // Print AST if debug mode is enabled, as parsed and as it will run
+    if (debug) {
+        print_ast(statements, *count, "AST DUMP");
+    }
+    optimize(statements, *count);
+    if (!check(statements, *count)) {
+        arena_free(arena);
+        pool_free();
+        exit(65);
+    }
     if (debug) {
-        print_ast(statements, count);
+        print_ast(statements, *count, "OPTIMIZED AST DUMP");
     }
+    return statements;
+}
+
+// Translate a script to C, and with binary_path also compile it
+static void emit_file(const char* path, const char* c_path, const char* binary_path, int max_stack) {
+    Arena arena;
+    int count;
+    Stmt** statements = parse_file(path, false, &arena, &count);
     
-    Interpreter interpreter;
-    interpreter_init(&interpreter);
-    interpreter.debug = debug;  // Set debug flag in interpreter
+    bool ok = emit_program(statements, count, path, c_path, max_stack);
+    arena_free(&arena);
+    module_cache_free();
+    pool_free();
+    if (!ok) {
+        exit(65);
+    }
     
-    interpreter_interpret(&interpreter, statements, count);
+    if (binary_path != NULL && !emit_build(c_path, binary_path)) {
+        exit(70);
+    }
+}
+
+static void run_file(const char* path, bool debug, bool use_vm, bool use_jit, int max_stack, Output* output) {
+    Arena arena;
+    int count;
+    Stmt** statements = parse_file(path, debug, &arena, &count);
     
-    if (interpreter.had_error) {
-        free(source);
-        // Free statements
-        for (int i = 0; i < count; i++) {
-            free_stmt(statements[i]);
+    bool had_error;
+    if (use_vm) {
+        Program program;
+        if (!compile(statements, count, &program)) {
+            free_program(&program);
+            arena_free(&arena);
+            module_cache_free();
+            output_free(output);
+            exit(65);
         }
-        free(statements);
+        
+        // Disassemble the bytecode if debug mode is enabled
+        if (debug) {
+            for (int i = 0; i < program.function_count; i++) {
+                disassemble_chunk(&program.functions[i]->chunk, program.functions[i]->name);
+            }
+        }
+        
+        VM vm;
+        vm_init(&vm, output, max_stack);
+        vm_interpret(&vm, &program);
+        had_error = vm.had_error;
+        vm_cleanup(&vm);
+        free_program(&program);
+    } else {
+        Interpreter interpreter;
+        interpreter_init(&interpreter, output);
+        interpreter.debug = debug;  // Set debug flag in interpreter
+        interpreter.jit = use_jit;
+        interpreter.max_stack = max_stack;
+        
+        resolve(statements, count);
+        interpreter_interpret(&interpreter, statements, count);
+        had_error = interpreter.had_error;
         interpreter_cleanup(&interpreter);
-        exit(70);
     }
     
     // Cleanup
-    free(source);
-    for (int i = 0; i < count; i++) {
-        free_stmt(statements[i]);
+    arena_free(&arena);
+    module_cache_free();
+    pool_free();
+    
+    // Whatever the program printed before failing is still delivered
+    output_free(output);
+    if (had_error) {
+        exit(70);
     }
-    free(statements);
-    interpreter_cleanup(&interpreter);
 }
 
 int main(int argc, const char* argv[]) {
     bool debug = false;
+    bool use_vm = false;
+    bool use_jit = true;
+    const char* output_path = NULL;
+    size_t output_size = OUTPUT_DEFAULT_SIZE;
+    int max_stack = MAX_STACK_DEFAULT;
     const char* script_path = NULL;
+    bool emit_c = false;
+    bool build = false;
+    const char* emit_path = NULL;
     
     // Parse command line arguments
     for (int i = 1; i < argc; i++) {
         if (strcmp(argv[i], "--debug") == 0) {
             debug = true;
+        } else if (strcmp(argv[i], "-O0") == 0) {
+            optimizer_set_level(0);
+        } else if (strcmp(argv[i], "-O1") == 0) {
+            optimizer_set_level(1);
+        } else if (strcmp(argv[i], "--vm") == 0) {
+            use_vm = true;
+        } else if (strcmp(argv[i], "--jit") == 0) {
+            use_jit = true;
+        } else if (strcmp(argv[i], "--no-jit") == 0) {
+            use_jit = false;
+        } else if (strcmp(argv[i], "--emit-c") == 0) {
+            emit_c = true;
+        } else if (strcmp(argv[i], "--build") == 0) {
+            build = true;
+        } else if (strcmp(argv[i], "-o") == 0 && i + 1 < argc) {
+            emit_path = argv[++i];
+        } else if (strcmp(argv[i], "--output") == 0 && i + 1 < argc) {
+            output_path = argv[++i];
+        } else if (strcmp(argv[i], "--output-buffer") == 0 && i + 1 < argc) {
+            char* end;
+            long size = strtol(argv[++i], &end, 10);
+            if (*end != '\0' || size <= 0) {
+                fprintf(stderr, "Invalid output buffer size \"%s\".\n", argv[i]);
+                exit(64);
+            }
+            output_size = (size_t)size;
+        } else if (strcmp(argv[i], "--max-stack") == 0 && i + 1 < argc) {
+            char* end;
+            long depth = strtol(argv[++i], &end, 10);
+            if (*end != '\0' || depth <= 0 || depth > 100000000) {
+                fprintf(stderr, "Invalid maximum stack depth \"%s\".\n", argv[i]);
+                exit(64);
+            }
+            max_stack = (int)depth;
         } else if (script_path == NULL) {
             script_path = argv[i];
         } else {
-            fprintf(stderr, "Usage: fulani [--debug] script\n");
+            fprintf(stderr, USAGE);
             exit(64);
         }
     }
     
     if (script_path == NULL) {
-        fprintf(stderr, "Usage: fulani [--debug] script\n");
+        fprintf(stderr, USAGE);
         exit(64);
     }
     
-    run_file(script_path, debug);
+    if (emit_c || build) {
+        // Default to the script's name with .c, or without an extension
+        size_t length = strlen(script_path);
+        const char* extension = strrchr(script_path, '.');
+        if (extension != NULL && strchr(extension, '/') == NULL) {
+            length = (size_t)(extension - script_path);
+        }
+        
+        char* c_path;
+        if (build) {
+            char* binary_path = emit_path != NULL ? strdup(emit_path) : strndup(script_path, length);
+            c_path = malloc(strlen(binary_path) + 3);
+            sprintf(c_path, "%s.c", binary_path);
+            emit_file(script_path, c_path, binary_path, max_stack);
+            free(binary_path);
+        } else {
+            c_path = emit_path != NULL ? strdup(emit_path) : malloc(length + 3);
+            if (emit_path == NULL) sprintf(c_path, "%.*s.c", (int)length, script_path);
+            emit_file(script_path, c_path, NULL, max_stack);
+        }
+        free(c_path);
+        return 0;
+    }
+    
+    Output output;
+    if (output_path == NULL) {
+        output_init(&output, STDOUT_FILENO, output_size);
+    } else if (!output_open(&output, output_path, output_size)) {
+        exit(74);
+    }
+    
+    run_file(script_path, debug, use_vm, use_jit, max_stack, &output);
     return 0;
 }
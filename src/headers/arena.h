@@ -0,0 +1,19 @@
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <stddef.h>
+
+// Bump allocator for data that lives exactly as long as one parsed file.
+// Allocations are never freed one by one; arena_free releases everything.
+typedef struct ArenaBlock ArenaBlock;
+
+typedef struct {
+    ArenaBlock* blocks;   // Most recently allocated block first
+} Arena;
+
+void arena_init(Arena* arena);
+void* arena_alloc(Arena* arena, size_t size);
+void* arena_copy(Arena* arena, const void* data, size_t size);
+void arena_free(Arena* arena);
+
+#endif // ARENA_H
@@ -1,8 +1,10 @@
 #ifndef AST_H
 #define AST_H
 
+#include <stdbool.h>
 #include <stdlib.h>
 #include "token.h"
+#include "arena.h"
 
 typedef enum {
     TYPE_INT,
@@ -43,11 +45,65 @@ typedef enum {
 typedef struct Expr Expr;
 typedef struct Stmt Stmt;
 
+// Specialized forms a binary node rewrites itself into once it has seen its
+// operand types. A guard failure turns it back into BINARY_GENERIC.
+typedef enum {
+    BINARY_GENERIC,
+    BINARY_INT_ADD,
+    BINARY_INT_SUBTRACT,
+    BINARY_INT_MULTIPLY,
+    BINARY_INT_DIVIDE,
+    BINARY_INT_MODULO,
+    BINARY_INT_EQUAL,
+    BINARY_INT_NOT_EQUAL,
+    BINARY_INT_LESS,
+    BINARY_INT_LESS_EQUAL,
+    BINARY_INT_GREATER,
+    BINARY_INT_GREATER_EQUAL,
+    BINARY_FLOAT_ADD,
+    BINARY_FLOAT_SUBTRACT,
+    BINARY_FLOAT_MULTIPLY,
+    BINARY_FLOAT_DIVIDE,
+    BINARY_FLOAT_EQUAL,
+    BINARY_FLOAT_NOT_EQUAL,
+    BINARY_FLOAT_LESS,
+    BINARY_FLOAT_LESS_EQUAL,
+    BINARY_FLOAT_GREATER,
+    BINARY_FLOAT_GREATER_EQUAL,
+    BINARY_LONG_ADD,
+    BINARY_LONG_SUBTRACT,
+    BINARY_LONG_MULTIPLY,
+    BINARY_LONG_DIVIDE,
+    BINARY_LONG_MODULO,
+    BINARY_LONG_EQUAL,
+    BINARY_LONG_NOT_EQUAL,
+    BINARY_LONG_LESS,
+    BINARY_LONG_LESS_EQUAL,
+    BINARY_LONG_GREATER,
+    BINARY_LONG_GREATER_EQUAL,
+    BINARY_DOUBLE_ADD,
+    BINARY_DOUBLE_SUBTRACT,
+    BINARY_DOUBLE_MULTIPLY,
+    BINARY_DOUBLE_DIVIDE,
+    BINARY_DOUBLE_EQUAL,
+    BINARY_DOUBLE_NOT_EQUAL,
+    BINARY_DOUBLE_LESS,
+    BINARY_DOUBLE_LESS_EQUAL,
+    BINARY_DOUBLE_GREATER,
+    BINARY_DOUBLE_GREATER_EQUAL
+} BinaryKind;
+
+// Guard failures after which a node stays generic
+#define BINARY_MAX_DEOPTS 4
+
 // Expression structures
 typedef struct {
     Token operator;
     Expr* left;
     Expr* right;
+    BinaryKind kind;   // Quickened form, BINARY_GENERIC until types are seen
+    int deopts;        // Times the quickened form had to be dropped
+    bool checked;      // The checker proved the operand types, kind needs no guard
 } BinaryExpr;
 
 typedef struct {
@@ -55,13 +111,27 @@ typedef struct {
     Expr* operand;
 } UnaryExpr;
 
+// Lexical address filled in by the resolver. A depth of -1 means the name
+// lives in the global environment and is looked up by name (slot caches it).
 typedef struct {
     Token name;
     DataType type;
+    int depth;
+    int slot;
 } VariableExpr;
 
+// The literal's value is decoded once when the node is created; string
+// literals borrow their string object from the constant pool
 typedef struct {
-    Token* value;
+    Token value;
+    DataType type;
+    union {
+        int int_val;
+        long long_val;
+        float float_val;
+        int bool_val;
+        struct String* string_val;
+    } as;
 } LiteralExpr;
 
 typedef struct {
@@ -73,6 +143,8 @@ typedef struct {
 typedef struct {
     Token name;
     Expr* value;
+    int depth;
+    int slot;
 } AssignExpr;
 
 // New list access expression (list[index])
@@ -81,7 +153,8 @@ typedef struct {
     Expr* index;
 } ListAccessExpr;
 
-// New list method expression (list.add(item) or list.remove(index))
+// New list method expression (list.add(item), list.remove(index), list.reserve(n) or
+// list.sort(descending))
 typedef struct {
     Expr* list;
     TokenType method;
@@ -94,8 +167,12 @@ typedef struct {
     TokenType property;
 } ListPropertyExpr;
 
+// value_type is filled in by the checker, and only holds when typed is set
 struct Expr {
     ExprType type;
+    bool typed;
+    DataType value_type;
+    bool calls;    // Contains a call, so the tree walker evaluates it as a task
     union {
         BinaryExpr binary;
         UnaryExpr unary;
@@ -117,12 +194,16 @@ typedef struct {
     DataType* param_types;
     int param_count;
     Stmt* body;
+    int scope_size;    // Slots needed by the call environment
+    int call_count;    // Calls made in the tree walker, for the JIT
+    struct JitFunction* jit;  // Native code, NULL until the JIT tried it
 } FunctionStmt;
 
 typedef struct {
     Token name;
     DataType type;
     Expr* initializer;
+    int slot;          // Slot in the current environment, -1 for globals
 } VarDeclStmt;
 
 typedef struct {
@@ -141,15 +222,18 @@ typedef struct {
     Expr* condition;   // Loop condition
     Expr* increment;   // Increment expression
     Stmt* body;        // Loop body
+    int scope_size;    // Slots needed by the loop environment
 } ForStmt;
 
 typedef struct {
     Stmt** statements;
     int count;
+    int scope_size;    // Slots needed if the block opens an environment
 } BlockStmt;
 
 typedef struct {
     Expr* expression;
+    bool tail_call;    // Returns a call's result, so the call can reuse the frame
 } ReturnStmt;
 
 // New include statement structure
@@ -159,6 +243,8 @@ typedef struct {
 
 struct Stmt {
     StmtType type;
+    bool straight;    // Makes no call, return or include, so the tree walker
+                      // runs it straight through instead of as tasks
     union {
         Expr* expression;
         VarDeclStmt var_decl;
@@ -172,36 +258,44 @@ struct Stmt {
     } as;
 };
 
-// AST node creation functions
-Expr* create_binary_expr(Token operator, Expr* left, Expr* right);
-Expr* create_unary_expr(Token operator, Expr* operand);
-Expr* create_literal_expr(Token* value);
-Expr* create_variable_expr(Token name, DataType type);
-Expr* create_call_expr(Expr* callee, Expr** arguments, int arg_count);
-Expr* create_assign_expr(Token name, Expr* value);
-Expr* create_list_access_expr(Expr* list, Expr* index);
-Expr* create_list_method_expr(Expr* list, TokenType method, Expr* argument);
-Expr* create_list_property_expr(Expr* list, TokenType property);
-
-Stmt* create_expression_stmt(Expr* expression);
-Stmt* create_var_decl_stmt(Token name, DataType type, Expr* initializer);
-Stmt* create_block_stmt(Stmt** statements, int count);
-Stmt* create_if_stmt(Expr* condition, Stmt* then_branch, Stmt* else_branch);
-Stmt* create_while_stmt(Expr* condition, Stmt* body);
-Stmt* create_for_stmt(Stmt* init, Expr* condition, Expr* increment, Stmt* body);
-Stmt* create_return_stmt(Expr* expression);
-Stmt* create_function_stmt(Token name, DataType return_type, Token* params, DataType* param_types, int param_count, Stmt* body);
+// AST node creation functions. Nodes live in the arena of the file they were
+// parsed from and are released together with it.
+Expr* create_binary_expr(Arena* arena, Token operator, Expr* left, Expr* right);
+Expr* create_unary_expr(Arena* arena, Token operator, Expr* operand);
+Expr* create_literal_expr(Arena* arena, Token value);
+Expr* create_variable_expr(Arena* arena, Token name, DataType type);
+Expr* create_call_expr(Arena* arena, Expr* callee, Expr** arguments, int arg_count);
+Expr* create_assign_expr(Arena* arena, Token name, Expr* value);
+Expr* create_list_access_expr(Arena* arena, Expr* list, Expr* index);
+Expr* create_list_method_expr(Arena* arena, Expr* list, TokenType method, Expr* argument);
+Expr* create_list_property_expr(Arena* arena, Expr* list, TokenType property);
+
+Stmt* create_expression_stmt(Arena* arena, Expr* expression);
+Stmt* create_var_decl_stmt(Arena* arena, Token name, DataType type, Expr* initializer);
+Stmt* create_block_stmt(Arena* arena, Stmt** statements, int count);
+Stmt* create_if_stmt(Arena* arena, Expr* condition, Stmt* then_branch, Stmt* else_branch);
+Stmt* create_while_stmt(Arena* arena, Expr* condition, Stmt* body);
+Stmt* create_for_stmt(Arena* arena, Stmt* init, Expr* condition, Expr* increment, Stmt* body);
+Stmt* create_return_stmt(Arena* arena, Expr* expression);
+Stmt* create_function_stmt(Arena* arena, Token name, DataType return_type, Token* params, DataType* param_types, int param_count, Stmt* body);
 
 // Create an include statement
-Stmt* create_include_stmt(Token path);
+Stmt* create_include_stmt(Arena* arena, Token path);
+
+// Specialized form of op for operands of type, BINARY_GENERIC if it has none,
+// and the operand type a specialized form expects
+BinaryKind binary_kind(TokenType op, DataType type);
+DataType binary_kind_type(BinaryKind kind);
 
-// Memory management functions
-void free_expr(Expr* expr);
-void free_stmt(Stmt* stmt);
+// An assignment of the form name = name + a + b ... is run as one step, so
+// that a string variable can be extended in place. Fills operands with a, b,
+// ... in order and returns how many there are, or 0 for any other form.
+#define APPEND_MAX_OPERANDS 16
+int assign_append_operands(AssignExpr* assign, Expr** operands);
 
 // AST debugging functions
 void print_expr(Expr* expr, int indent);
 void print_stmt(Stmt* stmt, int indent);
-void print_ast(Stmt** statements, int count);
+void print_ast(Stmt** statements, int count, const char* title);
 
 #endif // AST_H 
\ No newline at end of file
@@ -0,0 +1,14 @@
+#ifndef CHECKER_H
+#define CHECKER_H
+
+#include <stdbool.h>
+#include "ast.h"
+
+// Infer the type of every expression and report the type errors that are
+// certain before the program runs. Expressions whose type holds on every
+// evaluation are marked typed, and binary operations on two typed operands
+// are set to their specialized form, which the interpreter then runs without
+// testing the operands. Returns false if an error was reported.
+bool check(Stmt** statements, int count);
+
+#endif // CHECKER_H
@@ -0,0 +1,78 @@
+#ifndef CHUNK_H
+#define CHUNK_H
+
+#include <stdint.h>
+#include "value.h"
+
+// Bytecode instructions executed by the VM. Operands follow the opcode
+// inline; 16-bit operands are stored big-endian.
+typedef enum {
+    OP_CONSTANT,        // [u16 constant] push a constant
+    OP_DEFAULT,         // [u8 type] push the default value of a type
+    OP_POP,
+    OP_GET_LOCAL,       // [u8 slot]
+    OP_SET_LOCAL,       // [u8 slot] assign, leaving the value on the stack
+    OP_DEFINE_LOCAL,    // [u8 slot] [u8 type] pop an initializer into a slot
+    OP_GET_GLOBAL,      // [u16 global]
+    OP_SET_GLOBAL,      // [u16 global]
+    OP_DEFINE_GLOBAL,   // [u16 global] [u8 type]
+    OP_ADD,
+    OP_SUBTRACT,
+    OP_MULTIPLY,
+    OP_DIVIDE,
+    OP_MODULO,
+    OP_EQUAL,
+    OP_NOT_EQUAL,
+    OP_LESS,
+    OP_LESS_EQUAL,
+    OP_GREATER,
+    OP_GREATER_EQUAL,
+    OP_NEGATE,
+    OP_JUMP,            // [u16 offset] forward jump
+    OP_JUMP_IF_FALSE,   // [u16 offset] pop a condition, jump forward if false
+    OP_LOOP,            // [u16 offset] backward jump
+    OP_CALL,            // [u8 argc]
+    OP_TAIL_CALL,       // [u8 argc] call that replaces the current frame
+    OP_RETURN,
+    OP_GET_INDEX,       // [u8 is_global] [u16 slot] list[index]
+    OP_SET_INDEX,       // [u8 is_global] [u16 slot] list[index] = value
+    OP_LIST_ADD,        // [u8 is_global] [u16 slot]
+    OP_LIST_REMOVE,     // [u8 is_global] [u16 slot]
+    OP_LIST_RESERVE,    // [u8 is_global] [u16 slot]
+    OP_LIST_SORT,       // [u8 is_global] [u16 slot]
+    OP_LIST_LENGTH,     // [u8 is_global] [u16 slot]
+    OP_APPEND           // [u8 is_global] [u16 slot] [u8 count] variable = left + count operands
+} OpCode;
+
+typedef struct {
+    int count;
+    int capacity;
+    uint8_t* code;
+    int* lines;
+    int constant_count;
+    int constant_capacity;
+    Value* constants;
+} Chunk;
+
+// A compiled function (or the top-level script)
+typedef struct Function {
+    const char* name;    // Interned, like every identifier
+    int arity;
+    DataType* param_types;
+    DataType return_type;
+    int slot_count;      // Local slots needed by one activation
+    const char** slot_names;  // Variable names per slot, for diagnostics
+    Chunk chunk;
+    Callable callable;   // Shared by the function values that call it
+} Function;
+
+void init_chunk(Chunk* chunk);
+void write_chunk(Chunk* chunk, uint8_t byte, int line);
+int add_constant(Chunk* chunk, Value value);
+void free_chunk(Chunk* chunk);
+
+// Bytecode debugging functions
+int disassemble_instruction(Chunk* chunk, int offset);
+void disassemble_chunk(Chunk* chunk, const char* name);
+
+#endif // CHUNK_H
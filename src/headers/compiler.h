@@ -0,0 +1,20 @@
+#ifndef COMPILER_H
+#define COMPILER_H
+
+#include <stdbool.h>
+#include "ast.h"
+#include "chunk.h"
+
+// Output of compiling a parsed program for the VM
+typedef struct {
+    Function* script;      // Top-level code, run as the outermost frame
+    Function** functions;  // Every compiled function, owned by the program
+    int function_count;
+    const char** global_names;  // Global slot index -> interned name
+    int global_count;
+} Program;
+
+bool compile(Stmt** statements, int count, Program* program);
+void free_program(Program* program);
+
+#endif // COMPILER_H
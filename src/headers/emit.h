@@ -0,0 +1,22 @@
+#ifndef EMIT_H
+#define EMIT_H
+
+#include <stdbool.h>
+#include "ast.h"
+
+// Ahead-of-time translation of a parsed program to C. The generated file
+// includes runtime.h and links against src/runtime.c and the value, native
+// and output modules; int and bool variables become plain C ints and calls
+// to user functions become direct C calls.
+
+// Translate the program, following its includes, into output_path. The
+// program stops with "Stack overflow" past max_stack nested calls. Errors
+// are reported on stderr.
+bool emit_program(Stmt** statements, int count, const char* source_path, const char* output_path, int max_stack);
+
+// Compile a translated program with gcc against the runtime sources found
+// under FULANI_HOME, or else next to the fulani binary. Reports on stderr
+// when they are missing.
+bool emit_build(const char* c_path, const char* binary_path);
+
+#endif // EMIT_H
@@ -2,49 +2,76 @@
 #define INTERPRETER_H
 
 #include <stdbool.h>
+#include <stdint.h>
 #include "ast.h"
+#include "value.h"
+#include "output.h"
 
-// Forward declarations
-struct Environment;
-typedef struct Environment Environment;
-
-typedef struct {
-    char* name;
-    DataType type;
-    union {
-        int int_val;
-        float float_val;
-        char* string_val;
-        int bool_val;       // Boolean value (0 for false, 1 for true)
-        long long_val;      // Long integer value
-        double double_val;  // Double precision value
-        struct {
-            void** items;    // List items
-            int count;       // List size
-            DataType item_type; // Type of items in the list
-        } list_val;
-        struct {
-            FunctionStmt* declaration;
-            Environment* closure;
-        } function;
-    } value;
-    bool is_function;
-} Variable;
+// Nested calls allowed before "Stack overflow" unless --max-stack says otherwise
+#define MAX_STACK_DEFAULT 10000
+// C stack reserved per nested call of JIT-compiled code, and kept free below
+// the deepest one
+#define FRAME_STACK_BYTES 8192
+#define STACK_MARGIN (256 * 1024)
 
 struct Environment {
     Environment* enclosing;
-    Variable* variables;
+    Value* variables;
+    const char** names;  // Interned name per slot, NULL while it is undefined
     int variable_count;
+    int capacity;      // Allocated slots, kept when the environment is reused
 };
 
+typedef enum {
+    FRAME_CALL,        // A call to a user function
+    FRAME_MAIN,        // The body of main, run where main is declared
+    FRAME_STATEMENT    // A top-level statement, or one of an included file
+} FrameKind;
+
+// Statements and expressions waiting to go on, kept in interpreter.c
+typedef struct Task Task;
+
+// A call, main's body or a top-level statement in progress. Frames live in
+// one array in call order; a tail call takes over the frame of the call it
+// replaces.
+typedef struct {
+    FrameKind kind;
+    FunctionStmt* function;
+    Environment* caller;   // Environment to return to
+    Environment* base;     // Environment the frame's statements start in
+    int task_base;         // Tasks below the frame's own
+    bool interpreted;      // Compiled code ran out of C stack, so this call
+                           // and the calls below it stay in the interpreter
+} Frame;
+
 typedef struct {
     Environment* globals;
     Environment* environment;
+    Environment* free_environments;  // Released local environments, linked by enclosing
+    Output* output;                  // Where print and println write
+    Frame* frames;
+    int frame_count;
+    int frame_capacity;
+    Task* tasks;
+    int task_count;
+    int task_capacity;
+    Value* values;                   // Operands of the expressions in tasks
+    int value_count;
+    int value_capacity;
+    int depth;                       // Calls in progress
+    Callable** callables;            // One per function definition run, freed at cleanup
+    int callable_count;
+    int callable_capacity;
+    int max_stack;                   // Nested calls allowed
+    const char* main_name;           // Interned "main"
+    uintptr_t stack_limit;           // Lowest C stack address compiled code may call at
+    bool overflowed;                 // A stack overflow stopped the run
     bool had_error;
     bool debug;  // Debug flag to enable AST printing
+    bool jit;    // Compile hot functions to machine code
 } Interpreter;
 
-void interpreter_init(Interpreter* interpreter);
+void interpreter_init(Interpreter* interpreter, Output* output);
 void interpreter_interpret(Interpreter* interpreter, Stmt** statements, int count);
 void interpreter_cleanup(Interpreter* interpreter);
 
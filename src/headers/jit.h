@@ -0,0 +1,47 @@
+#ifndef JIT_H
+#define JIT_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "ast.h"
+#include "value.h"
+
+// Calls a function takes in the tree walker before it is compiled
+#define JIT_THRESHOLD 50
+
+// Baseline template JIT for the tree walker. Functions whose parameters,
+// locals and result are int, long or bool, and which only do integer
+// arithmetic and call other such functions, are translated to x86-64 machine
+// code. Such a function has no visible side effects, so when the native code
+// hits a runtime error (division by zero) the call is simply run again by the
+// interpreter, which reports it.
+typedef struct JitFunction JitFunction;
+
+// Compile function and the functions it calls, looking callees up in globals.
+// Returns false if it cannot be compiled; the result is remembered in
+// function->jit either way.
+bool jit_compile(FunctionStmt* function, Environment* globals);
+
+// How a call into compiled code ended
+typedef enum {
+    JIT_RETURNED,       // result holds the return value
+    JIT_INTERPRET,      // the call has to be repeated by the interpreter
+    JIT_STACK_OVERFLOW, // the calls nested deeper than allowed
+    JIT_OUT_OF_STACK    // the C stack ran out first; the interpreter has to
+                        // repeat the call without it
+} JitOutcome;
+
+// Run compiled code on arguments already coerced to the parameter types.
+// The calls it makes may nest max_depth deep and must not start below
+// stack_limit on the C stack, the limits the interpreter enforces.
+JitOutcome jit_call(FunctionStmt* function, Value* args, int max_depth, uintptr_t stack_limit, Value* result);
+
+// Compiled code calls the functions its callees were bound to when it was
+// compiled. Once a global function is redefined, all of it is set aside and
+// functions are compiled again, against the new bindings, when they get hot.
+void jit_invalidate(void);
+
+// Release all generated code
+void jit_free(void);
+
+#endif // JIT_H
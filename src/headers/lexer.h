@@ -15,4 +15,8 @@ void lexer_init(Lexer* lexer, const char* source);
 Token lexer_next_token(Lexer* lexer);
 Token lexer_peek_token(Lexer* lexer);
 
+// Lex the whole source up front. The array ends with the TOKEN_EOF token and
+// its lexemes point into the source, which must outlive it.
+Token* lexer_tokenize(Lexer* lexer, int* count);
+
 #endif // LEXER_H 
\ No newline at end of file
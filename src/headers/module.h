@@ -0,0 +1,27 @@
+#ifndef MODULE_H
+#define MODULE_H
+
+#include <stdbool.h>
+#include "ast.h"
+
+// A parsed include file. The cache owns it and its tree until
+// module_cache_free.
+typedef struct {
+    char* path;        // Canonical path, the cache key
+    Arena arena;       // Owns every node of the tree
+    Stmt** statements;
+    int count;
+} Module;
+
+// Helpers for locating and loading files named by include statements
+char* module_include_path(const char* lexeme);
+char* module_resolve_path(const char* filename);
+char* module_read_source(const char* path);
+
+// Find, read and parse an included file. Each file is loaded once per process;
+// *first_load is false when it was already included, and the caller then
+// skips it. Errors are reported on stderr and return NULL.
+Module* module_load(const char* name, bool* first_load);
+void module_cache_free(void);
+
+#endif // MODULE_H
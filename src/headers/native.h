@@ -0,0 +1,32 @@
+#ifndef NATIVE_H
+#define NATIVE_H
+
+#include <stdbool.h>
+#include "value.h"
+
+#define NATIVE_MAX_PARAMS 4
+
+// Builtin implemented in C. Arguments arrive already evaluated and coerced
+// to param_types; the function fills in result and returns false on error.
+// Anything it prints goes to the running program's output buffer.
+typedef bool (*NativeFn)(Output* output, Value* args, int arg_count, Value* result);
+
+typedef struct Native {
+    const char* name;
+    NativeFn function;
+    int arity;                                 // -1 accepts any arguments
+    DataType return_type;
+    DataType param_types[NATIVE_MAX_PARAMS];
+} Native;
+
+// Registry of every builtin, terminated by an entry with a NULL name
+extern const Native natives[];
+
+const Native* native_lookup(const char* name);
+Value native_value(const Native* native);
+
+// Check the arguments against the signature and run the builtin. The caller
+// keeps ownership of args.
+bool native_call(const Native* native, Output* output, Value* args, int arg_count, Value* result);
+
+#endif // NATIVE_H
@@ -0,0 +1,15 @@
+#ifndef OPTIMIZER_H
+#define OPTIMIZER_H
+
+#include "ast.h"
+
+// Optimization level used unless -O0 or -O1 says otherwise
+#define OPTIMIZE_DEFAULT 1
+
+// Fold constant subexpressions and simplify the tree in place, before it is
+// resolved or compiled. Level 0 leaves the tree as parsed. Included files
+// are optimized at the level set here when they are loaded.
+void optimizer_set_level(int level);
+void optimize(Stmt** statements, int count);
+
+#endif // OPTIMIZER_H
@@ -0,0 +1,39 @@
+#ifndef OUTPUT_H
+#define OUTPUT_H
+
+#include <stdarg.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#define OUTPUT_DEFAULT_SIZE (64 * 1024)
+
+// Program output is formatted straight into one buffer and handed to the
+// file descriptor with large write(2) calls when it fills up, on flush(),
+// before an error is reported and when the run ends. A terminal gets the
+// buffer flushed at every newline.
+typedef struct {
+    int fd;
+    char* buffer;
+    size_t length;
+    size_t capacity;
+    bool line_buffered;
+    bool owns_fd;       // Opened by output_open and closed by output_free
+} Output;
+
+void output_init(Output* output, int fd, size_t capacity);
+bool output_open(Output* output, const char* path, size_t capacity);
+void output_flush(Output* output);
+void output_free(Output* output);
+
+// Report an error on stderr. The output last initialized is flushed first,
+// so whatever the program printed before the error comes out before it.
+void output_error(const char* format, ...);
+void output_verror(const char* format, va_list args);
+
+void output_write(Output* output, const char* data, size_t length);
+void output_char(Output* output, char c);
+void output_string(Output* output, const char* text);
+void output_long(Output* output, long value);
+void output_double(Output* output, double value);
+
+#endif // OUTPUT_H
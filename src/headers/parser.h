@@ -7,13 +7,18 @@
 
 typedef struct {
     Lexer* lexer;
+    const Token* tokens;   // Pre-lexed tokens, or NULL to pull them from lexer
+    int token_index;
+    Arena* arena;          // Receives every node and array of the tree
     Token current;
     Token previous;
     bool had_error;
     bool panic_mode;
 } Parser;
 
-void parser_init(Parser* parser, Lexer* lexer);
+void parser_init(Parser* parser, Lexer* lexer, Arena* arena);
+void parser_init_tokens(Parser* parser, const Token* tokens, Arena* arena);
+// The returned array and every node it reaches live in the parser's arena
 Stmt** parse(Parser* parser, int* count);
 void parser_error_at_current(Parser* parser, const char* message);
 void parser_error_at_previous(Parser* parser, const char* message);
@@ -0,0 +1,17 @@
+#ifndef POOL_H
+#define POOL_H
+
+struct String;
+
+// Process-wide pool of constant strings. Each distinct text is stored once
+// and stays valid until pool_free(), so values may borrow it without copying.
+// Every identifier in the tree is interned here, so two names are the same
+// identifier exactly when they are the same pointer.
+const char* pool_intern(const char* text);
+// Same for a slice that need not be NUL-terminated, such as a token lexeme
+const char* pool_intern_length(const char* text, int length);
+// The pooled string object itself, for constant values that borrow it
+struct String* pool_string(const char* text, int length);
+void pool_free(void);
+
+#endif // POOL_H
@@ -0,0 +1,16 @@
+#ifndef REDUCE_H
+#define REDUCE_H
+
+#include <stdbool.h>
+
+// Reductions over the int storage of a list, behind the list builtins. On
+// x86-64 they run on SSE2 vectors, or AVX2 ones when the CPU has them, and
+// elsewhere as plain loops. Sums wrap around like int addition does.
+int reduce_sum(const int* items, int count);
+// count must be at least 1
+int reduce_min(const int* items, int count);
+int reduce_max(const int* items, int count);
+// Position of the first item equal to value, or -1
+int reduce_index_of(const int* items, int count, int value);
+
+#endif // REDUCE_H
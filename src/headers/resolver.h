@@ -0,0 +1,10 @@
+#ifndef RESOLVER_H
+#define RESOLVER_H
+
+#include "ast.h"
+
+// Annotate every variable reference with its (depth, slot) lexical address
+// so the tree walker can index environments directly instead of by name.
+void resolve(Stmt** statements, int count);
+
+#endif // RESOLVER_H
@@ -0,0 +1,123 @@
+#ifndef RUNTIME_H
+#define RUNTIME_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "value.h"
+#include "native.h"
+
+// Support code for programs translated to C with --emit-c. A translated
+// program keeps int and bool variables in plain C ints and everything else
+// in Variables, and follows the semantics of the VM: helpers consume the
+// Variables they are given, and a runtime error ends the program.
+
+// C stack reserved per nested call of a translated function, and kept free
+// below the deepest one
+#define RT_FRAME_BYTES 8192
+#define RT_STACK_MARGIN (256 * 1024)
+
+extern Output rt_output;
+// Nested calls left before "Stack overflow", and the lowest C stack address
+// a call may start at
+extern int rt_calls_left;
+extern uintptr_t rt_stack_limit;
+
+// max_stack is the --max-stack the program was translated with
+void rt_init(int max_stack);
+// Run the top-level code on a thread whose stack is sized for max_stack
+// nested calls
+void rt_run(void (*script)(void));
+int rt_finish(void);
+
+// Report a runtime error at a source line, deliver the output printed so
+// far and exit
+_Noreturn void rt_error(int line, const char* format, ...);
+_Noreturn void rt_fail(int line);
+
+// Every translated function counts itself in and out of the call depth
+static inline void rt_enter(int line) {
+    char marker;
+    if (--rt_calls_left < 0 || (uintptr_t)&marker < rt_stack_limit) rt_error(line, "Stack overflow");
+}
+
+static inline void rt_leave(void) {
+    rt_calls_left++;
+}
+
+static inline Value rt_int(int value) {
+    Value result = {0};
+    result.type = TYPE_INT;
+    result.value.int_val = value;
+    return result;
+}
+
+static inline Value rt_bool(int value) {
+    Value result = {0};
+    result.type = TYPE_BOOL;
+    result.value.bool_val = value;
+    return result;
+}
+
+static inline Value rt_long(long value) {
+    Value result = {0};
+    result.type = TYPE_LONG;
+    result.value.long_val = value;
+    return result;
+}
+
+static inline Value rt_float(float value) {
+    Value result = {0};
+    result.type = TYPE_FLOAT;
+    result.value.float_val = value;
+    return result;
+}
+
+// String literals become constant string objects on first use and are
+// never freed
+static inline Value rt_string(String** constant, const char* text, int length) {
+    if (*constant == NULL) *constant = string_new(text, length);
+    return value_constant_string(*constant);
+}
+
+static inline int rt_divide(int line, int left, int right) {
+    if (right == 0) rt_error(line, "Division by zero");
+    return left / right;
+}
+
+static inline int rt_modulo(int line, int left, int right) {
+    if (right == 0) rt_error(line, "Modulo by zero");
+    return left % right;
+}
+
+static inline int rt_length(int line, Value* list) {
+    if (list->type != TYPE_LIST) rt_error(line, "Cannot access property on a non-list value");
+    return list->value.list_val->count;
+}
+
+Value rt_binary(int line, TokenType op, Value left, Value right);
+Value rt_negate(Value operand);
+bool rt_truthy(int line, Value condition);
+
+// Variable definitions coerce the value to the declared type
+int rt_define_int(int line, Value value, DataType type);
+void rt_define(int line, Value* target, DataType type, Value value);
+int rt_argument_int(int line, Value value, DataType type, int index, const char* function);
+Value rt_argument(int line, Value value, DataType type, int index, const char* function);
+
+// Assignments do not convert; a mismatch is reported and the target kept.
+// The assigned value stays with the caller.
+void rt_store_int(int* target, DataType type, Value value, const char* name);
+void rt_assign(Value* target, Value value, const char* name);
+// name = name + right[0] + ... on a string variable, taking the operands
+Value rt_append(int line, Value* target, Value left, Value* right, int count, const char* name);
+
+Value rt_get_index(int line, Value* list, Value index);
+Value rt_set_index(int line, Value* list, Value index, Value value);
+Value rt_list_add(int line, Value* list, Value item);
+Value rt_list_remove(int line, Value* list, Value index);
+Value rt_list_reserve(int line, Value* list, Value capacity);
+Value rt_list_sort(int line, Value* list, Value descending);
+
+Value rt_native(int line, const Native* native, Value* args, int count);
+
+#endif // RUNTIME_H
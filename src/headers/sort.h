@@ -0,0 +1,20 @@
+#ifndef SORT_H
+#define SORT_H
+
+#include <stdbool.h>
+#include "value.h"
+
+// Sort the items of a list in place. Number and bool lists go through an
+// LSD radix sort on their bit patterns, which is stable in either order;
+// floats and doubles order -0.0 before 0.0 and NaNs at the ends. String
+// lists go through an introsort on their bytes, where equal items cannot
+// be told apart.
+void sort_list(List* list, bool descending);
+
+// Searches over an int list sorted in ascending order: the first position
+// whose item is not less than (lower) or greater than (upper) value, or
+// count when there is none
+int sort_lower_bound(const int* items, int count, int value);
+int sort_upper_bound(const int* items, int count, int value);
+
+#endif // SORT_H
@@ -19,6 +19,8 @@ typedef enum {
     TOKEN_ADD,      // For list.add method
     TOKEN_REMOVE,   // For list.remove method
     TOKEN_LENGTH,   // For list.length property
+    TOKEN_RESERVE,  // For list.reserve method
+    TOKEN_SORT,     // For list.sort method
     TOKEN_INCLUDE,  // New keyword for including libraries
 
     // Identifiers and literals
@@ -60,9 +62,14 @@ typedef enum {
     TOKEN_ERROR
 } TokenType;
 
+// A token is a view into the source: lexeme points at its first character
+// and is not NUL-terminated. The AST constructors intern the lexemes they keep,
+// so tokens stored in the tree hold a NUL-terminated string that outlives the
+// source.
 typedef struct {
     TokenType type;
-    char* lexeme;
+    const char* lexeme;
+    int length;
     int line;
     int column;
 } Token;
@@ -0,0 +1,164 @@
+#ifndef VALUE_H
+#define VALUE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include "ast.h"
+#include "output.h"
+
+// Forward declarations
+struct Environment;
+typedef struct Environment Environment;
+struct Function;
+struct Native;
+
+// Strings are immutable heap objects shared by reference. The characters
+// follow the header in the same allocation and are NUL-terminated.
+typedef struct String {
+    int ref_count;
+    int length;
+    int capacity;       // Characters that fit before the string must grow
+    uint32_t hash;      // FNV-1a of the characters, 0 until first needed
+    char chars[];
+} String;
+
+// Strings this short are kept in the value itself instead
+#define STRING_INLINE_MAX 7
+
+// Lists are heap objects shared by reference. Elements are stored inline in
+// one buffer typed by item_type; bools are stored as ints and strings are
+// owned by the list. Removing an item near the front moves the start of the
+// list up instead of moving the rest down, so the buffer may begin with
+// free slots; items points at the first item, past them.
+typedef struct List {
+    int ref_count;
+    DataType item_type;
+    int count;
+    int capacity;       // Items that fit from the first one on
+    int offset;         // Free slots before the first item
+    union {
+        void* data;
+        int* ints;
+        float* floats;
+        long* longs;
+        double* doubles;
+        String** strings;
+    } items;
+} List;
+
+// What a function value calls. Created once per function definition and
+// shared by every copy of the value; whoever creates it owns it.
+typedef struct Callable {
+    FunctionStmt* declaration;
+    Environment* closure;
+    struct Function* compiled;  // Bytecode for the VM, NULL in the tree walker
+    const struct Native* native; // Builtin implemented in C, NULL otherwise
+} Callable;
+
+// A runtime value, 16 bytes so that results travel in two registers and
+// four slots share a cache line. Values carry no name: environments and the
+// VM keep the names of their slots on the side.
+typedef struct {
+    DataType type;
+    bool is_function;
+    bool is_constant;   // String borrowed from the constant pool, never released
+    bool is_object;     // String held by string_val; otherwise it is in inline_chars,
+                        // so a zeroed string value is the empty string
+    union {
+        int int_val;
+        float float_val;
+        String* string_val;
+        char inline_chars[STRING_INLINE_MAX + 1];
+        int bool_val;       // Boolean value (0 for false, 1 for true)
+        long long_val;      // Long integer value
+        double double_val;  // Double precision value
+        List* list_val;     // Counted reference to a list
+        Callable* function;
+    } value;
+} Value;
+
+_Static_assert(sizeof(Value) == 16, "Value must stay two words");
+
+// Value semantics shared by the tree-walking interpreter and the VM.
+// Helpers that can fail report the error on stderr and return false.
+Value value_default(DataType type);
+bool value_coerce(DataType type, Value* value);
+bool value_is_truthy(Value condition, bool* is_true);
+// Binary operators need operands of one type, except that an int meets a
+// long as a long and a float meets a double as a double (strings may also
+// be concatenated). value_binary_supported tells whether op is defined for
+// the operand type.
+bool value_common_type(DataType left, DataType right, DataType* type);
+bool value_binary_supported(TokenType op, DataType type);
+bool value_binary(TokenType op, Value left, Value right, Value* result);
+bool value_negate(Value operand, Value* result);
+// target = left + right[0] + ... + right[count - 1], where left was read
+// from target. When target still holds that string and every right operand
+// is a string, drops left and the operands and appends them to target, in
+// place if target holds the only reference, so a string built up by repeated
+// appends takes linear time. Returns false, leaving everything as it was,
+// otherwise.
+bool value_append(Value* target, Value left, Value* right, int count);
+void print_value(Output* output, Value value);
+
+// String operations. value_string makes an owned string value, inline when
+// it is short enough; value_constant_string borrows a string that outlives
+// every value, such as one from the constant pool.
+String* string_new(const char* chars, int length);
+void string_free(String* string);
+uint32_t string_hash(const char* chars, int length);
+Value value_string(const char* chars, int length);
+Value value_constant_string(String* string);
+
+static inline const char* value_chars(const Value* value) {
+    return value->is_object ? value->value.string_val->chars : value->value.inline_chars;
+}
+
+static inline int value_length(const Value* value) {
+    return value->is_object ? value->value.string_val->length : (int)strlen(value->value.inline_chars);
+}
+
+static inline void string_release(String* string) {
+    if (string != NULL && --string->ref_count == 0) string_free(string);
+}
+
+// List operations (the caller checks that the target is a list)
+List* list_new(void);
+void list_release(List* list);
+bool list_reserve(List* list, Value capacity);
+bool list_append(List* list, Value item);
+bool list_get(List* list, Value index, Value* result);
+bool list_set(List* list, Value index, Value value);
+bool list_remove(List* list, Value index);
+bool list_sort(List* list, Value descending);
+bool list_join(List* list, Value separator, Value* result);
+
+// Values hold a reference to their string or list: copying a value retains
+// it, releasing undoes it. Constant and inline strings own nothing.
+static inline Value value_copy(Value value) {
+    if (!value.is_function && !value.is_constant) {
+        if (value.type == TYPE_STRING && value.is_object) {
+            value.value.string_val->ref_count++;
+        } else if (value.type == TYPE_LIST && value.value.list_val != NULL) {
+            value.value.list_val->ref_count++;
+        }
+    }
+    return value;
+}
+
+static inline void value_release(Value* value) {
+    if (!value->is_function && !value->is_constant) {
+        if (value->type == TYPE_STRING && value->is_object) {
+            string_release(value->value.string_val);
+            value->value.string_val = NULL;
+            value->is_object = false;
+        } else if (value->type == TYPE_LIST) {
+            list_release(value->value.list_val);
+            value->value.list_val = NULL;
+        }
+    }
+}
+
+#endif // VALUE_H
@@ -0,0 +1,39 @@
+#ifndef VM_H
+#define VM_H
+
+#include <stdbool.h>
+#include "chunk.h"
+#include "compiler.h"
+
+// Both stacks start small and grow on demand, up to max_stack frames
+#define FRAMES_INITIAL 64
+// Value slots per frame beyond its locals, for temporaries
+#define FRAME_HEADROOM 256
+
+typedef struct {
+    Function* function;
+    uint8_t* ip;
+    Value* slots;   // First local slot of this activation
+} CallFrame;
+
+typedef struct {
+    CallFrame* frames;
+    int frame_count;
+    int frame_capacity;
+    int max_stack;         // Nested calls allowed before "Stack overflow"
+    Value* stack;
+    Value* stack_top;
+    size_t stack_capacity;
+    Value* globals;     // Indexed by the compiler's global slots
+    bool* defined;         // Whether each global has been defined yet
+    int global_count;
+    const char** global_names;
+    Output* output;        // Where print and println write
+    bool had_error;
+} VM;
+
+void vm_init(VM* vm, Output* output, int max_stack);
+void vm_interpret(VM* vm, Program* program);
+void vm_cleanup(VM* vm);
+
+#endif // VM_H
@@ -1,46 +1,132 @@
+#include <pthread.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/resource.h>
 #include "headers/interpreter.h"
-#include "headers/lexer.h"
-#include "headers/parser.h"
+#include "headers/module.h"
+#include "headers/resolver.h"
+#include "headers/native.h"
+#include "headers/jit.h"
+#include "headers/pool.h"
 
 // Forward declarations
-static void execute_stmt(Interpreter* interpreter, Stmt* stmt, bool* early_return, Variable* return_value);
-static void print_value(Variable arg);
 static void process_include(Interpreter* interpreter, const char* path);
-static char* get_lib_path(const char* filename);
-static char* read_file_content(const char* path);
+static Value evaluate_expr(Interpreter* interpreter, Expr* expr);
 
+// The global environment starts empty and grows by name
 static Environment* create_environment(Environment* enclosing) {
     Environment* env = malloc(sizeof(Environment));
     env->enclosing = enclosing;
     env->variables = NULL;
+    env->names = NULL;
     env->variable_count = 0;
+    env->capacity = 0;
     return env;
 }
 
-static void environment_define(Environment* env, const char* name, DataType type) {
+// Local environments are sized by the resolver and indexed by slot; their
+// variable names borrow the declaring token's lexeme. Nothing captures a
+// local environment once its scope exits, so released ones are kept on a
+// free list and reused instead of being allocated for every block.
+static Environment* acquire_environment(Interpreter* interpreter, Environment* enclosing, int size) {
+    Environment* env = interpreter->free_environments;
+    if (env != NULL) {
+        interpreter->free_environments = env->enclosing;
+    } else {
+        env = create_environment(NULL);
+    }
+    
+    if (size > env->capacity) {
+        env->variables = realloc(env->variables, sizeof(Value) * size);
+        env->names = realloc(env->names, sizeof(const char*) * size);
+        env->capacity = size;
+    }
+    if (size > 0) {
+        memset(env->variables, 0, sizeof(Value) * size);
+        memset(env->names, 0, sizeof(const char*) * size);
+    }
+    
+    env->enclosing = enclosing;
+    env->variable_count = size;
+    return env;
+}
+
+static void release_environment(Interpreter* interpreter, Environment* env) {
+    for (int i = 0; i < env->variable_count; i++) {
+        if (env->names[i] != NULL) {
+            value_release(&env->variables[i]);
+        }
+    }
+    
+    env->enclosing = interpreter->free_environments;
+    interpreter->free_environments = env;
+}
+
+static Environment* push_environment(Interpreter* interpreter, Environment* enclosing, int size) {
+    interpreter->environment = acquire_environment(interpreter, enclosing, size);
+    return interpreter->environment;
+}
+
+// Release the current local environment and return to the previous one
+static void pop_environment(Interpreter* interpreter, Environment* previous) {
+    release_environment(interpreter, interpreter->environment);
+    interpreter->environment = previous;
+}
+
+// Drop whatever a variable holds so it can be redeclared with another type
+static void reset_variable(Value* var) {
+    if (var->is_function) jit_invalidate();
+    value_release(var);
+    memset(&var->value, 0, sizeof(var->value));
+    var->is_function = false;
+    var->is_constant = false;
+    var->is_object = false;
+}
+
+// Returns the slot of the variable, defining it if it is new to this scope
+static int environment_define(Environment* env, const char* name, DataType type) {
     // Check if variable already exists in current scope
     for (int i = 0; i < env->variable_count; i++) {
-        if (strcmp(env->variables[i].name, name) == 0) {
+        if (env->names[i] == name) {
             // Variable already exists, update its type
+            if (env->variables[i].type != type) {
+                reset_variable(&env->variables[i]);
+            }
             env->variables[i].type = type;
-            return;
+            return i;
         }
     }
     
     // Add new variable
-    env->variables = realloc(env->variables, sizeof(Variable) * (env->variable_count + 1));
-    env->variables[env->variable_count].name = strdup(name);
+    env->variables = realloc(env->variables, sizeof(Value) * (env->variable_count + 1));
+    env->names = realloc(env->names, sizeof(const char*) * (env->variable_count + 1));
+    env->names[env->variable_count] = name;
     env->variables[env->variable_count].type = type;
+    memset(&env->variables[env->variable_count].value, 0, sizeof(env->variables[0].value));
     env->variables[env->variable_count].is_function = false;
-    env->variable_count++;
+    env->variables[env->variable_count].is_constant = false;
+    env->variables[env->variable_count].is_object = false;
+    return env->variable_count++;
 }
 
-static Variable* environment_get(Environment* env, const char* name) {
+static void environment_define_slot(Environment* env, int slot, const char* name, DataType type) {
+    Value* var = &env->variables[slot];
+    if (env->names[slot] == NULL) {
+        env->names[slot] = name;
+        memset(&var->value, 0, sizeof(var->value));
+        var->is_function = false;
+        var->is_constant = false;
+        var->is_object = false;
+    } else if (var->type != type) {
+        reset_variable(var);
+    }
+    var->type = type;
+}
+
+static Value* environment_get(Environment* env, const char* name) {
     for (int i = 0; i < env->variable_count; i++) {
-        if (strcmp(env->variables[i].name, name) == 0) {
+        if (env->names[i] == name) {
             return &env->variables[i];
         }
     }
@@ -52,96 +138,619 @@ static Variable* environment_get(Environment* env, const char* name) {
     return NULL;
 }
 
-static void environment_assign(Environment* env, const char* name, Variable value) {
-    for (int i = 0; i < env->variable_count; i++) {
-        if (strcmp(env->variables[i].name, name) == 0) {
-            if (env->variables[i].type != value.type && !value.is_function) {
-                fprintf(stderr, "Type mismatch in assignment to '%s'\n", name);
-                return;
-            }
-            
-            // Free old string value if necessary
-            if (env->variables[i].type == TYPE_STRING && !env->variables[i].is_function) {
-                free(env->variables[i].value.string_val);
-            }
-            
-            // Copy value
-            if (value.is_function) {
-                env->variables[i].is_function = true;
-                env->variables[i].value.function = value.value.function;
-            } else {
-                env->variables[i].is_function = false;
-                env->variables[i].value = value.value;
-                if (value.type == TYPE_STRING) {
-                    env->variables[i].value.string_val = strdup(value.value.string_val);
+static void variable_assign(Value* var, Value value, const char* name) {
+    if (var->type != value.type && !value.is_function) {
+        output_error("Type mismatch in assignment to '%s'\n", name);
+        return;
+    }
+    
+    // Code compiled against the function this held has to go
+    if (var->is_function && (!value.is_function || var->value.function != value.value.function)) {
+        jit_invalidate();
+    }
+    
+    // Free the old string or list reference
+    value_release(var);
+    
+    // Copy value
+    var->is_constant = false;
+    var->is_object = false;
+    if (value.is_function) {
+        var->is_function = true;
+        var->value.function = value.value.function;
+    } else {
+        var->is_function = false;
+        var->value = value_copy(value).value;
+        var->is_constant = value.is_constant;
+        var->is_object = value.is_object;
+    }
+}
+
+static void environment_assign(Environment* env, const char* name, Value value) {
+    Value* var = environment_get(env, name);
+    if (var == NULL) {
+        output_error("Undefined variable '%s'\n", name);
+        return;
+    }
+    variable_assign(var, value, name);
+}
+
+// Function values share one Callable per definition, owned by the interpreter
+static Callable* new_callable(Interpreter* interpreter) {
+    if (interpreter->callable_count == interpreter->callable_capacity) {
+        interpreter->callable_capacity = interpreter->callable_capacity < 8 ? 8 : interpreter->callable_capacity * 2;
+        interpreter->callables = realloc(interpreter->callables, sizeof(Callable*) * interpreter->callable_capacity);
+    }
+    Callable* callable = calloc(1, sizeof(Callable));
+    interpreter->callables[interpreter->callable_count++] = callable;
+    return callable;
+}
+
+// Find the storage for a resolved variable reference, or NULL if it is undefined
+static Value* lookup_variable(Interpreter* interpreter, const char* name, int depth, int* slot) {
+    if (depth < 0) {
+        // Global slots never move once defined, so the first lookup is cached
+        if (*slot < 0) {
+            Environment* globals = interpreter->globals;
+            for (int i = 0; i < globals->variable_count; i++) {
+                if (globals->names[i] == name) {
+                    *slot = i;
+                    break;
                 }
             }
-            return;
+            if (*slot < 0) return NULL;
         }
+        return &interpreter->globals->variables[*slot];
     }
     
-    if (env->enclosing != NULL) {
-        environment_assign(env->enclosing, name, value);
-        return;
+    Environment* env = interpreter->environment;
+    for (int i = 0; i < depth; i++) {
+        env = env->enclosing;
     }
     
-    fprintf(stderr, "Undefined variable '%s'\n", name);
+    return env->names[*slot] != NULL ? &env->variables[*slot] : NULL;
 }
 
 static void free_environment(Environment* env) {
     for (int i = 0; i < env->variable_count; i++) {
-        free(env->variables[i].name);
-        
-        if (!env->variables[i].is_function) {
-            if (env->variables[i].type == TYPE_STRING) {
-                free(env->variables[i].value.string_val);
-            } else if (env->variables[i].type == TYPE_LIST) {
-                // Free all items in the list
-                for (int j = 0; j < env->variables[i].value.list_val.count; j++) {
-                    // For string items, we need to free the string content
-                    if (env->variables[i].value.list_val.item_type == TYPE_STRING) {
-                        free(env->variables[i].value.list_val.items[j]);
-                    } else {
-                        // For other types, we allocated memory for the value itself
-                        free(env->variables[i].value.list_val.items[j]);
-                    }
-                }
-                
-                // Free the array of item pointers
-                free(env->variables[i].value.list_val.items);
-            }
-        }
+        value_release(&env->variables[i]);
     }
     
     free(env->variables);
+    free(env->names);
     free(env);
 }
 
-static Variable evaluate_expr(Interpreter* interpreter, Expr* expr) {
-    Variable result = {0};
+// Run a quickened binary node on operands of the type it was specialized
+// for. Returns false for a zero divisor, leaving the generic path to report it.
+static inline bool run_quickened(BinaryKind kind, Value left, Value right, Value* result) {
+    // Comparisons produce ints, arithmetic keeps the operand type
+    result->type = TYPE_INT;
     
+    if (kind < BINARY_FLOAT_ADD) {
+        int a = left.value.int_val;
+        int b = right.value.int_val;
+        switch (kind) {
+            case BINARY_INT_ADD:           result->value.int_val = a + b; break;
+            case BINARY_INT_SUBTRACT:      result->value.int_val = a - b; break;
+            case BINARY_INT_MULTIPLY:      result->value.int_val = a * b; break;
+            case BINARY_INT_DIVIDE:
+                if (b == 0) return false;
+                result->value.int_val = a / b;
+                break;
+            case BINARY_INT_MODULO:
+                if (b == 0) return false;
+                result->value.int_val = a % b;
+                break;
+            case BINARY_INT_EQUAL:         result->value.int_val = a == b; break;
+            case BINARY_INT_NOT_EQUAL:     result->value.int_val = a != b; break;
+            case BINARY_INT_LESS:          result->value.int_val = a < b; break;
+            case BINARY_INT_LESS_EQUAL:    result->value.int_val = a <= b; break;
+            case BINARY_INT_GREATER:       result->value.int_val = a > b; break;
+            case BINARY_INT_GREATER_EQUAL: result->value.int_val = a >= b; break;
+            default:                       return false;
+        }
+        return true;
+    }
+    
+    if (kind < BINARY_LONG_ADD) {
+        float a = left.value.float_val;
+        float b = right.value.float_val;
+        switch (kind) {
+            case BINARY_FLOAT_ADD:           result->type = TYPE_FLOAT; result->value.float_val = a + b; break;
+            case BINARY_FLOAT_SUBTRACT:      result->type = TYPE_FLOAT; result->value.float_val = a - b; break;
+            case BINARY_FLOAT_MULTIPLY:      result->type = TYPE_FLOAT; result->value.float_val = a * b; break;
+            case BINARY_FLOAT_DIVIDE:
+                if (b == 0.0) return false;
+                result->type = TYPE_FLOAT;
+                result->value.float_val = a / b;
+                break;
+            case BINARY_FLOAT_EQUAL:         result->value.int_val = a == b; break;
+            case BINARY_FLOAT_NOT_EQUAL:     result->value.int_val = a != b; break;
+            case BINARY_FLOAT_LESS:          result->value.int_val = a < b; break;
+            case BINARY_FLOAT_LESS_EQUAL:    result->value.int_val = a <= b; break;
+            case BINARY_FLOAT_GREATER:       result->value.int_val = a > b; break;
+            case BINARY_FLOAT_GREATER_EQUAL: result->value.int_val = a >= b; break;
+            default:                         return false;
+        }
+        return true;
+    }
+    
+    if (kind < BINARY_DOUBLE_ADD) {
+        long a = left.value.long_val;
+        long b = right.value.long_val;
+        switch (kind) {
+            case BINARY_LONG_ADD:           result->type = TYPE_LONG; result->value.long_val = a + b; break;
+            case BINARY_LONG_SUBTRACT:      result->type = TYPE_LONG; result->value.long_val = a - b; break;
+            case BINARY_LONG_MULTIPLY:      result->type = TYPE_LONG; result->value.long_val = a * b; break;
+            case BINARY_LONG_DIVIDE:
+                if (b == 0) return false;
+                result->type = TYPE_LONG;
+                result->value.long_val = a / b;
+                break;
+            case BINARY_LONG_MODULO:
+                if (b == 0) return false;
+                result->type = TYPE_LONG;
+                result->value.long_val = a % b;
+                break;
+            case BINARY_LONG_EQUAL:         result->value.int_val = a == b; break;
+            case BINARY_LONG_NOT_EQUAL:     result->value.int_val = a != b; break;
+            case BINARY_LONG_LESS:          result->value.int_val = a < b; break;
+            case BINARY_LONG_LESS_EQUAL:    result->value.int_val = a <= b; break;
+            case BINARY_LONG_GREATER:       result->value.int_val = a > b; break;
+            case BINARY_LONG_GREATER_EQUAL: result->value.int_val = a >= b; break;
+            default:                        return false;
+        }
+        return true;
+    }
+    
+    double a = left.value.double_val;
+    double b = right.value.double_val;
+    switch (kind) {
+        case BINARY_DOUBLE_ADD:           result->type = TYPE_DOUBLE; result->value.double_val = a + b; break;
+        case BINARY_DOUBLE_SUBTRACT:      result->type = TYPE_DOUBLE; result->value.double_val = a - b; break;
+        case BINARY_DOUBLE_MULTIPLY:      result->type = TYPE_DOUBLE; result->value.double_val = a * b; break;
+        case BINARY_DOUBLE_DIVIDE:
+            if (b == 0.0) return false;
+            result->type = TYPE_DOUBLE;
+            result->value.double_val = a / b;
+            break;
+        case BINARY_DOUBLE_EQUAL:         result->value.int_val = a == b; break;
+        case BINARY_DOUBLE_NOT_EQUAL:     result->value.int_val = a != b; break;
+        case BINARY_DOUBLE_LESS:          result->value.int_val = a < b; break;
+        case BINARY_DOUBLE_LESS_EQUAL:    result->value.int_val = a <= b; break;
+        case BINARY_DOUBLE_GREATER:       result->value.int_val = a > b; break;
+        case BINARY_DOUBLE_GREATER_EQUAL: result->value.int_val = a >= b; break;
+        default:                          return false;
+    }
+    return true;
+}
+
+// Calls do not nest on the C stack. A statement or expression that contains
+// a call becomes a task on the interpreter's task stack, revisited with its
+// step advanced until it is done, while its operands wait on the value stack.
+// Those without calls run directly.
+typedef enum {
+    TASK_FRAME,      // Bottom of a frame, reached when its statements run out
+    TASK_BLOCK,      // Runs the statements of a block, the step-th one next
+    TASK_WHILE,
+    TASK_FOR,
+    TASK_IF,         // The condition is on the value stack
+    TASK_VAR_DECL,   // The initializer is on the value stack, step holds the slot
+    TASK_DISCARD,    // Drops the value of an expression statement
+    TASK_RETURN,     // Returns the value on the value stack
+    TASK_INCLUDE,    // Runs the statements of an included file, the step-th one next
+    TASK_EXPR        // Evaluates an expression that contains a call
+} TaskKind;
+
+// Steps of a for loop
+enum {
+    FOR_INIT,
+    FOR_TEST,
+    FOR_CONDITION,   // The condition is on the value stack
+    FOR_INCREMENT,
+    FOR_NEXT         // The increment's value is on the value stack
+};
+
+struct Task {
+    TaskKind kind;
+    int step;
+    bool tail;       // A call returned by the statement below it
+    bool append;     // An assignment that appends to its string variable
+    union {
+        Stmt* stmt;
+        Expr* expr;
+        Module* module;
+    } as;
+};
+
+static Task* push_task(Interpreter* interpreter, TaskKind kind) {
+    if (interpreter->task_count == interpreter->task_capacity) {
+        interpreter->task_capacity = interpreter->task_capacity < 64 ? 64 : interpreter->task_capacity * 2;
+        interpreter->tasks = realloc(interpreter->tasks, sizeof(Task) * interpreter->task_capacity);
+    }
+
+    Task* task = &interpreter->tasks[interpreter->task_count++];
+    task->kind = kind;
+    task->step = 0;
+    task->tail = false;
+    task->append = false;
+    return task;
+}
+
+static inline void push_value(Interpreter* interpreter, Value value) {
+    if (interpreter->value_count == interpreter->value_capacity) {
+        interpreter->value_capacity = interpreter->value_capacity < 64 ? 64 : interpreter->value_capacity * 2;
+        interpreter->values = realloc(interpreter->values, sizeof(Value) * interpreter->value_capacity);
+    }
+    interpreter->values[interpreter->value_count++] = value;
+}
+
+static inline Value pop_value(Interpreter* interpreter) {
+    return interpreter->values[--interpreter->value_count];
+}
+
+// Leave the value of an expression on the value stack and return true if it
+// makes no call; otherwise push a task that will, and return false
+static bool push_expr(Interpreter* interpreter, Expr* expr) {
+    if (!expr->calls) {
+        push_value(interpreter, evaluate_expr(interpreter, expr));
+        return true;
+    }
+    push_task(interpreter, TASK_EXPR)->as.expr = expr;
+    return false;
+}
+
+// Report a stack overflow. The run stops, and interpreter_interpret releases
+// everything the frames in progress hold.
+static void stack_overflow(Interpreter* interpreter) {
+    output_error("Stack overflow\n");
+    interpreter->had_error = true;
+    interpreter->overflowed = true;
+}
+
+static Frame* push_frame(Interpreter* interpreter, FrameKind kind) {
+    if (interpreter->frame_count == interpreter->frame_capacity) {
+        interpreter->frame_capacity = interpreter->frame_capacity < 64 ? 64 : interpreter->frame_capacity * 2;
+        interpreter->frames = realloc(interpreter->frames, sizeof(Frame) * interpreter->frame_capacity);
+    }
+
+    Frame* frame = &interpreter->frames[interpreter->frame_count++];
+    frame->kind = kind;
+    frame->function = NULL;
+    frame->caller = interpreter->environment;
+    frame->base = interpreter->environment;
+    frame->task_base = interpreter->task_count;
+    frame->interpreted = false;
+    push_task(interpreter, TASK_FRAME);
+    return frame;
+}
+
+// Leave the frame on top with the value its return statement produced, or
+// a TYPE_VOID value without one. A call hands its result to the expression
+// that made it; main and top-level statements drop it.
+static void return_from_frame(Interpreter* interpreter, Value value) {
+    Frame* frame = &interpreter->frames[interpreter->frame_count - 1];
+    while (interpreter->environment != frame->base) {
+        pop_environment(interpreter, interpreter->environment->enclosing);
+    }
+    interpreter->task_count = frame->task_base;
+    interpreter->frame_count--;
+
+    if (frame->kind != FRAME_CALL) {
+        value_release(&value);
+        return;
+    }
+
+    pop_environment(interpreter, frame->caller);
+    interpreter->depth--;
+    // Without a returned value the function returns its type's default value
+    push_value(interpreter, value.type != TYPE_VOID ? value : value_default(frame->function->return_type));
+}
+
+static void execute_stmt(Interpreter* interpreter, Stmt* stmt);
+
+// Start a call to a user function. The arguments, evaluated in the caller's
+// environment, are already in the first slots of env; arguments the function
+// has no parameter for were dropped. A tail call takes over the frame of the
+// call that is returning, so tail recursion does not get any deeper.
+static void enter_call(Interpreter* interpreter, Callable* callee, Environment* env, int arg_count, bool tail) {
+    Frame* frame = interpreter->frame_count > 0 ? &interpreter->frames[interpreter->frame_count - 1] : NULL;
+    if (tail && frame != NULL && frame->kind == FRAME_CALL) {
+        while (interpreter->environment != frame->base) {
+            pop_environment(interpreter, interpreter->environment->enclosing);
+        }
+        pop_environment(interpreter, frame->caller);
+        interpreter->task_count = frame->task_base + 1;
+    } else {
+        if (interpreter->depth == interpreter->max_stack) {
+            release_environment(interpreter, env);
+            stack_overflow(interpreter);
+            return;
+        }
+        bool interpreted = frame != NULL && frame->interpreted;
+        frame = push_frame(interpreter, FRAME_CALL);
+        frame->interpreted = interpreted;
+        interpreter->depth++;
+    }
+
+    FunctionStmt* func = callee->declaration;
+    frame->function = func;
+    frame->base = env;
+    interpreter->environment = env;
+    if (arg_count > func->param_count) {
+        arg_count = func->param_count;
+    }
+
+    // Parameters occupy the first slots and take the argument values over
+    bool coerced = true;
+    for (int i = 0; i < arg_count; i++) {
+        Value* param = &env->variables[i];
+        if (!value_coerce(func->param_types[i], param)) {
+            output_error("Type mismatch in argument %d of '%s'\n", i + 1, func->name.lexeme);
+            interpreter->had_error = true;
+            value_release(param);
+            *param = value_default(func->param_types[i]);
+            coerced = false;
+        }
+        env->names[i] = func->params[i].lexeme;
+    }
+
+    // Hot functions are handed to the JIT, which declines what it cannot translate
+    if (interpreter->jit && func->jit == NULL && ++func->call_count >= JIT_THRESHOLD) {
+        jit_compile(func, interpreter->globals);
+    }
+    if (func->jit != NULL && coerced && arg_count == func->param_count && !frame->interpreted) {
+        Value result;
+        JitOutcome outcome = jit_call(func, env->variables, interpreter->max_stack - interpreter->depth,
+                                      interpreter->stack_limit, &result);
+        if (outcome == JIT_RETURNED) {
+            return_from_frame(interpreter, result);
+            return;
+        }
+        if (outcome == JIT_STACK_OVERFLOW) {
+            stack_overflow(interpreter);
+            return;
+        }
+        // Recursion deeper than the C stack holds goes on in the interpreter
+        frame->interpreted = outcome == JIT_OUT_OF_STACK;
+    }
+
+    execute_stmt(interpreter, func->body);
+}
+
+// Make a call whose callee and arguments are on top of the value stack
+static void call_value(Interpreter* interpreter, int arg_count, bool tail) {
+    Value* args = &interpreter->values[interpreter->value_count - arg_count];
+    Callable* callee = args[-1].value.function;
+
+    if (callee->native != NULL) {
+        // Builtins take their arguments straight off the value stack
+        Value result;
+        if (!native_call(callee->native, interpreter->output, args, arg_count, &result)) {
+            interpreter->had_error = true;
+            result = value_default(TYPE_VOID);
+        }
+        for (int i = 0; i < arg_count; i++) {
+            value_release(&args[i]);
+        }
+        interpreter->value_count -= arg_count + 1;
+        push_value(interpreter, result);
+        return;
+    }
+
+    FunctionStmt* func = callee->declaration;
+    int size = func->scope_size > arg_count ? func->scope_size : arg_count;
+    Environment* env = acquire_environment(interpreter, callee->closure, size);
+    for (int i = 0; i < arg_count; i++) {
+        env->variables[i] = args[i];
+        if (i >= func->param_count) {
+            value_release(&env->variables[i]);
+            memset(&env->variables[i], 0, sizeof(Value));
+        }
+    }
+    interpreter->value_count -= arg_count + 1;
+    enter_call(interpreter, callee, env, arg_count, tail);
+}
+
+// name = name + a + b ... on a string variable. The variable's value was
+// read before any operand was evaluated, as in any other assignment, and
+// the additions follow.
+static Value append_string(Interpreter* interpreter, AssignExpr* assign, Value left, Value* right, int count) {
+    Value* target = lookup_variable(interpreter, assign->name.lexeme, assign->depth, &assign->slot);
+    if (value_append(target, left, right, count)) return value_copy(*target);
+
+    bool ok = true;
+    for (int i = 0; i < count; i++) {
+        Value sum = {0};
+        if (ok && !value_binary(TOKEN_PLUS, left, right[i], &sum)) {
+            ok = false;
+            sum = (Value){0};
+        }
+        value_release(&left);
+        value_release(&right[i]);
+        left = sum;
+    }
+    if (!ok) {
+        interpreter->had_error = true;
+        return value_default(TYPE_VOID);
+    }
+    variable_assign(target, left, assign->name.lexeme);
+    return left;
+}
+
+// The operands an assignment appends to its string variable, or 0 if it is
+// an ordinary assignment
+static int append_operands(Interpreter* interpreter, Expr* expr, Expr** operands) {
+    AssignExpr* assign = &expr->as.assign;
+    // An assignment the checker typed as anything but a string is no append
+    if (expr->typed && expr->value_type != TYPE_STRING) return 0;
+
+    int count = assign_append_operands(assign, operands);
+    if (count == 0) return 0;
+    Value* target = lookup_variable(interpreter, assign->name.lexeme, assign->depth, &assign->slot);
+    return target != NULL && target->type == TYPE_STRING && !target->is_function ? count : 0;
+}
+
+static Value assign_variable(AssignExpr* assign, Value value, Interpreter* interpreter) {
+    Value* target = lookup_variable(interpreter, assign->name.lexeme, assign->depth, &assign->slot);
+    if (target == NULL) {
+        output_error("Undefined variable '%s'\n", assign->name.lexeme);
+    } else {
+        variable_assign(target, value, assign->name.lexeme);
+    }
+    return value;
+}
+
+// The variable a list expression names, or NULL after reporting it undefined
+static Value* list_lookup(Interpreter* interpreter, Expr* list) {
+    VariableExpr* list_var = &list->as.variable;
+    Value* list_ptr = lookup_variable(interpreter, list_var->name.lexeme, list_var->depth, &list_var->slot);
+    if (!list_ptr) {
+        output_error("Undefined variable '%s'\n", list_var->name.lexeme);
+        interpreter->had_error = true;
+    }
+    return list_ptr;
+}
+
+// The list a list expression works on, or NULL after reporting why there is none
+static Value* list_variable(Interpreter* interpreter, Expr* list, const char* message) {
+    Value* list_ptr = list_lookup(interpreter, list);
+    if (list_ptr == NULL) return NULL;
+    if (list_ptr->type != TYPE_LIST) {
+        output_error("%s\n", message);
+        interpreter->had_error = true;
+        return NULL;
+    }
+    return list_ptr;
+}
+
+// list[index] = value. Whether the variable holds a list is only checked
+// once both are evaluated.
+static Value assign_index(Interpreter* interpreter, Expr* list, Value index, Value value) {
+    Value* list_ptr = list_variable(interpreter, list, "Cannot assign to index of non-list value");
+    if (list_ptr == NULL || !list_set(list_ptr->value.list_val, index, value)) {
+        interpreter->had_error = true;
+        value_release(&index);
+        value_release(&value);
+        return (Value){0};
+    }
+
+    // Return the assigned value
+    return value;
+}
+
+static Value get_index(Interpreter* interpreter, Value* list_ptr, Value index) {
+    Value result;
+    if (!list_get(list_ptr->value.list_val, index, &result)) {
+        interpreter->had_error = true;
+        // Default type for error recovery
+        result = (Value){0};
+    }
+    return result;
+}
+
+// Run list.add, list.remove, list.reserve or list.sort, which return nothing
+static Value call_list_method(Interpreter* interpreter, TokenType method, Value* list_ptr, Value argument) {
+    bool ok = true;
+    if (method == TOKEN_ADD) {
+        ok = list_append(list_ptr->value.list_val, argument);
+        value_release(&argument);
+    } else if (method == TOKEN_REMOVE) {
+        ok = list_remove(list_ptr->value.list_val, argument);
+    } else if (method == TOKEN_RESERVE) {
+        ok = list_reserve(list_ptr->value.list_val, argument);
+    } else if (method == TOKEN_SORT) {
+        ok = list_sort(list_ptr->value.list_val, argument);
+    }
+    if (!ok) {
+        interpreter->had_error = true;
+    }
+
+    Value result = {0};
+    result.type = TYPE_VOID;
+    return result;
+}
+
+static Value list_method_error(void) {
+    Value result = {0};
+    result.type = TYPE_VOID;
+    return result;
+}
+
+static Value evaluate_binary(Interpreter* interpreter, BinaryExpr* binary, Value left, Value right) {
+    Value result = {0};
+
+    // A quickened node skips the generic type dispatch while its
+    // guard holds, and turns generic again when it fails. Operand
+    // types the checker proved need no guard.
+    if (binary->kind != BINARY_GENERIC) {
+        DataType type = binary_kind_type(binary->kind);
+        if ((binary->checked || (left.type == type && right.type == type)) &&
+            run_quickened(binary->kind, left, right, &result)) {
+            return result;
+        }
+        if (!binary->checked) {
+            binary->kind = BINARY_GENERIC;
+            binary->deopts++;
+        }
+    }
+
+    // The operands are released whatever the result, so comparing
+    // strings does not keep them alive
+    bool ok = value_binary(binary->operator.type, left, right, &result);
+    value_release(&left);
+    value_release(&right);
+    if (!ok) {
+        interpreter->had_error = true;
+        return result;
+    }
+
+    if (binary->kind == BINARY_GENERIC && left.type == right.type && binary->deopts < BINARY_MAX_DEOPTS) {
+        binary->kind = binary_kind(binary->operator.type, left.type);
+    }
+    return result;
+}
+
+static Value evaluate_unary(Interpreter* interpreter, UnaryExpr* unary, Value operand) {
+    Value result = {0};
+    switch (unary->operator.type) {
+        case TOKEN_MINUS:
+            value_negate(operand, &result);
+            break;
+        default:
+            output_error("Invalid unary operator\n");
+            interpreter->had_error = true;
+    }
+    return result;
+}
+
+// Evaluate an expression that makes no call
+static Value evaluate_expr(Interpreter* interpreter, Expr* expr) {
+    Value result = {0};
+
     switch (expr->type) {
         case EXPR_LITERAL: {
-            Token* token = expr->as.literal.value;
-            switch (token->type) {
-                case TOKEN_INTEGER_LITERAL:
-                    result.type = TYPE_INT;
-                    result.value.int_val = atoi(token->lexeme);
+            LiteralExpr* literal = &expr->as.literal;
+            result.type = literal->type;
+            switch (literal->type) {
+                case TYPE_INT:
+                    result.value.int_val = literal->as.int_val;
                     break;
-                case TOKEN_FLOAT_LITERAL:
-                    result.type = TYPE_FLOAT;
-                    result.value.float_val = atof(token->lexeme);
+                case TYPE_LONG:
+                    result.value.long_val = literal->as.long_val;
+                    break;
+                case TYPE_FLOAT:
+                    result.value.float_val = literal->as.float_val;
                     break;
-                case TOKEN_STRING_LITERAL:
-                    result.type = TYPE_STRING;
-                    result.value.string_val = strdup(token->lexeme);
+                case TYPE_STRING:
+                    result = value_constant_string(literal->as.string_val);
                     break;
-                case TOKEN_BOOL_LITERAL:
-                    result.type = TYPE_BOOL;
-                    result.value.bool_val = (strcmp(token->lexeme, "true") == 0) ? 1 : 0;
+                case TYPE_BOOL:
+                    result.value.bool_val = literal->as.bool_val;
                     break;
                 default:
-                    fprintf(stderr, "Invalid literal type: %d\n", token->type);
+                    output_error("Invalid literal type: %d\n", literal->value.type);
                     interpreter->had_error = true;
             }
             result.is_function = false;
@@ -149,268 +758,32 @@ static Variable evaluate_expr(Interpreter* interpreter, Expr* expr) {
         }
         case EXPR_BINARY: {
             // Special case for list index assignment
-            if (expr->as.binary.operator.type == TOKEN_ASSIGN && 
-                expr->as.binary.left->type == EXPR_LIST_ACCESS) {
-                
-                // Get the list variable
-                VariableExpr list_var = expr->as.binary.left->as.list_access.list->as.variable;
-                Variable* list_ptr = environment_get(interpreter->environment, list_var.name.lexeme);
-                
-                if (!list_ptr) {
-                    fprintf(stderr, "Undefined variable '%s'\n", list_var.name.lexeme);
-                    interpreter->had_error = true;
-                    result.type = TYPE_INT; // Default type for error recovery
-                    result.is_function = false;
-                    result.value.int_val = 0;
-                    break;
-                }
-                
-                // Get the index
-                Variable index = evaluate_expr(interpreter, expr->as.binary.left->as.list_access.index);
-                // Get the value to assign
-                Variable value = evaluate_expr(interpreter, expr->as.binary.right);
-                
-                // Check that we're working with a list
-                if (list_ptr->type != TYPE_LIST) {
-                    fprintf(stderr, "Cannot assign to index of non-list value\n");
-                    interpreter->had_error = true;
-                    break;
-                }
-                
-                // Check that the index is an integer
-                if (index.type != TYPE_INT) {
-                    fprintf(stderr, "List index must be an integer\n");
-                    interpreter->had_error = true;
-                    break;
-                }
-                
-                // Check that the index is in range
-                int idx = index.value.int_val;
-                if (idx < 0 || idx >= list_ptr->value.list_val.count) {
-                    fprintf(stderr, "List index out of bounds: %d (size: %d)\n", 
-                            idx, list_ptr->value.list_val.count);
-                    interpreter->had_error = true;
-                    break;
-                }
-                
-                // Check that the value type matches the list item type
-                if (value.type != list_ptr->value.list_val.item_type) {
-                    fprintf(stderr, "Cannot assign value of type %d to list of type %d\n", 
-                            value.type, list_ptr->value.list_val.item_type);
-                    interpreter->had_error = true;
-                    break;
-                }
-                
-                // Free the old item (if it's a string, we need to free the memory)
-                if (list_ptr->value.list_val.item_type == TYPE_STRING) {
-                    free(list_ptr->value.list_val.items[idx]);
-                } else {
-                    free(list_ptr->value.list_val.items[idx]);
-                }
-                
-                // Replace with the new value
-                switch (value.type) {
-                    case TYPE_INT: {
-                        int* new_item = malloc(sizeof(int));
-                        *new_item = value.value.int_val;
-                        list_ptr->value.list_val.items[idx] = new_item;
-                        break;
-                    }
-                    case TYPE_FLOAT: {
-                        float* new_item = malloc(sizeof(float));
-                        *new_item = value.value.float_val;
-                        list_ptr->value.list_val.items[idx] = new_item;
-                        break;
-                    }
-                    case TYPE_STRING: {
-                        list_ptr->value.list_val.items[idx] = strdup(value.value.string_val);
-                        break;
-                    }
-                    case TYPE_BOOL: {
-                        int* new_item = malloc(sizeof(int));
-                        *new_item = value.value.bool_val;
-                        list_ptr->value.list_val.items[idx] = new_item;
-                        break;
-                    }
-                    case TYPE_LONG: {
-                        long* new_item = malloc(sizeof(long));
-                        *new_item = value.value.long_val;
-                        list_ptr->value.list_val.items[idx] = new_item;
-                        break;
-                    }
-                    case TYPE_DOUBLE: {
-                        double* new_item = malloc(sizeof(double));
-                        *new_item = value.value.double_val;
-                        list_ptr->value.list_val.items[idx] = new_item;
-                        break;
-                    }
-                    default:
-                        fprintf(stderr, "Unsupported type for list assignment\n");
-                        interpreter->had_error = true;
-                        break;
-                }
-                
-                // Return the assigned value
-                result = value;
-                
+            if (expr->as.binary.operator.type == TOKEN_ASSIGN && expr->as.binary.left->type == EXPR_LIST_ACCESS) {
+                Expr* target = expr->as.binary.left;
+                if (list_lookup(interpreter, target->as.list_access.list) == NULL) break;
+                Value index = evaluate_expr(interpreter, target->as.list_access.index);
+                Value value = evaluate_expr(interpreter, expr->as.binary.right);
+                result = assign_index(interpreter, target->as.list_access.list, index, value);
                 break;
             }
-            
+
             // Regular binary expression
-            Variable left = evaluate_expr(interpreter, expr->as.binary.left);
-            Variable right = evaluate_expr(interpreter, expr->as.binary.right);
-            
-            result.is_function = false;
-            
-            // Special handling for string concatenation
-            if (expr->as.binary.operator.type == TOKEN_PLUS && left.type == TYPE_STRING && right.type == TYPE_STRING) {
-                result.type = TYPE_STRING;
-                // Allocate enough space for both strings plus null terminator
-                size_t len1 = strlen(left.value.string_val);
-                size_t len2 = strlen(right.value.string_val);
-                result.value.string_val = malloc(len1 + len2 + 1);
-                
-                // Concatenate the strings
-                strcpy(result.value.string_val, left.value.string_val);
-                strcat(result.value.string_val, right.value.string_val);
-                
-                // Free the original strings
-                free(left.value.string_val);
-                free(right.value.string_val);
-                break;
-            }
-            
-            // Regular numeric operations
-            if (left.type != right.type) {
-                fprintf(stderr, "Operands must be of the same type\n");
-                interpreter->had_error = true;
-                break;
-            }
-            
-            result.type = TYPE_INT;  // All comparison operators return int (boolean)
-            
-            switch (expr->as.binary.operator.type) {
-                case TOKEN_PLUS:
-                    result.type = left.type;
-                    if (left.type == TYPE_INT)
-                        result.value.int_val = left.value.int_val + right.value.int_val;
-                    else if (left.type == TYPE_FLOAT)
-                        result.value.float_val = left.value.float_val + right.value.float_val;
-                    else if (left.type == TYPE_LONG)
-                        result.value.int_val = left.value.int_val + right.value.int_val; // Using int_val for longs too
-                    else if (left.type == TYPE_DOUBLE)
-                        result.value.float_val = left.value.float_val + right.value.float_val; // Using float_val for doubles too
-                    break;
-                case TOKEN_MINUS:
-                    result.type = left.type;
-                    if (left.type == TYPE_INT)
-                        result.value.int_val = left.value.int_val - right.value.int_val;
-                    else if (left.type == TYPE_FLOAT)
-                        result.value.float_val = left.value.float_val - right.value.float_val;
-                    break;
-                case TOKEN_MULTIPLY:
-                    result.type = left.type;
-                    if (left.type == TYPE_INT)
-                        result.value.int_val = left.value.int_val * right.value.int_val;
-                    else if (left.type == TYPE_FLOAT)
-                        result.value.float_val = left.value.float_val * right.value.float_val;
-                    break;
-                case TOKEN_DIVIDE:
-                    result.type = left.type;
-                    if (left.type == TYPE_INT) {
-                        if (right.value.int_val == 0) {
-                            fprintf(stderr, "Division by zero\n");
-                            interpreter->had_error = true;
-                            break;
-                        }
-                        result.value.int_val = left.value.int_val / right.value.int_val;
-                    } else if (left.type == TYPE_FLOAT) {
-                        if (right.value.float_val == 0.0) {
-                            fprintf(stderr, "Division by zero\n");
-                            interpreter->had_error = true;
-                            break;
-                        }
-                        result.value.float_val = left.value.float_val / right.value.float_val;
-                    }
-                    break;
-                case TOKEN_MODULO:
-                    result.type = left.type;
-                    if (left.type == TYPE_INT) {
-                        if (right.value.int_val == 0) {
-                            fprintf(stderr, "Modulo by zero\n");
-                            interpreter->had_error = true;
-                            break;
-                        }
-                        result.value.int_val = left.value.int_val % right.value.int_val;
-                    } else if (left.type == TYPE_FLOAT) {
-                        fprintf(stderr, "Modulo operation not supported for float values\n");
-                        interpreter->had_error = true;
-                    }
-                    break;
-                case TOKEN_EQUALS:
-                    if (left.type == TYPE_INT)
-                        result.value.int_val = left.value.int_val == right.value.int_val;
-                    else if (left.type == TYPE_FLOAT)
-                        result.value.int_val = left.value.float_val == right.value.float_val;
-                    break;
-                case TOKEN_NOT_EQUALS:
-                    if (left.type == TYPE_INT)
-                        result.value.int_val = left.value.int_val != right.value.int_val;
-                    else if (left.type == TYPE_FLOAT)
-                        result.value.int_val = left.value.float_val != right.value.float_val;
-                    break;
-                case TOKEN_LESS:
-                    if (left.type == TYPE_INT)
-                        result.value.int_val = left.value.int_val < right.value.int_val;
-                    else if (left.type == TYPE_FLOAT)
-                        result.value.int_val = left.value.float_val < right.value.float_val;
-                    break;
-                case TOKEN_LESS_EQUAL:
-                    if (left.type == TYPE_INT)
-                        result.value.int_val = left.value.int_val <= right.value.int_val;
-                    else if (left.type == TYPE_FLOAT)
-                        result.value.int_val = left.value.float_val <= right.value.float_val;
-                    break;
-                case TOKEN_GREATER:
-                    if (left.type == TYPE_INT)
-                        result.value.int_val = left.value.int_val > right.value.int_val;
-                    else if (left.type == TYPE_FLOAT)
-                        result.value.int_val = left.value.float_val > right.value.float_val;
-                    break;
-                case TOKEN_GREATER_EQUAL:
-                    if (left.type == TYPE_INT)
-                        result.value.int_val = left.value.int_val >= right.value.int_val;
-                    else if (left.type == TYPE_FLOAT)
-                        result.value.int_val = left.value.float_val >= right.value.float_val;
-                    break;
-                default:
-                    fprintf(stderr, "Invalid binary operator\n");
-                    interpreter->had_error = true;
-            }
+            BinaryExpr* binary = &expr->as.binary;
+            Value left = evaluate_expr(interpreter, binary->left);
+            Value right = evaluate_expr(interpreter, binary->right);
+            result = evaluate_binary(interpreter, binary, left, right);
             break;
         }
         case EXPR_UNARY: {
-            Variable operand = evaluate_expr(interpreter, expr->as.unary.operand);
-            result.type = operand.type;
-            result.is_function = false;
-            
-            switch (expr->as.unary.operator.type) {
-                case TOKEN_MINUS:
-                    if (operand.type == TYPE_INT)
-                        result.value.int_val = -operand.value.int_val;
-                    else if (operand.type == TYPE_FLOAT)
-                        result.value.float_val = -operand.value.float_val;
-                    break;
-                default:
-                    fprintf(stderr, "Invalid unary operator\n");
-                    interpreter->had_error = true;
-            }
+            Value operand = evaluate_expr(interpreter, expr->as.unary.operand);
+            result = evaluate_unary(interpreter, &expr->as.unary, operand);
             break;
         }
         case EXPR_VARIABLE: {
-            Variable* var = environment_get(interpreter->environment, expr->as.variable.name.lexeme);
+            VariableExpr* variable = &expr->as.variable;
+            Value* var = lookup_variable(interpreter, variable->name.lexeme, variable->depth, &variable->slot);
             if (var == NULL) {
-                fprintf(stderr, "Undefined variable '%s'\n", expr->as.variable.name.lexeme);
+                output_error("Undefined variable '%s'\n", expr->as.variable.name.lexeme);
                 interpreter->had_error = true;
                 // Initialize with default value for error recovery
                 result.type = TYPE_INT;
@@ -418,882 +791,753 @@ static Variable evaluate_expr(Interpreter* interpreter, Expr* expr) {
                 result.value.int_val = 0;
                 break;
             }
-            
+
             // Make a copy of the variable to return
-            result.type = var->type;
-            result.is_function = var->is_function;
-            
-            if (var->is_function) {
-                result.value.function = var->value.function;
-            } else {
-                if (var->type == TYPE_STRING) {
-                    result.value.string_val = strdup(var->value.string_val);
-                } else {
-                    result.value = var->value;
-                }
-            }
+            result = value_copy(*var);
             break;
         }
         case EXPR_ASSIGN: {
-            Variable value = evaluate_expr(interpreter, expr->as.assign.value);
-            environment_assign(interpreter->environment, expr->as.assign.name.lexeme, value);
-            result = value;
-            break;
-        }
-        case EXPR_CALL: {
-            Variable callee = evaluate_expr(interpreter, expr->as.call.callee);
-            
-            if (strcmp(expr->as.call.callee->as.variable.name.lexeme, "println") == 0) {
-                // Handle built-in println function
-                for (int i = 0; i < expr->as.call.arg_count; i++) {
-                    Variable arg = evaluate_expr(interpreter, expr->as.call.arguments[i]);
-                    print_value(arg);
-                    if (i < expr->as.call.arg_count - 1) {
-                        printf(" ");
-                    }
+            AssignExpr* assign = &expr->as.assign;
+            Expr* operands[APPEND_MAX_OPERANDS];
+            int count = append_operands(interpreter, expr, operands);
+            if (count > 0) {
+                Value* target = lookup_variable(interpreter, assign->name.lexeme, assign->depth, &assign->slot);
+                Value left = value_copy(*target);
+                Value right[APPEND_MAX_OPERANDS];
+                for (int i = 0; i < count; i++) {
+                    right[i] = evaluate_expr(interpreter, operands[i]);
                 }
-                printf("\n");
-                result.type = TYPE_VOID;
-                result.is_function = false;
-            } else if (strcmp(expr->as.call.callee->as.variable.name.lexeme, "print") == 0) {
-                // Handle built-in print function (like println but without newline)
-                for (int i = 0; i < expr->as.call.arg_count; i++) {
-                    Variable arg = evaluate_expr(interpreter, expr->as.call.arguments[i]);
-                    print_value(arg);
-                    if (i < expr->as.call.arg_count - 1) {
-                        printf(" ");
-                    }
-                }
-                // No newline for print function
-                result.type = TYPE_VOID;
-                result.is_function = false;
-            } else if (callee.is_function) {
-                FunctionStmt* func = callee.value.function.declaration;
-                Environment* previous = interpreter->environment;
-                
-                // Create new environment for function with closure as parent
-                interpreter->environment = create_environment(callee.value.function.closure);
-                
-                // Evaluate all arguments in the caller's environment
-                Variable* args = malloc(sizeof(Variable) * expr->as.call.arg_count);
-                for (int i = 0; i < expr->as.call.arg_count; i++) {
-                    // Switch back to the caller's environment to evaluate arguments
-                    Environment* arg_env = interpreter->environment;
-                    interpreter->environment = previous;
-                    args[i] = evaluate_expr(interpreter, expr->as.call.arguments[i]);
-                    interpreter->environment = arg_env;
-                }
-                
-                // Now set up parameters in the function's environment
-                for (int i = 0; i < expr->as.call.arg_count; i++) {
-                    // Define the parameter in the function environment
-                    environment_define(interpreter->environment, func->params[i].lexeme, func->param_types[i]);
-                    
-                    // Create parameter variable
-                    Variable param = {0};
-                    param.name = strdup(func->params[i].lexeme);
-                    param.type = func->param_types[i];
-                    param.is_function = false;
-                    
-                    // Copy argument value to parameter
-                    if (args[i].type == TYPE_STRING) {
-                        param.value.string_val = strdup(args[i].value.string_val);
-                        free(args[i].value.string_val); // Free the original
-                    } else {
-                        param.value = args[i].value;
-                    }
-                    
-                    // Assign the parameter in the function environment
-                    environment_assign(interpreter->environment, param.name, param);
-                }
-                free(args);
-                
-                // Use a dedicated return value
-                Variable return_value = {0};
-                bool early_return = false;
-                
-                // Execute function body with early return flag and return value
-                execute_stmt(interpreter, func->body, &early_return, &return_value);
-                
-                if (early_return) {
-                    // If we got an early return, use the provided return value
-                    result = return_value;
-                } else {
-                    // Otherwise use default value for the return type
-                    result.type = func->return_type;
-                    result.is_function = false;
-                    if (func->return_type == TYPE_INT) {
-                        result.value.int_val = 0;
-                    } else if (func->return_type == TYPE_FLOAT) {
-                        result.value.float_val = 0.0;
-                    } else if (func->return_type == TYPE_STRING) {
-                        result.value.string_val = strdup("");
-                    } else if (func->return_type == TYPE_BOOL) {
-                        result.value.bool_val = 0; // Default to false
-                    } else if (func->return_type == TYPE_LONG) {
-                        result.value.long_val = 0L;
-                    } else if (func->return_type == TYPE_DOUBLE) {
-                        result.value.double_val = 0.0;
-                    } else if (func->return_type == TYPE_LIST) {
-                        result.value.list_val.items = NULL;
-                        result.value.list_val.count = 0;
-                    }
-                }
-                
-                // Restore environment
-                interpreter->environment = previous;
-            } else {
-                fprintf(stderr, "Can only call functions\n");
-                interpreter->had_error = true;
-            }
-            break;
-        }
-        case EXPR_LIST_ACCESS: {
-            // Get the list variable
-            VariableExpr list_var = expr->as.list_access.list->as.variable;
-            Variable* list_ptr = environment_get(interpreter->environment, list_var.name.lexeme);
-            
-            if (!list_ptr) {
-                fprintf(stderr, "Undefined variable '%s'\n", list_var.name.lexeme);
-                interpreter->had_error = true;
-                result.type = TYPE_INT; // Default type for error recovery
-                result.is_function = false;
-                result.value.int_val = 0;
-                break;
-            }
-            
-            if (list_ptr->type != TYPE_LIST) {
-                fprintf(stderr, "Cannot access index on a non-list value\n");
-                interpreter->had_error = true;
-                result.type = TYPE_INT; // Default type for error recovery
-                result.is_function = false;
-                result.value.int_val = 0;
-                break;
-            }
-            
-            Variable index = evaluate_expr(interpreter, expr->as.list_access.index);
-            
-            if (index.type != TYPE_INT) {
-                fprintf(stderr, "List index must be an integer\n");
-                interpreter->had_error = true;
-                result.type = TYPE_INT; // Default type for error recovery
-                result.is_function = false;
-                result.value.int_val = 0;
-                break;
-            }
-            
-            int idx = index.value.int_val;
-            if (idx < 0 || idx >= list_ptr->value.list_val.count) {
-                fprintf(stderr, "List index out of bounds: %d (size: %d)\n", 
-                        idx, list_ptr->value.list_val.count);
-                interpreter->had_error = true;
-                result.type = TYPE_INT; // Default type for error recovery
-                result.is_function = false;
-                result.value.int_val = 0;
+                result = append_string(interpreter, assign, left, right, count);
                 break;
             }
-            
-            // Get the value at the specified index
-            void* item = list_ptr->value.list_val.items[idx];
-            result.type = list_ptr->value.list_val.item_type;
-            result.is_function = false;
-            
-            // Copy the value based on its type
-            switch (result.type) {
-                case TYPE_INT:
-                    result.value.int_val = *((int*)item);
-                    break;
-                case TYPE_FLOAT:
-                    result.value.float_val = *((float*)item);
-                    break;
-                case TYPE_STRING:
-                    result.value.string_val = strdup((char*)item);
-                    break;
-                case TYPE_BOOL:
-                    result.value.bool_val = *((int*)item);
-                    break;
-                case TYPE_LONG:
-                    result.value.long_val = *((long*)item);
-                    break;
-                case TYPE_DOUBLE:
-                    result.value.double_val = *((double*)item);
-                    break;
-                default:
-                    fprintf(stderr, "Unsupported list item type\n");
-                    interpreter->had_error = true;
-                    break;
-            }
+
+            result = assign_variable(assign, evaluate_expr(interpreter, assign->value), interpreter);
             break;
         }
-        case EXPR_LIST_METHOD: {
-            // Get the list variable
-            VariableExpr list_var = expr->as.list_method.list->as.variable;
-            Variable* list_ptr = environment_get(interpreter->environment, list_var.name.lexeme);
-            
-            if (!list_ptr) {
-                fprintf(stderr, "Undefined variable '%s'\n", list_var.name.lexeme);
-                interpreter->had_error = true;
-                result.type = TYPE_VOID;
-                result.is_function = false;
-                break;
-            }
-            
-            if (list_ptr->type != TYPE_LIST) {
-                fprintf(stderr, "Cannot call method on a non-list value\n");
-                interpreter->had_error = true;
-                result.type = TYPE_VOID;
-                result.is_function = false;
-                break;
-            }
-            
-            if (expr->as.list_method.method == TOKEN_ADD) {
-                // Evaluate the argument to add
-                Variable item = evaluate_expr(interpreter, expr->as.list_method.argument);
-                
-                // If this is the first item, set the item type
-                if (list_ptr->value.list_val.count == 0) {
-                    list_ptr->value.list_val.item_type = item.type;
-                }
-                
-                // Check that the new item matches the existing list type
-                if (item.type != list_ptr->value.list_val.item_type) {
-                    fprintf(stderr, "Cannot add item of type %d to list of type %d\n", 
-                            item.type, list_ptr->value.list_val.item_type);
-                    interpreter->had_error = true;
-                    result.type = TYPE_VOID;
-                    result.is_function = false;
-                    break;
-                }
-                
-                // Allocate memory for the new item based on its type
-                void* new_item = NULL;
-                switch (item.type) {
-                    case TYPE_INT: {
-                        int* int_item = malloc(sizeof(int));
-                        *int_item = item.value.int_val;
-                        new_item = int_item;
-                        break;
-                    }
-                    case TYPE_FLOAT: {
-                        float* float_item = malloc(sizeof(float));
-                        *float_item = item.value.float_val;
-                        new_item = float_item;
-                        break;
-                    }
-                    case TYPE_STRING: {
-                        new_item = strdup(item.value.string_val);
-                        break;
-                    }
-                    case TYPE_BOOL: {
-                        int* bool_item = malloc(sizeof(int));
-                        *bool_item = item.value.bool_val;
-                        new_item = bool_item;
-                        break;
-                    }
-                    case TYPE_LONG: {
-                        long* long_item = malloc(sizeof(long));
-                        *long_item = item.value.long_val;
-                        new_item = long_item;
-                        break;
-                    }
-                    case TYPE_DOUBLE: {
-                        double* double_item = malloc(sizeof(double));
-                        *double_item = item.value.double_val;
-                        new_item = double_item;
-                        break;
-                    }
-                    default:
-                        fprintf(stderr, "Unsupported item type for list.add\n");
-                        interpreter->had_error = true;
-                        break;
-                }
-                
-                // Add the item to the list
-                list_ptr->value.list_val.items = realloc(list_ptr->value.list_val.items, 
-                                                    sizeof(void*) * (list_ptr->value.list_val.count + 1));
-                list_ptr->value.list_val.items[list_ptr->value.list_val.count] = new_item;
-                list_ptr->value.list_val.count++;
-                
-                // Return void (the add method doesn't return a value)
-                result.type = TYPE_VOID;
-                result.is_function = false;
-            }
-            else if (expr->as.list_method.method == TOKEN_REMOVE) {
-                // Evaluate the index to remove
-                Variable index = evaluate_expr(interpreter, expr->as.list_method.argument);
-                
-                if (index.type != TYPE_INT) {
-                    fprintf(stderr, "List index must be an integer\n");
-                    interpreter->had_error = true;
-                    result.type = TYPE_VOID;
-                    result.is_function = false;
-                    break;
-                }
-                
-                int idx = index.value.int_val;
-                if (idx < 0 || idx >= list_ptr->value.list_val.count) {
-                    fprintf(stderr, "List index out of bounds: %d (size: %d)\n", 
-                            idx, list_ptr->value.list_val.count);
-                    interpreter->had_error = true;
-                    result.type = TYPE_VOID;
-                    result.is_function = false;
-                    break;
-                }
-                
-                // Free the memory for the item being removed
-                if (list_ptr->value.list_val.item_type == TYPE_STRING) {
-                    free(list_ptr->value.list_val.items[idx]);
-                } else {
-                    free(list_ptr->value.list_val.items[idx]);
-                }
-                
-                // Shift all remaining elements down
-                for (int i = idx; i < list_ptr->value.list_val.count - 1; i++) {
-                    list_ptr->value.list_val.items[i] = list_ptr->value.list_val.items[i + 1];
-                }
-                
-                // Shrink the list size
-                list_ptr->value.list_val.count--;
-                
-                // Return void (the remove method doesn't return a value)
-                result.type = TYPE_VOID;
-                result.is_function = false;
-            }
+        case EXPR_CALL:
+            // Expressions that contain a call run as tasks
+            break;
+        case EXPR_LIST_ACCESS: {
+            Value* list_ptr = list_variable(interpreter, expr->as.list_access.list, "Cannot access index on a non-list value");
+            if (list_ptr == NULL) break;
+
+            Value index = evaluate_expr(interpreter, expr->as.list_access.index);
+            result = get_index(interpreter, list_ptr, index);
             break;
         }
-        case EXPR_LIST_PROPERTY: {
-            // Get the list variable
-            VariableExpr list_var = expr->as.list_property.list->as.variable;
-            Variable* list_ptr = environment_get(interpreter->environment, list_var.name.lexeme);
-            
-            if (!list_ptr) {
-                fprintf(stderr, "Undefined variable '%s'\n", list_var.name.lexeme);
-                interpreter->had_error = true;
-                result.type = TYPE_INT; // Default type for error recovery
-                result.is_function = false;
-                result.value.int_val = 0;
-                break;
-            }
-            
-            if (list_ptr->type != TYPE_LIST) {
-                fprintf(stderr, "Cannot access property on a non-list value\n");
-                interpreter->had_error = true;
-                result.type = TYPE_INT; // Default type for error recovery
-                result.is_function = false;
-                result.value.int_val = 0;
+        case EXPR_LIST_METHOD: {
+            Value* list_ptr = list_variable(interpreter, expr->as.list_method.list, "Cannot call method on a non-list value");
+            if (list_ptr == NULL) {
+                result = list_method_error();
                 break;
             }
-            
+
+            Value argument = evaluate_expr(interpreter, expr->as.list_method.argument);
+            result = call_list_method(interpreter, expr->as.list_method.method, list_ptr, argument);
+            break;
+        }
+        case EXPR_LIST_PROPERTY: {
+            Value* list_ptr = list_variable(interpreter, expr->as.list_property.list, "Cannot access property on a non-list value");
+            if (list_ptr == NULL) break;
+
             if (expr->as.list_property.property == TOKEN_LENGTH) {
                 // Return the length of the list
                 result.type = TYPE_INT;
                 result.is_function = false;
-                result.value.int_val = list_ptr->value.list_val.count;
+                result.value.int_val = list_ptr->value.list_val->count;
             }
             break;
         }
     }
-    
+
     return result;
 }
 
-static void print_value(Variable arg) {
-    switch (arg.type) {
-        case TYPE_INT:
-            printf("%d", arg.value.int_val);
-            break;
-        case TYPE_FLOAT:
-            printf("%f", arg.value.float_val);
-            break;
-        case TYPE_STRING:
-            printf("%s", arg.value.string_val);
+// Take the next steps of the expression task on top of the task stack. The
+// expression's operands are evaluated in the same order as in
+// evaluate_expr; the step counts those evaluated or waited for so far, and
+// the expression's value replaces the task once they are all there.
+static void evaluate_step(Interpreter* interpreter) {
+    Task* task = &interpreter->tasks[interpreter->task_count - 1];
+    Expr* expr = task->as.expr;
+    Value result = {0};
+
+    switch (expr->type) {
+        case EXPR_BINARY: {
+            BinaryExpr* binary = &expr->as.binary;
+            // Special case for list index assignment
+            bool index_assignment = binary->operator.type == TOKEN_ASSIGN && binary->left->type == EXPR_LIST_ACCESS;
+            Expr* left = index_assignment ? binary->left->as.list_access.index : binary->left;
+            if (task->step == 0) {
+                if (index_assignment && list_lookup(interpreter, binary->left->as.list_access.list) == NULL) break;
+                task->step = 1;
+                if (!push_expr(interpreter, left)) return;
+            }
+            if (task->step == 1) {
+                task->step = 2;
+                if (!push_expr(interpreter, binary->right)) return;
+            }
+
+            Value right = pop_value(interpreter);
+            Value value = pop_value(interpreter);
+            if (index_assignment) {
+                result = assign_index(interpreter, binary->left->as.list_access.list, value, right);
+            } else {
+                result = evaluate_binary(interpreter, binary, value, right);
+            }
             break;
-        case TYPE_BOOL:
-            printf("%s", arg.value.bool_val ? "true" : "false");
+        }
+        case EXPR_UNARY:
+            if (task->step == 0) {
+                task->step = 1;
+                if (!push_expr(interpreter, expr->as.unary.operand)) return;
+            }
+            result = evaluate_unary(interpreter, &expr->as.unary, pop_value(interpreter));
             break;
-        case TYPE_LONG:
-            printf("%ld", arg.value.long_val);
+        case EXPR_ASSIGN: {
+            AssignExpr* assign = &expr->as.assign;
+            Expr* operands[APPEND_MAX_OPERANDS];
+            // An append reads the variable before any operand, and keeps its
+            // value below theirs
+            if (task->step == 0 && append_operands(interpreter, expr, operands) > 0) {
+                Value* target = lookup_variable(interpreter, assign->name.lexeme, assign->depth, &assign->slot);
+                push_value(interpreter, value_copy(*target));
+                task->append = true;
+            }
+            if (!task->append) {
+                if (task->step == 0) {
+                    task->step = 1;
+                    if (!push_expr(interpreter, assign->value)) return;
+                }
+                result = assign_variable(assign, pop_value(interpreter), interpreter);
+                break;
+            }
+
+            int count = assign_append_operands(assign, operands);
+            while (task->step < count) {
+                if (!push_expr(interpreter, operands[task->step++])) return;
+            }
+            interpreter->value_count -= count + 1;
+            Value* values = &interpreter->values[interpreter->value_count];
+            result = append_string(interpreter, assign, values[0], values + 1, count);
             break;
-        case TYPE_DOUBLE:
-            printf("%lf", arg.value.double_val);
+        }
+        case EXPR_CALL: {
+            CallExpr* call = &expr->as.call;
+            // The callee comes first, then argument i at step i + 1
+            if (task->step == 0) {
+                task->step = 1;
+                if (!push_expr(interpreter, call->callee)) return;
+            }
+            if (task->step == 1 && !interpreter->values[interpreter->value_count - 1].is_function) {
+                Value callee = pop_value(interpreter);
+                value_release(&callee);
+                output_error("Can only call functions\n");
+                interpreter->had_error = true;
+                break;
+            }
+            while (task->step <= call->arg_count) {
+                if (!push_expr(interpreter, call->arguments[task->step++ - 1])) return;
+            }
+
+            bool tail = task->tail;
+            interpreter->task_count--;
+            call_value(interpreter, call->arg_count, tail);
+            return;
+        }
+        case EXPR_LIST_ACCESS: {
+            Value* list_ptr = list_variable(interpreter, expr->as.list_access.list, "Cannot access index on a non-list value");
+            if (task->step == 0) {
+                if (list_ptr == NULL) break;
+                task->step = 1;
+                if (!push_expr(interpreter, expr->as.list_access.index)) return;
+            }
+
+            Value index = pop_value(interpreter);
+            if (list_ptr == NULL) {
+                value_release(&index);
+                break;
+            }
+            result = get_index(interpreter, list_ptr, index);
             break;
-        case TYPE_LIST:
-            printf("[");
-            for (int j = 0; j < arg.value.list_val.count; j++) {
-                void* item = arg.value.list_val.items[j];
-                
-                // Print the item based on its type
-                switch (arg.value.list_val.item_type) {
-                    case TYPE_INT:
-                        printf("%d", *((int*)item));
-                        break;
-                    case TYPE_FLOAT:
-                        printf("%f", *((float*)item));
-                        break;
-                    case TYPE_STRING:
-                        printf("\"%s\"", (char*)item);
-                        break;
-                    case TYPE_BOOL:
-                        printf("%s", (*((int*)item)) ? "true" : "false");
-                        break;
-                    case TYPE_LONG:
-                        printf("%ld", *((long*)item));
-                        break;
-                    case TYPE_DOUBLE:
-                        printf("%lf", *((double*)item));
-                        break;
-                    default:
-                        printf("?");
-                        break;
-                }
-                
-                if (j < arg.value.list_val.count - 1) {
-                    printf(", ");
+        }
+        case EXPR_LIST_METHOD: {
+            Value* list_ptr = list_variable(interpreter, expr->as.list_method.list, "Cannot call method on a non-list value");
+            if (task->step == 0) {
+                if (list_ptr == NULL) {
+                    result = list_method_error();
+                    break;
                 }
+                task->step = 1;
+                if (!push_expr(interpreter, expr->as.list_method.argument)) return;
+            }
+
+            Value argument = pop_value(interpreter);
+            if (list_ptr == NULL) {
+                value_release(&argument);
+                result = list_method_error();
+                break;
             }
-            printf("]");
+            result = call_list_method(interpreter, expr->as.list_method.method, list_ptr, argument);
             break;
+        }
         default:
+            // Literals, variables and list.length make no call
+            result = evaluate_expr(interpreter, expr);
             break;
     }
+
+    interpreter->task_count--;
+    push_value(interpreter, result);
 }
 
-static void execute_stmt(Interpreter* interpreter, Stmt* stmt, bool* early_return, Variable* return_value) {
-    if (*early_return) return;  // Skip execution if we've already returned
-    
-    switch (stmt->type) {
-        case STMT_EXPRESSION:
-            evaluate_expr(interpreter, stmt->as.expression);
-            break;
-        case STMT_VAR_DECL: {
-            Variable var = {0};
-            var.name = strdup(stmt->as.var_decl.name.lexeme);
-            var.type = stmt->as.var_decl.type;
-            var.is_function = false;
-            
-            environment_define(interpreter->environment, var.name, var.type);
-            
-            if (stmt->as.var_decl.initializer != NULL) {
-                Variable init = evaluate_expr(interpreter, stmt->as.var_decl.initializer);
-                
-                // Special case: implicit int->bool conversion for boolean variables
-                if (var.type == TYPE_BOOL && init.type == TYPE_INT) {
-                    var.value.bool_val = init.value.int_val ? 1 : 0;
-                }
-                // Special case: int->long conversion
-                else if (var.type == TYPE_LONG && init.type == TYPE_INT) {
-                    var.value.long_val = (long)init.value.int_val;
+// Test the value of the condition of an if, while or for. The type test is
+// skipped for conditions the checker typed, which are always ints or bools.
+static bool test_condition(Interpreter* interpreter, Expr* expr, Value condition, const char* what, bool* is_true) {
+    if (!expr->typed && condition.type != TYPE_INT && condition.type != TYPE_BOOL) {
+        output_error("%s must be an integer or boolean\n", what);
+        interpreter->had_error = true;
+        return false;
+    }
+
+    *is_true = condition.type == TYPE_BOOL ? condition.value.bool_val : condition.value.int_val != 0;
+    return true;
+}
+
+static bool opens_scope(BlockStmt* block) {
+    // Only create a new environment if this is not a variable declaration block
+    return block->count == 0 || block->statements[0]->type != STMT_VAR_DECL;
+}
+
+static void define_variable(Interpreter* interpreter, VarDeclStmt* decl, int slot, Value init) {
+    if (!value_coerce(decl->type, &init)) {
+        output_error("Type mismatch in variable initialization\n");
+        value_release(&init);
+        interpreter->had_error = true;
+        return;
+    }
+    init.is_function = false;
+
+    // The initializer may have grown the environment, so index it again
+    variable_assign(&interpreter->environment->variables[slot], init, decl->name.lexeme);
+    value_release(&init);  // variable_assign keeps its own copy
+}
+
+static void define_function(Interpreter* interpreter, FunctionStmt* function) {
+    // Store the function in the environment
+    const char* name = function->name.lexeme;
+    Value func = {0};
+    func.type = function->return_type;
+    func.is_function = true;
+    func.value.function = new_callable(interpreter);
+
+    // Deep copy the function declaration
+    func.value.function->declaration = malloc(sizeof(FunctionStmt));
+    func.value.function->declaration->name = function->name;
+    func.value.function->declaration->return_type = function->return_type;
+    func.value.function->declaration->param_count = function->param_count;
+
+    // Copy parameters
+    func.value.function->declaration->params = malloc(sizeof(Token) * function->param_count);
+    func.value.function->declaration->param_types = malloc(sizeof(DataType) * function->param_count);
+    for (int i = 0; i < function->param_count; i++) {
+        func.value.function->declaration->params[i] = function->params[i];
+        func.value.function->declaration->param_types[i] = function->param_types[i];
+    }
+
+    // Copy body
+    func.value.function->declaration->body = function->body;
+    func.value.function->declaration->scope_size = function->scope_size;
+    func.value.function->declaration->call_count = 0;
+    func.value.function->declaration->jit = NULL;
+    func.value.function->closure = interpreter->environment;
+
+    environment_define(interpreter->environment, name, func.type);
+    environment_assign(interpreter->environment, name, func);
+}
+
+// Run the statements of the block task on top of the task stack, until one
+// leaves tasks of its own or returns
+static void run_block(Interpreter* interpreter) {
+    Task* task = &interpreter->tasks[interpreter->task_count - 1];
+    BlockStmt* block = &task->as.stmt->as.block;
+    while (task->step < block->count) {
+        int count = interpreter->task_count;
+        execute_stmt(interpreter, block->statements[task->step++]);
+        if (interpreter->task_count != count) return;
+    }
+
+    interpreter->task_count--;
+    if (opens_scope(block)) {
+        pop_environment(interpreter, interpreter->environment->enclosing);
+    }
+}
+
+// Run a statement as far as it goes without waiting for a call, leaving
+// tasks for the rest. Statements without calls or returns run straight
+// through, and one that ends with another statement runs it in its place.
+static void execute_stmt(Interpreter* interpreter, Stmt* stmt) {
+    for (;;) {
+        switch (stmt->type) {
+            case STMT_EXPRESSION: {
+                if (stmt->as.expression->calls) {
+                    push_task(interpreter, TASK_DISCARD);
+                    push_expr(interpreter, stmt->as.expression);
+                    return;
                 }
-                // Special case: float->double conversion
-                else if (var.type == TYPE_DOUBLE && init.type == TYPE_FLOAT) {
-                    var.value.double_val = (double)init.value.float_val;
+                Value result = evaluate_expr(interpreter, stmt->as.expression);
+                value_release(&result);
+                return;
+            }
+            case STMT_VAR_DECL: {
+                VarDeclStmt* decl = &stmt->as.var_decl;
+
+                // Globals are defined by name, locals in their resolved slot
+                Environment* env = interpreter->environment;
+                int slot = decl->slot;
+                if (slot < 0) {
+                    slot = environment_define(env, decl->name.lexeme, decl->type);
+                } else {
+                    environment_define_slot(env, slot, decl->name.lexeme, decl->type);
                 }
-                // Regular case: types match
-                else if (init.type == var.type) {
-                    if (var.type == TYPE_STRING) {
-                        var.value.string_val = strdup(init.value.string_val);
-                        free(init.value.string_val);
-                    } else {
-                        var.value = init.value;
-                    }
+
+                if (decl->initializer == NULL) {
+                    // Initialize with default values
+                    define_variable(interpreter, decl, slot, value_default(decl->type));
+                } else if (decl->initializer->calls) {
+                    Task* task = push_task(interpreter, TASK_VAR_DECL);
+                    task->as.stmt = stmt;
+                    task->step = slot;
+                    push_expr(interpreter, decl->initializer);
                 } else {
-                    fprintf(stderr, "Type mismatch in variable initialization\n");
-                    interpreter->had_error = true;
+                    define_variable(interpreter, decl, slot, evaluate_expr(interpreter, decl->initializer));
+                }
+                return;
+            }
+            case STMT_BLOCK: {
+                BlockStmt* block = &stmt->as.block;
+                if (opens_scope(block)) {
+                    push_environment(interpreter, interpreter->environment, block->scope_size);
+                }
+                if (!stmt->straight) {
+                    push_task(interpreter, TASK_BLOCK)->as.stmt = stmt;
+                    run_block(interpreter);
                     return;
                 }
-            } else {
-                // Initialize with default values
-                switch (var.type) {
-                    case TYPE_INT:
-                        var.value.int_val = 0;
-                        break;
-                    case TYPE_FLOAT:
-                        var.value.float_val = 0.0;
-                        break;
-                    case TYPE_STRING:
-                        var.value.string_val = strdup("");
-                        break;
-                    case TYPE_BOOL:
-                        var.value.bool_val = 0; // false
-                        break;
-                    case TYPE_LONG:
-                        var.value.long_val = 0L;
-                        break;
-                    case TYPE_DOUBLE:
-                        var.value.double_val = 0.0;
-                        break;
-                    case TYPE_LIST:
-                        var.value.list_val.items = NULL;
-                        var.value.list_val.count = 0;
-                        break;
-                    default:
-                        break;
+
+                for (int i = 0; i < block->count; i++) {
+                    execute_stmt(interpreter, block->statements[i]);
+                }
+                if (opens_scope(block)) {
+                    pop_environment(interpreter, interpreter->environment->enclosing);
                 }
-            }
-            
-            environment_assign(interpreter->environment, var.name, var);
-            break;
-        }
-        case STMT_BLOCK: {
-            // Only create a new environment if this is not a variable declaration block
-            Environment* previous = interpreter->environment;
-            if (stmt->as.block.count == 0 || stmt->as.block.statements[0]->type != STMT_VAR_DECL) {
-                interpreter->environment = create_environment(previous);
-            }
-            
-            for (int i = 0; i < stmt->as.block.count; i++) {
-                execute_stmt(interpreter, stmt->as.block.statements[i], early_return, return_value);
-                if (*early_return) break;  // Exit the block early if we've returned
-            }
-            
-            if (stmt->as.block.count == 0 || stmt->as.block.statements[0]->type != STMT_VAR_DECL) {
-                interpreter->environment = previous;
-            }
-            break;
-        }
-        case STMT_IF: {
-            Variable condition = evaluate_expr(interpreter, stmt->as.if_stmt.condition);
-            if (condition.type != TYPE_INT && condition.type != TYPE_BOOL) {
-                fprintf(stderr, "Condition must be an integer or boolean\n");
-                interpreter->had_error = true;
                 return;
             }
-            
-            bool is_true = (condition.type == TYPE_BOOL) 
-                           ? condition.value.bool_val 
-                           : condition.value.int_val != 0;
-            
-            if (is_true) {
-                execute_stmt(interpreter, stmt->as.if_stmt.then_branch, early_return, return_value);
-            } else if (stmt->as.if_stmt.else_branch != NULL) {
-                execute_stmt(interpreter, stmt->as.if_stmt.else_branch, early_return, return_value);
-            }
-            break;
-        }
-        case STMT_WHILE: {
-            for (;;) {
-                Variable condition = evaluate_expr(interpreter, stmt->as.while_stmt.condition);
-                if (condition.type != TYPE_INT && condition.type != TYPE_BOOL) {
-                    fprintf(stderr, "Condition must be an integer or boolean\n");
-                    interpreter->had_error = true;
+            case STMT_IF: {
+                Expr* condition = stmt->as.if_stmt.condition;
+                if (condition->calls) {
+                    push_task(interpreter, TASK_IF)->as.stmt = stmt;
+                    push_expr(interpreter, condition);
                     return;
                 }
-                
-                bool is_true = (condition.type == TYPE_BOOL) 
-                               ? condition.value.bool_val 
-                               : condition.value.int_val != 0;
-                if (!is_true) break;
-                
-                execute_stmt(interpreter, stmt->as.while_stmt.body, early_return, return_value);
-                if (*early_return) break;  // Exit the loop early if we've returned
-            }
-            break;
-        }
-        case STMT_FOR: {
-            // Create a new environment for the for loop (for variable scope)
-            Environment* previous = interpreter->environment;
-            interpreter->environment = create_environment(previous);
-            
-            // Execute the initialization once
-            if (stmt->as.for_stmt.init != NULL) {
-                execute_stmt(interpreter, stmt->as.for_stmt.init, early_return, return_value);
-                if (*early_return) {
-                    interpreter->environment = previous;
+
+                bool is_true;
+                if (!test_condition(interpreter, condition, evaluate_expr(interpreter, condition), "Condition", &is_true)) {
                     return;
                 }
+                Stmt* branch = is_true ? stmt->as.if_stmt.then_branch : stmt->as.if_stmt.else_branch;
+                if (branch == NULL) return;
+                stmt = branch;
+                continue;
             }
-            
-            // Execute the condition-body-increment loop
-            while (true) {
-                // Check condition (if any)
-                if (stmt->as.for_stmt.condition != NULL) {
-                    Variable condition = evaluate_expr(interpreter, stmt->as.for_stmt.condition);
-                    if (condition.type != TYPE_INT && condition.type != TYPE_BOOL) {
-                        fprintf(stderr, "For loop condition must be an integer or boolean\n");
-                        interpreter->had_error = true;
-                        interpreter->environment = previous;
-                        return;
-                    }
-                    
-                    // Exit if condition is false
-                    bool is_true = (condition.type == TYPE_BOOL) 
-                                   ? condition.value.bool_val 
-                                   : condition.value.int_val != 0;
-                    if (!is_true) break;
+            case STMT_WHILE: {
+                WhileStmt* loop = &stmt->as.while_stmt;
+                if (!stmt->straight) {
+                    push_task(interpreter, TASK_WHILE)->as.stmt = stmt;
+                    return;
+                }
+
+                bool is_true;
+                while (test_condition(interpreter, loop->condition, evaluate_expr(interpreter, loop->condition),
+                                      "Condition", &is_true) && is_true) {
+                    execute_stmt(interpreter, loop->body);
                 }
-                
-                // Execute body
-                execute_stmt(interpreter, stmt->as.for_stmt.body, early_return, return_value);
-                if (*early_return) {
-                    interpreter->environment = previous;
+                return;
+            }
+            case STMT_FOR: {
+                ForStmt* loop = &stmt->as.for_stmt;
+                // The loop variable gets an environment of its own
+                push_environment(interpreter, interpreter->environment, loop->scope_size);
+                if (!stmt->straight) {
+                    push_task(interpreter, TASK_FOR)->as.stmt = stmt;
                     return;
                 }
-                
-                // Execute increment (if any)
-                if (stmt->as.for_stmt.increment != NULL) {
-                    evaluate_expr(interpreter, stmt->as.for_stmt.increment);
+
+                if (loop->init != NULL) execute_stmt(interpreter, loop->init);
+                for (;;) {
+                    bool is_true;
+                    if (loop->condition != NULL &&
+                        (!test_condition(interpreter, loop->condition, evaluate_expr(interpreter, loop->condition),
+                                         "For loop condition", &is_true) || !is_true)) {
+                        break;
+                    }
+                    execute_stmt(interpreter, loop->body);
+                    if (loop->increment != NULL) {
+                        Value result = evaluate_expr(interpreter, loop->increment);
+                        value_release(&result);
+                    }
                 }
+                pop_environment(interpreter, interpreter->environment->enclosing);
+                return;
             }
-            
-            // Restore the previous environment
-            interpreter->environment = previous;
-            break;
-        }
-        case STMT_FUNCTION: {
-            // Store the function in the environment
-            Variable func = {0};
-            func.name = strdup(stmt->as.function.name.lexeme);
-            func.type = stmt->as.function.return_type;
-            func.is_function = true;
-            
-            // Deep copy the function declaration
-            func.value.function.declaration = malloc(sizeof(FunctionStmt));
-            func.value.function.declaration->name = stmt->as.function.name;
-            func.value.function.declaration->return_type = stmt->as.function.return_type;
-            func.value.function.declaration->param_count = stmt->as.function.param_count;
-            
-            // Copy parameters
-            func.value.function.declaration->params = malloc(sizeof(Token) * stmt->as.function.param_count);
-            func.value.function.declaration->param_types = malloc(sizeof(DataType) * stmt->as.function.param_count);
-            for (int i = 0; i < stmt->as.function.param_count; i++) {
-                func.value.function.declaration->params[i] = stmt->as.function.params[i];
-                func.value.function.declaration->param_types[i] = stmt->as.function.param_types[i];
+            case STMT_FUNCTION:
+                define_function(interpreter, &stmt->as.function);
+
+                // If this is the main function, execute it immediately, in
+                // the environment it is declared in
+                if (stmt->as.function.name.lexeme != interpreter->main_name) return;
+                push_frame(interpreter, FRAME_MAIN);
+                stmt = stmt->as.function.body;
+                continue;
+            case STMT_RETURN: {
+                Expr* expression = stmt->as.return_stmt.expression;
+                if (expression == NULL) {
+                    // A bare return leaves the call with its type's default value
+                    Value none = {0};
+                    none.type = TYPE_VOID;
+                    return_from_frame(interpreter, none);
+                } else if (expression->calls) {
+                    push_task(interpreter, TASK_RETURN);
+                    Task* task = push_task(interpreter, TASK_EXPR);
+                    task->as.expr = expression;
+                    task->tail = stmt->as.return_stmt.tail_call;
+                } else {
+                    return_from_frame(interpreter, evaluate_expr(interpreter, expression));
+                }
+                return;
             }
-            
-            // Copy body
-            func.value.function.declaration->body = stmt->as.function.body;
-            func.value.function.closure = interpreter->environment;
-            
-            environment_define(interpreter->environment, func.name, func.type);
-            environment_assign(interpreter->environment, func.name, func);
-            
-            // If this is the main function, execute it immediately
-            if (strcmp(func.name, "main") == 0) {
-                Variable main_return = {0};
-                bool main_early_return = false;
-                execute_stmt(interpreter, stmt->as.function.body, &main_early_return, &main_return);
+            case STMT_INCLUDE: {
+                // Get the include path
+                const char* path_str = stmt->as.include.path.lexeme;
+
+                // Fix path - remove quotes
+                char* path = module_include_path(path_str);
+
+                // Process the include
+                process_include(interpreter, path);
+
+                // Free temporary path
+                free(path);
+                return;
             }
-            break;
         }
-        case STMT_RETURN: {
-            if (stmt->as.return_stmt.expression != NULL) {
-                Variable value = evaluate_expr(interpreter, stmt->as.return_stmt.expression);
-                
-                // Copy the return value
-                if (value.type == TYPE_STRING) {
-                    return_value->type = value.type;
-                    return_value->is_function = false;
-                    return_value->value.string_val = strdup(value.value.string_val);
+    }
+}
+
+// Run a while loop's condition, and its body while the condition holds
+static void run_while(Interpreter* interpreter, Task* task) {
+    WhileStmt* loop = &task->as.stmt->as.while_stmt;
+    Value condition;
+    if (task->step == 1) {
+        task->step = 0;
+        condition = pop_value(interpreter);
+    } else if (loop->condition->calls) {
+        task->step = 1;
+        push_expr(interpreter, loop->condition);
+        return;
+    } else {
+        condition = evaluate_expr(interpreter, loop->condition);
+    }
+
+    bool is_true;
+    if (!test_condition(interpreter, loop->condition, condition, "Condition", &is_true) || !is_true) {
+        interpreter->task_count--;
+        return;
+    }
+    execute_stmt(interpreter, loop->body);
+}
+
+static void run_for(Interpreter* interpreter, Task* task) {
+    ForStmt* loop = &task->as.stmt->as.for_stmt;
+    switch (task->step) {
+        case FOR_INIT:
+            // Execute the initialization once
+            task->step = FOR_TEST;
+            if (loop->init != NULL) execute_stmt(interpreter, loop->init);
+            return;
+        case FOR_TEST:
+        case FOR_CONDITION: {
+            // Check condition (if any)
+            if (loop->condition != NULL) {
+                Value condition;
+                if (task->step == FOR_CONDITION) {
+                    condition = pop_value(interpreter);
+                } else if (loop->condition->calls) {
+                    task->step = FOR_CONDITION;
+                    push_expr(interpreter, loop->condition);
+                    return;
                 } else {
-                    *return_value = value;
+                    condition = evaluate_expr(interpreter, loop->condition);
+                }
+
+                // Exit if condition is false
+                bool is_true;
+                if (!test_condition(interpreter, loop->condition, condition, "For loop condition", &is_true) || !is_true) {
+                    interpreter->task_count--;
+                    pop_environment(interpreter, interpreter->environment->enclosing);
+                    return;
                 }
-                
-                *early_return = true;  // Set early return flag
             }
-            break;
+
+            task->step = FOR_INCREMENT;
+            execute_stmt(interpreter, loop->body);
+            return;
+        }
+        case FOR_INCREMENT:
+            task->step = FOR_TEST;
+            if (loop->increment == NULL) return;
+            if (loop->increment->calls) {
+                task->step = FOR_NEXT;
+                push_expr(interpreter, loop->increment);
+            } else {
+                Value result = evaluate_expr(interpreter, loop->increment);
+                value_release(&result);
+            }
+            return;
+        case FOR_NEXT: {
+            task->step = FOR_TEST;
+            Value result = pop_value(interpreter);
+            value_release(&result);
+            return;
         }
-        case STMT_INCLUDE: {
-            // Get the include path
-            const char* path_str = stmt->as.include.path.lexeme;
-            
-            // Fix path - remove quotes
-            char* path = strdup(path_str);
-            if (path[0] == '"') {
-                // Remove opening quote
-                memmove(path, path + 1, strlen(path));
+    }
+}
+
+// Run tasks until every frame has returned, or a stack overflow stops the run
+static void run_tasks(Interpreter* interpreter) {
+    while (interpreter->task_count > 0 && !interpreter->overflowed) {
+        Task* task = &interpreter->tasks[interpreter->task_count - 1];
+        switch (task->kind) {
+            case TASK_FRAME: {
+                // The statements ran out without a return
+                Value none = {0};
+                none.type = TYPE_VOID;
+                return_from_frame(interpreter, none);
+                break;
+            }
+            case TASK_BLOCK:
+                run_block(interpreter);
+                break;
+            case TASK_WHILE:
+                run_while(interpreter, task);
+                break;
+            case TASK_FOR:
+                run_for(interpreter, task);
+                break;
+            case TASK_IF: {
+                IfStmt* if_stmt = &task->as.stmt->as.if_stmt;
+                interpreter->task_count--;
+                bool is_true;
+                if (!test_condition(interpreter, if_stmt->condition, pop_value(interpreter), "Condition", &is_true)) {
+                    break;
+                }
+                Stmt* branch = is_true ? if_stmt->then_branch : if_stmt->else_branch;
+                if (branch != NULL) execute_stmt(interpreter, branch);
+                break;
             }
-            
-            // Remove closing quote if exists
-            int len = strlen(path);
-            if (len > 0 && path[len - 1] == '"') {
-                path[len - 1] = '\0';
+            case TASK_VAR_DECL:
+                interpreter->task_count--;
+                define_variable(interpreter, &task->as.stmt->as.var_decl, task->step, pop_value(interpreter));
+                break;
+            case TASK_DISCARD: {
+                interpreter->task_count--;
+                Value result = pop_value(interpreter);
+                value_release(&result);
+                break;
             }
-            
-            // Process the include
-            process_include(interpreter, path);
-            
-            // Free temporary path
-            free(path);
-            break;
+            case TASK_RETURN:
+                return_from_frame(interpreter, pop_value(interpreter));
+                break;
+            case TASK_INCLUDE: {
+                Module* module = task->as.module;
+                if (task->step > 0 && interpreter->had_error) {
+                    output_error("Error: Failed to execute statement in included file: %s\n", module->path);
+                    interpreter->task_count--;
+                } else if (task->step == module->count) {
+                    interpreter->task_count--;
+                } else {
+                    // Each statement of the file is run on its own, like a top-level one
+                    Stmt* stmt = module->statements[task->step++];
+                    push_frame(interpreter, FRAME_STATEMENT);
+                    execute_stmt(interpreter, stmt);
+                }
+                break;
+            }
+            case TASK_EXPR:
+                evaluate_step(interpreter);
+                break;
         }
     }
 }
 
-void interpreter_init(Interpreter* interpreter) {
+void interpreter_init(Interpreter* interpreter, Output* output) {
     interpreter->globals = create_environment(NULL);
+    interpreter->free_environments = NULL;
+    interpreter->output = output;
     interpreter->environment = interpreter->globals;
     interpreter->had_error = false;
+    interpreter->jit = true;
+    interpreter->frames = NULL;
+    interpreter->frame_count = 0;
+    interpreter->frame_capacity = 0;
+    interpreter->tasks = NULL;
+    interpreter->task_count = 0;
+    interpreter->task_capacity = 0;
+    interpreter->values = NULL;
+    interpreter->value_count = 0;
+    interpreter->value_capacity = 0;
+    interpreter->depth = 0;
+    interpreter->callables = NULL;
+    interpreter->callable_count = 0;
+    interpreter->callable_capacity = 0;
+    interpreter->max_stack = MAX_STACK_DEFAULT;
+    interpreter->stack_limit = 0;
+    interpreter->overflowed = false;
+    interpreter->main_name = pool_intern("main");
 
-    // Add built-in println function
-    Variable println = {0};
-    println.name = strdup("println");
-    println.type = TYPE_VOID;
-    println.is_function = true;
-    environment_define(interpreter->globals, println.name, println.type);
-    environment_assign(interpreter->globals, println.name, println);
-    
-    // Add built-in print function (no newline)
-    Variable print = {0};
-    print.name = strdup("print");
-    print.type = TYPE_VOID;
-    print.is_function = true;
-    environment_define(interpreter->globals, print.name, print.type);
-    environment_assign(interpreter->globals, print.name, print);
+    // Install the builtin registry as global functions, under the same
+    // interned names the program uses to call them
+    for (const Native* native = natives; native->name != NULL; native++) {
+        const char* name = pool_intern(native->name);
+        environment_define(interpreter->globals, name, native->return_type);
+        environment_assign(interpreter->globals, name, native_value(native));
+    }
 }
 
-void interpreter_interpret(Interpreter* interpreter, Stmt** statements, int count) {
-    for (int i = 0; i < count; i++) {
-        Variable return_value = {0};
-        bool early_return = false;
-        execute_stmt(interpreter, statements[i], &early_return, &return_value);
+typedef struct {
+    Interpreter* interpreter;
+    Stmt** statements;
+    int count;
+    size_t stack_size;   // C stack available from here on
+} Run;
+
+// Release what the frames a stack overflow abandoned hold: their
+// environments and the operands their expressions were waiting with
+static void unwind_frames(Interpreter* interpreter) {
+    while (interpreter->frame_count > 0) {
+        Frame* frame = &interpreter->frames[--interpreter->frame_count];
+        while (interpreter->environment != frame->base) {
+            pop_environment(interpreter, interpreter->environment->enclosing);
+        }
+        if (frame->kind == FRAME_CALL) {
+            pop_environment(interpreter, frame->caller);
+        }
+    }
+    while (interpreter->value_count > 0) {
+        value_release(&interpreter->values[--interpreter->value_count]);
+    }
+    interpreter->task_count = 0;
+    interpreter->depth = 0;
+}
+
+static void run_statements(Run* run) {
+    Interpreter* interpreter = run->interpreter;
+
+    // Compiled code may go as deep into the C stack as leaves a margin at its end
+    char base;
+    interpreter->stack_limit = (uintptr_t)&base - (run->stack_size - STACK_MARGIN);
+
+    for (int i = 0; i < run->count; i++) {
+        push_frame(interpreter, FRAME_STATEMENT);
+        execute_stmt(interpreter, run->statements[i]);
+        run_tasks(interpreter);
+        if (interpreter->overflowed) {
+            unwind_frames(interpreter);
+            break;
+        }
         if (interpreter->had_error) break;
     }
 }
 
-void interpreter_cleanup(Interpreter* interpreter) {
-    free_environment(interpreter->globals);
+static void* interpreter_thread(void* argument) {
+    run_statements(argument);
+    return NULL;
 }
 
-// Process an include statement by loading and interpreting the included file
-static void process_include(Interpreter* interpreter, const char* path) {
-    // Get the full path to the library file
-    char* full_path = get_lib_path(path);
-    
-    if (full_path == NULL) {
-        fprintf(stderr, "Error: Could not find library file: %s\n", path);
-        interpreter->had_error = true;
-        return;
-    }
-    
-    // Read the file content
-    char* source = read_file_content(full_path);
-    if (source == NULL) {
-        fprintf(stderr, "Error: Could not read library file: %s\n", full_path);
-        free(full_path);
-        interpreter->had_error = true;
-        return;
-    }
-    
-    printf("Including file: %s\n", full_path);
-    
-    // Parse the included file
-    Lexer lexer;
-    lexer_init(&lexer, source);
-    
-    Parser parser;
-    parser_init(&parser, &lexer);
-    
-    int count = 0;
-    Stmt** statements = parse(&parser, &count);
-    
-    if (parser.had_error) {
-        fprintf(stderr, "Error: Failed to parse included file: %s\n", full_path);
-        interpreter->had_error = true;
-        free(source);
-        free(full_path);
-        return;
-    }
-    
-    // Save the current environment
-    // Environment* previous = interpreter->environment;
+// Interpreted calls live on the frame stack, but functions the JIT compiled
+// call each other on the C stack, so the program runs on a thread whose
+// stack is sized for max_stack nested compiled calls
+void interpreter_interpret(Interpreter* interpreter, Stmt** statements, int count) {
+    Run run = {interpreter, statements, count, 0};
+    run.stack_size = (size_t)interpreter->max_stack * FRAME_STACK_BYTES + 4 * STACK_MARGIN;
     
-    // Execute each statement in the included file
-    for (int i = 0; i < count; i++) {
-        Variable return_value = {0};
-        bool early_return = false;
-        execute_stmt(interpreter, statements[i], &early_return, &return_value);
-        
-        if (interpreter->had_error) {
-            fprintf(stderr, "Error: Failed to execute statement in included file: %s\n", full_path);
-            break;
+    pthread_attr_t attributes;
+    pthread_t thread;
+    if (pthread_attr_init(&attributes) == 0) {
+        bool started = pthread_attr_setstacksize(&attributes, run.stack_size) == 0 &&
+                       pthread_create(&thread, &attributes, interpreter_thread, &run) == 0;
+        pthread_attr_destroy(&attributes);
+        if (started) {
+            pthread_join(thread, NULL);
+            return;
         }
     }
     
-    // Free resources
-    for (int i = 0; i < count; i++) {
-        free_stmt(statements[i]);
+    // Otherwise calls get the rest of this thread's stack, minus what the
+    // caller may already have used
+    struct rlimit limit;
+    run.stack_size = 8 * 1024 * 1024;
+    if (getrlimit(RLIMIT_STACK, &limit) == 0 && limit.rlim_cur != RLIM_INFINITY) {
+        run.stack_size = (size_t)limit.rlim_cur;
     }
-    free(statements);
-    free(source);
-    free(full_path);
+    run.stack_size = run.stack_size > 4 * STACK_MARGIN ? run.stack_size - 2 * STACK_MARGIN : STACK_MARGIN;
+    run_statements(&run);
 }
 
-// Get the full path to a library file
-static char* get_lib_path(const char* filename) {
-    // Debug: Print the filename we're looking for
-    printf("Looking for file: '%s'\n", filename);
-    
-    // Check if it's a relative path or stdlib reference
-    if (filename[0] == '/' || 
-        (filename[0] == '.' && filename[1] == '/') || 
-        (filename[0] == '.' && filename[1] == '.' && filename[2] == '/')) {
-        // It's a relative or absolute path, use it directly
-        return strdup(filename);
-    }
-    
-    // Try looking in the standard library
-    char* stdlib_path = malloc(strlen("lib/stdlib/") + strlen(filename) + 1);
-    sprintf(stdlib_path, "lib/stdlib/%s", filename);
+void interpreter_cleanup(Interpreter* interpreter) {
+    jit_free();
+    free_environment(interpreter->globals);
+    free(interpreter->frames);
+    interpreter->frames = NULL;
+    free(interpreter->tasks);
+    interpreter->tasks = NULL;
+    free(interpreter->values);
+    interpreter->values = NULL;
     
-    // Check if the file exists
-    FILE* file = fopen(stdlib_path, "r");
-    if (file) {
-        fclose(file);
-        printf("Found in stdlib: %s\n", stdlib_path);
-        return stdlib_path;
+    while (interpreter->free_environments != NULL) {
+        Environment* env = interpreter->free_environments;
+        interpreter->free_environments = env->enclosing;
+        free(env->variables);
+        free(env->names);
+        free(env);
     }
     
-    // File not found in stdlib, free the path
-    free(stdlib_path);
-    
-    // Try looking in the current directory
-    FILE* local_file = fopen(filename, "r");
-    if (local_file) {
-        fclose(local_file);
-        printf("Found in current directory: %s\n", filename);
-        return strdup(filename);
+    for (int i = 0; i < interpreter->callable_count; i++) {
+        FunctionStmt* declaration = interpreter->callables[i]->declaration;
+        free(declaration->params);
+        free(declaration->param_types);
+        free(declaration);
+        free(interpreter->callables[i]);
     }
-    
-    // File not found
-    printf("File not found: %s\n", filename);
-    return NULL;
+    free(interpreter->callables);
+    interpreter->callables = NULL;
+    interpreter->callable_count = 0;
 }
 
-// Read the contents of a file
-static char* read_file_content(const char* path) {
-    FILE* file = fopen(path, "r");
-    if (!file) {
-        fprintf(stderr, "Error: Cannot open file: %s\n", path);
-        return NULL;
-    }
-    
-    // Get file size
-    fseek(file, 0, SEEK_END);
-    long size = ftell(file);
-    rewind(file);
-    
-    // Allocate buffer
-    char* buffer = malloc(size + 1);
-    if (!buffer) {
-        fprintf(stderr, "Error: Memory allocation failed when reading file: %s\n", path);
-        fclose(file);
-        return NULL;
-    }
-    
-    // Read file content
-    size_t bytes_read = fread(buffer, 1, size, file);
-    if (bytes_read < (size_t)size) {
-        fprintf(stderr, "Error: Failed to read entire file: %s (read %zu of %ld bytes)\n", 
-                path, bytes_read, size);
-        free(buffer);
-        fclose(file);
-        return NULL;
+// Process an include statement by loading and interpreting the included file
+static void process_include(Interpreter* interpreter, const char* path) {
+    bool first_load;
+    Module* module = module_load(path, &first_load);
+    if (module == NULL) {
+        interpreter->had_error = true;
+        return;
     }
     
-    buffer[bytes_read] = '\0';
+    // A file's declarations are only run the first time it is included
+    if (!first_load) return;
     
-    printf("Successfully read %zu bytes from file: %s\n", bytes_read, path);
+    resolve(module->statements, module->count);
     
-    fclose(file);
-    return buffer;
+    // Execute each statement in the included file once the include statement is done
+    push_task(interpreter, TASK_INCLUDE)->as.module = module;
 }
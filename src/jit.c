@@ -0,0 +1,948 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "headers/jit.h"
+#include "headers/interpreter.h"
+
+#if defined(__x86_64__) && (defined(__linux__) || defined(__APPLE__))
+#define JIT_SUPPORTED 1
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+// Arguments are passed in the six System V integer registers
+#define JIT_MAX_PARAMS 6
+#define JIT_MAX_SCOPES 64
+
+typedef enum {
+    JIT_COMPILING,
+    JIT_COMPILED,
+    JIT_FAILED
+} JitState;
+
+struct JitFunction {
+    JitState state;
+    FunctionStmt* function;
+    size_t offset;     // Position of the code in its batch while compiling
+    void* code;
+};
+
+// Every region of executable memory and every JitFunction, released by jit_free
+typedef struct {
+    void** regions;
+    size_t* region_sizes;
+    int region_count;
+    int region_capacity;
+    JitFunction** functions;
+    int function_count;
+    int function_capacity;
+    uint8_t* entry;      // Trampoline from C into generated code
+    uint8_t* bailout;    // Unwinds back to the trampoline after a runtime error
+    void* saved_rsp;
+    // Calls the running code may still nest, CALLS_TOO_DEEP or
+    // CALLS_OUT_OF_STACK once it went too deep, and the lowest stack address
+    // a call may start at
+    int64_t calls_left;
+    uintptr_t stack_limit;
+} Jit;
+
+#define CALLS_TOO_DEEP (-1)
+#define CALLS_OUT_OF_STACK (-2)
+
+static Jit jit;
+
+// Growable machine code buffer
+typedef struct {
+    uint8_t* bytes;
+    size_t count;
+    size_t capacity;
+} Code;
+
+// A call to a function of the same batch, patched once its address is known
+typedef struct {
+    size_t at;
+    JitFunction* target;
+} CallPatch;
+
+// Functions compiled together: the one that got hot and every not yet
+// compiled function it can reach
+typedef struct {
+    Code code;
+    JitFunction** functions;
+    int count;
+    int capacity;
+    CallPatch* patches;
+    int patch_count;
+    int patch_capacity;
+    Environment* globals;
+} Batch;
+
+// A local environment of the interpreter, mapped onto a range of frame slots
+typedef struct {
+    int base;
+    int size;
+} Scope;
+
+typedef struct {
+    Batch* batch;
+    FunctionStmt* function;
+    Scope scopes[JIT_MAX_SCOPES];
+    int scope_count;
+    // Per frame slot: whether the variable is certainly defined at the
+    // current point of the code, and its type
+    bool* declared;
+    DataType* types;
+    int slot_capacity;
+    int frame_size;
+    int pushes;          // Temporaries currently pushed on the machine stack
+    size_t* returns;     // Jumps to the epilogue
+    int return_count;
+    int return_capacity;
+} FunctionCompiler;
+
+typedef struct {
+    bool* declared;
+    DataType* types;
+    int count;
+} Snapshot;
+
+static void emit(Code* code, const uint8_t* bytes, size_t count) {
+    if (code->count + count > code->capacity) {
+        code->capacity = code->capacity < 256 ? 256 : code->capacity * 2;
+        if (code->capacity < code->count + count) code->capacity = code->count + count;
+        code->bytes = realloc(code->bytes, code->capacity);
+    }
+    memcpy(code->bytes + code->count, bytes, count);
+    code->count += count;
+}
+
+#define EMIT(code, ...) \
+    do { \
+        const uint8_t bytes_[] = { __VA_ARGS__ }; \
+        emit((code), bytes_, sizeof(bytes_)); \
+    } while (0)
+
+static void emit_u32(Code* code, uint32_t value) {
+    emit(code, (const uint8_t*)&value, sizeof(value));
+}
+
+static void emit_u64(Code* code, uint64_t value) {
+    emit(code, (const uint8_t*)&value, sizeof(value));
+}
+
+static void patch_u32(Code* code, size_t at, uint32_t value) {
+    memcpy(code->bytes + at, &value, sizeof(value));
+}
+
+// Emit a rel32 jump with the given opcode bytes and return its patch site
+static size_t emit_jump(Code* code, const uint8_t* opcode, size_t count) {
+    emit(code, opcode, count);
+    emit_u32(code, 0);
+    return code->count - 4;
+}
+
+static void patch_jump(Code* code, size_t at) {
+    patch_u32(code, at, (uint32_t)(code->count - (at + 4)));
+}
+
+static void emit_loop(Code* code, size_t target) {
+    EMIT(code, 0xE9);  // jmp rel32
+    emit_u32(code, (uint32_t)(target - (code->count + 4)));
+}
+
+static int32_t slot_offset(int index) {
+    return -8 * (index + 1);
+}
+
+// mov rax, [rbp + slot]
+static void emit_load(Code* code, int index) {
+    EMIT(code, 0x48, 0x8B, 0x85);
+    emit_u32(code, (uint32_t)slot_offset(index));
+}
+
+// mov [rbp + slot], rax
+static void emit_store(Code* code, int index) {
+    EMIT(code, 0x48, 0x89, 0x85);
+    emit_u32(code, (uint32_t)slot_offset(index));
+}
+
+// Operand size prefix selecting the 64-bit form of the next instruction
+static void emit_rex(Code* code, bool wide) {
+    if (wide) EMIT(code, 0x48);
+}
+
+// Integers are kept sign-extended to 64 bits: movsxd rax, eax
+static void emit_sign_extend(Code* code) {
+    EMIT(code, 0x48, 0x63, 0xC0);
+}
+
+// rax = rax != 0 (test rax, rax; setne al; movzx eax, al)
+static void emit_normalize_bool(Code* code) {
+    EMIT(code, 0x48, 0x85, 0xC0, 0x0F, 0x95, 0xC0, 0x0F, 0xB6, 0xC0);
+}
+
+// Leave the generated code for the trampoline's bailout path
+static void emit_bailout(Code* code) {
+    EMIT(code, 0x48, 0xB8);  // mov rax, imm64
+    emit_u64(code, (uint64_t)(uintptr_t)jit.bailout);
+    EMIT(code, 0xFF, 0xE0);  // jmp rax
+}
+
+// Every call counts against the interpreter's limits. When the call is one
+// too many or the stack is too low, calls_left says which and the code bails
+// out, for jit_call to report a stack overflow or hand the call back.
+static void emit_stack_check(Code* code) {
+    EMIT(code, 0x48, 0xB8);  // mov rax, &stack_limit
+    emit_u64(code, (uint64_t)(uintptr_t)&jit.stack_limit);
+    EMIT(code, 0x48, 0x3B, 0x20);  // cmp rsp, [rax]
+    EMIT(code, 0x48, 0xB8);  // mov rax, &calls_left
+    emit_u64(code, (uint64_t)(uintptr_t)&jit.calls_left);
+    EMIT(code, 0x72, 0x0F);              // jb out_of_stack
+    EMIT(code, 0x48, 0x83, 0x28, 0x01);  // sub qword [rax], 1
+    EMIT(code, 0x79, 0x1C);              // jns done
+    EMIT(code, 0x48, 0xC7, 0x00, 0xFF, 0xFF, 0xFF, 0xFF);  // mov qword [rax], CALLS_TOO_DEEP
+    EMIT(code, 0xEB, 0x07);              // jmp bailout
+    EMIT(code, 0x48, 0xC7, 0x00, 0xFE, 0xFF, 0xFF, 0xFF);  // out_of_stack: mov qword [rax], CALLS_OUT_OF_STACK
+    emit_bailout(code);
+}
+
+// Give back the call a function made when it returns or leaves its frame for
+// a tail call; r11 is the one scratch register free at both points
+static void emit_call_return(Code* code) {
+    EMIT(code, 0x49, 0xBB);  // mov r11, &calls_left
+    emit_u64(code, (uint64_t)(uintptr_t)&jit.calls_left);
+    EMIT(code, 0x49, 0x83, 0x03, 0x01);  // add qword [r11], 1
+}
+
+static bool supported_type(DataType type) {
+    return type == TYPE_INT || type == TYPE_BOOL || type == TYPE_LONG;
+}
+
+// The implicit conversions value_coerce performs for these types
+static bool emit_coerce(Code* code, DataType from, DataType to) {
+    if (from == to) return true;
+    if (from == TYPE_INT && to == TYPE_BOOL) {
+        emit_normalize_bool(code);
+        return true;
+    }
+    // Ints are already sign-extended
+    return from == TYPE_INT && to == TYPE_LONG;
+}
+
+static void ensure_slots(FunctionCompiler* compiler, int count) {
+    if (count <= compiler->slot_capacity) return;
+
+    int capacity = compiler->slot_capacity < 16 ? 16 : compiler->slot_capacity;
+    while (capacity < count) capacity *= 2;
+    compiler->declared = realloc(compiler->declared, sizeof(bool) * capacity);
+    compiler->types = realloc(compiler->types, sizeof(DataType) * capacity);
+    for (int i = compiler->slot_capacity; i < capacity; i++) {
+        compiler->declared[i] = false;
+        compiler->types[i] = TYPE_INT;
+    }
+    compiler->slot_capacity = capacity;
+}
+
+static bool push_scope(FunctionCompiler* compiler, int size) {
+    if (compiler->scope_count == JIT_MAX_SCOPES) return false;
+
+    int base = 0;
+    if (compiler->scope_count > 0) {
+        Scope* enclosing = &compiler->scopes[compiler->scope_count - 1];
+        base = enclosing->base + enclosing->size;
+    }
+    ensure_slots(compiler, base + size);
+    // The interpreter starts every environment empty
+    for (int i = base; i < base + size; i++) {
+        compiler->declared[i] = false;
+    }
+    if (base + size > compiler->frame_size) compiler->frame_size = base + size;
+
+    compiler->scopes[compiler->scope_count].base = base;
+    compiler->scopes[compiler->scope_count].size = size;
+    compiler->scope_count++;
+    return true;
+}
+
+static void pop_scope(FunctionCompiler* compiler) {
+    Scope* scope = &compiler->scopes[--compiler->scope_count];
+    for (int i = scope->base; i < scope->base + scope->size; i++) {
+        compiler->declared[i] = false;
+    }
+}
+
+// Definitions made on a path that may not run do not count after it
+static Snapshot save_slots(FunctionCompiler* compiler) {
+    Snapshot snapshot;
+    snapshot.count = compiler->slot_capacity;
+    snapshot.declared = malloc(sizeof(bool) * (snapshot.count > 0 ? snapshot.count : 1));
+    snapshot.types = malloc(sizeof(DataType) * (snapshot.count > 0 ? snapshot.count : 1));
+    if (snapshot.count > 0) {
+        memcpy(snapshot.declared, compiler->declared, sizeof(bool) * snapshot.count);
+        memcpy(snapshot.types, compiler->types, sizeof(DataType) * snapshot.count);
+    }
+    return snapshot;
+}
+
+static void restore_slots(FunctionCompiler* compiler, Snapshot* snapshot) {
+    for (int i = 0; i < compiler->slot_capacity; i++) {
+        compiler->declared[i] = i < snapshot->count && snapshot->declared[i];
+        if (i < snapshot->count) compiler->types[i] = snapshot->types[i];
+    }
+    free(snapshot->declared);
+    free(snapshot->types);
+}
+
+// Frame slot of a resolved local, or -1 for globals and unknown variables
+static int local_index(FunctionCompiler* compiler, int depth, int slot) {
+    if (depth < 0 || depth >= compiler->scope_count || slot < 0) return -1;
+
+    Scope* scope = &compiler->scopes[compiler->scope_count - 1 - depth];
+    if (slot >= scope->size) return -1;
+    int index = scope->base + slot;
+    return compiler->declared[index] ? index : -1;
+}
+
+static JitFunction* new_jit_function(FunctionStmt* function) {
+    JitFunction* result = malloc(sizeof(JitFunction));
+    result->state = JIT_COMPILING;
+    result->function = function;
+    result->offset = 0;
+    result->code = NULL;
+    function->jit = result;
+
+    if (jit.function_count == jit.function_capacity) {
+        jit.function_capacity = jit.function_capacity < 16 ? 16 : jit.function_capacity * 2;
+        jit.functions = realloc(jit.functions, sizeof(JitFunction*) * jit.function_capacity);
+    }
+    jit.functions[jit.function_count++] = result;
+    return result;
+}
+
+// Find the function a global name is bound to when the caller is compiled
+static FunctionStmt* lookup_function(Environment* globals, const char* name) {
+    for (int i = 0; i < globals->variable_count; i++) {
+        if (globals->names[i] != name) continue;
+        Value* var = &globals->variables[i];
+        if (!var->is_function || var->value.function->native != NULL) return NULL;
+        return var->value.function->declaration;
+    }
+    return NULL;
+}
+
+static JitFunction* call_target(Batch* batch, FunctionStmt* function) {
+    if (function->jit != NULL) {
+        return function->jit->state == JIT_FAILED ? NULL : function->jit;
+    }
+
+    // Not compiled yet, it joins this batch
+    JitFunction* target = new_jit_function(function);
+    if (batch->count == batch->capacity) {
+        batch->capacity = batch->capacity < 8 ? 8 : batch->capacity * 2;
+        batch->functions = realloc(batch->functions, sizeof(JitFunction*) * batch->capacity);
+    }
+    batch->functions[batch->count++] = target;
+    return target;
+}
+
+static bool compile_expr(FunctionCompiler* compiler, Expr* expr, DataType* type);
+
+// A tail call leaves this function's frame first and jumps to the callee,
+// which then returns straight to our caller
+static bool compile_call(FunctionCompiler* compiler, CallExpr* call, bool tail, DataType* type) {
+    Code* code = &compiler->batch->code;
+    if (call->callee->type != EXPR_VARIABLE || call->callee->as.variable.depth >= 0) return false;
+
+    FunctionStmt* callee = lookup_function(compiler->batch->globals, call->callee->as.variable.name.lexeme);
+    if (callee == NULL || callee->param_count != call->arg_count ||
+        callee->param_count > JIT_MAX_PARAMS || !supported_type(callee->return_type)) {
+        return false;
+    }
+
+    JitFunction* target = call_target(compiler->batch, callee);
+    if (target == NULL) return false;
+
+    for (int i = 0; i < call->arg_count; i++) {
+        DataType arg_type;
+        if (!compile_expr(compiler, call->arguments[i], &arg_type)) return false;
+        if (!emit_coerce(code, arg_type, callee->param_types[i])) return false;
+        EMIT(code, 0x50);  // push rax
+        compiler->pushes++;
+    }
+
+    // pop r9, r8, rcx, rdx, rsi, rdi
+    static const uint8_t pops[JIT_MAX_PARAMS][2] = {
+        {0x5F, 0}, {0x5E, 0}, {0x5A, 0}, {0x59, 0}, {0x41, 0x58}, {0x41, 0x59}
+    };
+    for (int i = call->arg_count - 1; i >= 0; i--) {
+        emit(code, pops[i], pops[i][1] != 0 ? 2 : 1);
+        compiler->pushes--;
+    }
+
+    // Keep the stack 16-byte aligned at the call
+    bool pad = !tail && compiler->pushes % 2 != 0;
+    if (pad) EMIT(code, 0x48, 0x83, 0xEC, 0x08);  // sub rsp, 8
+    if (tail) {
+        emit_call_return(code);
+        EMIT(code, 0x48, 0x89, 0xEC, 0x5D);  // mov rsp, rbp; pop rbp
+    }
+
+    EMIT(code, 0x48, 0xB8);  // mov rax, imm64
+    if (target->state == JIT_COMPILED) {
+        emit_u64(code, (uint64_t)(uintptr_t)target->code);
+    } else {
+        Batch* batch = compiler->batch;
+        if (batch->patch_count == batch->patch_capacity) {
+            batch->patch_capacity = batch->patch_capacity < 8 ? 8 : batch->patch_capacity * 2;
+            batch->patches = realloc(batch->patches, sizeof(CallPatch) * batch->patch_capacity);
+        }
+        batch->patches[batch->patch_count].at = code->count;
+        batch->patches[batch->patch_count].target = target;
+        batch->patch_count++;
+        emit_u64(code, 0);
+    }
+    if (tail) {
+        EMIT(code, 0xFF, 0xE0);  // jmp rax
+    } else {
+        EMIT(code, 0xFF, 0xD0);  // call rax
+    }
+
+    if (pad) EMIT(code, 0x48, 0x83, 0xC4, 0x08);  // add rsp, 8
+
+    *type = callee->return_type;
+    return true;
+}
+
+static bool compile_binary(FunctionCompiler* compiler, BinaryExpr* binary, DataType* type) {
+    Code* code = &compiler->batch->code;
+    DataType left_type;
+    DataType right_type;
+
+    if (!compile_expr(compiler, binary->left, &left_type)) return false;
+    EMIT(code, 0x50);  // push rax
+    compiler->pushes++;
+    if (!compile_expr(compiler, binary->right, &right_type)) return false;
+    EMIT(code, 0x48, 0x89, 0xC1);  // mov rcx, rax
+    EMIT(code, 0x58);              // pop rax
+    compiler->pushes--;
+
+    // Int, long and bool operands have the same meaning here as in
+    // value_binary. An int meeting a long needs no widening since ints are
+    // kept sign-extended; long operations use the 64-bit forms (REX.W).
+    DataType operand_type;
+    if (!value_common_type(left_type, right_type, &operand_type) || !supported_type(operand_type) ||
+        !value_binary_supported(binary->operator.type, operand_type)) {
+        return false;
+    }
+    bool wide = operand_type == TYPE_LONG;
+
+    uint8_t condition;
+    switch (binary->operator.type) {
+        case TOKEN_PLUS:
+            emit_rex(code, wide);
+            EMIT(code, 0x01, 0xC8);  // add eax, ecx
+            break;
+        case TOKEN_MINUS:
+            emit_rex(code, wide);
+            EMIT(code, 0x29, 0xC8);  // sub eax, ecx
+            break;
+        case TOKEN_MULTIPLY:
+            emit_rex(code, wide);
+            EMIT(code, 0x0F, 0xAF, 0xC1);  // imul eax, ecx
+            break;
+        case TOKEN_DIVIDE:
+        case TOKEN_MODULO:
+            // A zero divisor is an error the interpreter reports
+            emit_rex(code, wide);
+            EMIT(code, 0x85, 0xC9, 0x75, 0x0C);  // test ecx, ecx; jne +12
+            emit_bailout(code);
+            emit_rex(code, wide);
+            EMIT(code, 0x99);        // cdq
+            emit_rex(code, wide);
+            EMIT(code, 0xF7, 0xF9);  // idiv ecx
+            if (binary->operator.type == TOKEN_MODULO) {
+                emit_rex(code, wide);
+                EMIT(code, 0x89, 0xD0);  // mov eax, edx
+            }
+            break;
+        case TOKEN_EQUALS:        condition = 0x94; goto compare;
+        case TOKEN_NOT_EQUALS:    condition = 0x95; goto compare;
+        case TOKEN_LESS:          condition = 0x9C; goto compare;
+        case TOKEN_LESS_EQUAL:    condition = 0x9E; goto compare;
+        case TOKEN_GREATER:       condition = 0x9F; goto compare;
+        case TOKEN_GREATER_EQUAL: condition = 0x9D; goto compare;
+        compare:
+            emit_rex(code, wide);
+            EMIT(code, 0x39, 0xC8);              // cmp eax, ecx
+            EMIT(code, 0x0F, condition, 0xC0);   // setcc al
+            EMIT(code, 0x0F, 0xB6, 0xC0);        // movzx eax, al
+            *type = TYPE_INT;
+            return true;
+        default:
+            return false;
+    }
+
+    if (!wide) emit_sign_extend(code);
+    *type = operand_type;
+    return true;
+}
+
+static bool compile_expr(FunctionCompiler* compiler, Expr* expr, DataType* type) {
+    Code* code = &compiler->batch->code;
+
+    switch (expr->type) {
+        case EXPR_LITERAL: {
+            LiteralExpr* literal = &expr->as.literal;
+            int32_t value;
+            if (literal->type == TYPE_INT) {
+                value = literal->as.int_val;
+            } else if (literal->type == TYPE_BOOL) {
+                value = literal->as.bool_val ? 1 : 0;
+            } else {
+                return false;
+            }
+            EMIT(code, 0x48, 0xC7, 0xC0);  // mov rax, imm32
+            emit_u32(code, (uint32_t)value);
+            *type = literal->type;
+            return true;
+        }
+        case EXPR_VARIABLE: {
+            int index = local_index(compiler, expr->as.variable.depth, expr->as.variable.slot);
+            if (index < 0) return false;
+            emit_load(code, index);
+            *type = compiler->types[index];
+            return true;
+        }
+        case EXPR_ASSIGN: {
+            AssignExpr* assign = &expr->as.assign;
+            DataType value_type;
+            if (!compile_expr(compiler, assign->value, &value_type)) return false;
+
+            // Assignment does not convert, a mismatch is an interpreter error
+            int index = local_index(compiler, assign->depth, assign->slot);
+            if (index < 0 || compiler->types[index] != value_type) return false;
+            emit_store(code, index);
+            *type = value_type;
+            return true;
+        }
+        case EXPR_BINARY:
+            return compile_binary(compiler, &expr->as.binary, type);
+        case EXPR_UNARY: {
+            DataType operand_type;
+            if (expr->as.unary.operator.type != TOKEN_MINUS) return false;
+            if (!compile_expr(compiler, expr->as.unary.operand, &operand_type)) return false;
+            if (operand_type == TYPE_LONG) {
+                EMIT(code, 0x48, 0xF7, 0xD8);  // neg rax
+            } else if (operand_type == TYPE_INT) {
+                EMIT(code, 0xF7, 0xD8);  // neg eax
+                emit_sign_extend(code);
+            } else {
+                return false;
+            }
+            *type = operand_type;
+            return true;
+        }
+        case EXPR_CALL:
+            return compile_call(compiler, &expr->as.call, false, type);
+        default:
+            return false;
+    }
+}
+
+// Evaluate a condition and jump over the following code when it is false.
+// Returns the patch site of the jump, or 0 if it cannot be compiled.
+static size_t compile_condition(FunctionCompiler* compiler, Expr* condition) {
+    Code* code = &compiler->batch->code;
+    DataType type;
+    if (!compile_expr(compiler, condition, &type)) return 0;
+    if (type != TYPE_INT && type != TYPE_BOOL) return 0;
+
+    EMIT(code, 0x48, 0x85, 0xC0);  // test rax, rax
+    static const uint8_t je[] = {0x0F, 0x84};
+    return emit_jump(code, je, sizeof(je));
+}
+
+static bool compile_stmt(FunctionCompiler* compiler, Stmt* stmt) {
+    Code* code = &compiler->batch->code;
+    if (stmt == NULL) return false;
+
+    switch (stmt->type) {
+        case STMT_EXPRESSION: {
+            DataType type;
+            return compile_expr(compiler, stmt->as.expression, &type);
+        }
+        case STMT_VAR_DECL: {
+            VarDeclStmt* decl = &stmt->as.var_decl;
+            if (decl->slot < 0 || !supported_type(decl->type) || compiler->scope_count == 0) return false;
+
+            Scope* scope = &compiler->scopes[compiler->scope_count - 1];
+            if (decl->slot >= scope->size) return false;
+            int index = scope->base + decl->slot;
+
+            // The variable exists before its initializer runs; a new one, or
+            // one redeclared with another type, starts out as zero
+            if (!compiler->declared[index] || compiler->types[index] != decl->type) {
+                EMIT(code, 0x48, 0xC7, 0x85);  // mov qword [rbp + slot], 0
+                emit_u32(code, (uint32_t)slot_offset(index));
+                emit_u32(code, 0);
+            }
+            compiler->declared[index] = true;
+            compiler->types[index] = decl->type;
+
+            if (decl->initializer != NULL) {
+                DataType type;
+                if (!compile_expr(compiler, decl->initializer, &type)) return false;
+                if (!emit_coerce(code, type, decl->type)) return false;
+                emit_store(code, index);
+            }
+            return true;
+        }
+        case STMT_BLOCK: {
+            BlockStmt* block = &stmt->as.block;
+            bool new_scope = block->count == 0 || block->statements[0]->type != STMT_VAR_DECL;
+            if (new_scope && !push_scope(compiler, block->scope_size)) return false;
+
+            for (int i = 0; i < block->count; i++) {
+                if (!compile_stmt(compiler, block->statements[i])) return false;
+            }
+
+            if (new_scope) pop_scope(compiler);
+            return true;
+        }
+        case STMT_IF: {
+            size_t else_jump = compile_condition(compiler, stmt->as.if_stmt.condition);
+            if (else_jump == 0) return false;
+
+            Snapshot snapshot = save_slots(compiler);
+            bool ok = compile_stmt(compiler, stmt->as.if_stmt.then_branch);
+            restore_slots(compiler, &snapshot);
+            if (!ok) return false;
+
+            if (stmt->as.if_stmt.else_branch == NULL) {
+                patch_jump(code, else_jump);
+                return true;
+            }
+
+            static const uint8_t jmp[] = {0xE9};
+            size_t end_jump = emit_jump(code, jmp, sizeof(jmp));
+            patch_jump(code, else_jump);
+
+            snapshot = save_slots(compiler);
+            ok = compile_stmt(compiler, stmt->as.if_stmt.else_branch);
+            restore_slots(compiler, &snapshot);
+            patch_jump(code, end_jump);
+            return ok;
+        }
+        case STMT_WHILE: {
+            size_t loop_start = code->count;
+            size_t exit_jump = compile_condition(compiler, stmt->as.while_stmt.condition);
+            if (exit_jump == 0) return false;
+
+            Snapshot snapshot = save_slots(compiler);
+            bool ok = compile_stmt(compiler, stmt->as.while_stmt.body);
+            restore_slots(compiler, &snapshot);
+            if (!ok) return false;
+
+            emit_loop(code, loop_start);
+            patch_jump(code, exit_jump);
+            return true;
+        }
+        case STMT_FOR: {
+            ForStmt* loop = &stmt->as.for_stmt;
+            if (!push_scope(compiler, loop->scope_size)) return false;
+            if (loop->init != NULL && !compile_stmt(compiler, loop->init)) return false;
+
+            size_t loop_start = code->count;
+            size_t exit_jump = 0;
+            if (loop->condition != NULL) {
+                exit_jump = compile_condition(compiler, loop->condition);
+                if (exit_jump == 0) return false;
+            }
+
+            // The increment runs after the body and sees what it defined
+            Snapshot snapshot = save_slots(compiler);
+            DataType type;
+            bool ok = compile_stmt(compiler, loop->body) &&
+                      (loop->increment == NULL || compile_expr(compiler, loop->increment, &type));
+            restore_slots(compiler, &snapshot);
+            if (!ok) return false;
+
+            emit_loop(code, loop_start);
+            if (exit_jump != 0) patch_jump(code, exit_jump);
+            pop_scope(compiler);
+            return true;
+        }
+        case STMT_RETURN: {
+            // A bare return is left to the interpreter
+            if (stmt->as.return_stmt.expression == NULL) return false;
+
+            DataType type;
+            Expr* expression = stmt->as.return_stmt.expression;
+            if (stmt->as.return_stmt.tail_call && compiler->pushes == 0) {
+                // Only a callee of the same return type gives the same result
+                FunctionStmt* callee = expression->as.call.callee->type == EXPR_VARIABLE
+                    ? lookup_function(compiler->batch->globals, expression->as.call.callee->as.variable.name.lexeme)
+                    : NULL;
+                if (callee == NULL || callee->return_type != compiler->function->return_type) return false;
+                return compile_call(compiler, &expression->as.call, true, &type);
+            }
+
+            if (!compile_expr(compiler, expression, &type)) return false;
+            // The returned value is not converted to the declared type
+            if (type != compiler->function->return_type) return false;
+
+            if (compiler->return_count == compiler->return_capacity) {
+                compiler->return_capacity = compiler->return_capacity < 8 ? 8 : compiler->return_capacity * 2;
+                compiler->returns = realloc(compiler->returns, sizeof(size_t) * compiler->return_capacity);
+            }
+            static const uint8_t jmp[] = {0xE9};
+            compiler->returns[compiler->return_count++] = emit_jump(code, jmp, sizeof(jmp));
+            return true;
+        }
+        default:
+            return false;
+    }
+}
+
+static bool compile_function(Batch* batch, JitFunction* target) {
+    FunctionStmt* function = target->function;
+    if (function->param_count > JIT_MAX_PARAMS || !supported_type(function->return_type)) return false;
+    for (int i = 0; i < function->param_count; i++) {
+        if (!supported_type(function->param_types[i])) return false;
+    }
+
+    FunctionCompiler compiler = {0};
+    compiler.batch = batch;
+    compiler.function = function;
+
+    Code* code = &batch->code;
+    target->offset = code->count;
+
+    // push rbp; mov rbp, rsp; sub rsp, imm32
+    EMIT(code, 0x55, 0x48, 0x89, 0xE5, 0x48, 0x81, 0xEC);
+    size_t frame_patch = code->count;
+    emit_u32(code, 0);
+    emit_stack_check(code);
+
+    // The call environment holds the parameters in its first slots
+    push_scope(&compiler, function->scope_size);
+    static const uint8_t stores[JIT_MAX_PARAMS][2] = {
+        {0x48, 0xBD}, {0x48, 0xB5}, {0x48, 0x95}, {0x48, 0x8D}, {0x4C, 0x85}, {0x4C, 0x8D}
+    };
+    for (int i = 0; i < function->param_count; i++) {
+        EMIT(code, stores[i][0], 0x89, stores[i][1]);  // mov [rbp + slot], reg
+        emit_u32(code, (uint32_t)slot_offset(i));
+        compiler.declared[i] = true;
+        compiler.types[i] = function->param_types[i];
+    }
+
+    bool ok = compile_stmt(&compiler, function->body);
+    if (ok) {
+        // Falling off the end returns the type's default value
+        EMIT(code, 0x31, 0xC0);  // xor eax, eax
+        for (int i = 0; i < compiler.return_count; i++) {
+            patch_jump(code, compiler.returns[i]);
+        }
+        emit_call_return(code);
+        EMIT(code, 0x48, 0x89, 0xEC, 0x5D, 0xC3);  // mov rsp, rbp; pop rbp; ret
+
+        uint32_t frame = (uint32_t)((compiler.frame_size * 8 + 15) & ~15);
+        patch_u32(code, frame_patch, frame);
+    }
+
+    free(compiler.declared);
+    free(compiler.types);
+    free(compiler.returns);
+    return ok;
+}
+
+#ifdef JIT_SUPPORTED
+
+// Executable memory is mapped writable first so call addresses can be filled in
+static uint8_t* reserve_code(size_t count) {
+    size_t page = (size_t)sysconf(_SC_PAGESIZE);
+    size_t size = (count + page - 1) & ~(page - 1);
+    void* memory = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (memory == MAP_FAILED) return NULL;
+
+    if (jit.region_count == jit.region_capacity) {
+        jit.region_capacity = jit.region_capacity < 8 ? 8 : jit.region_capacity * 2;
+        jit.regions = realloc(jit.regions, sizeof(void*) * jit.region_capacity);
+        jit.region_sizes = realloc(jit.region_sizes, sizeof(size_t) * jit.region_capacity);
+    }
+    jit.regions[jit.region_count] = memory;
+    jit.region_sizes[jit.region_count] = size;
+    jit.region_count++;
+    return memory;
+}
+
+static bool install_code(uint8_t* memory, const uint8_t* bytes, size_t count) {
+    memcpy(memory, bytes, count);
+    return mprotect(memory, jit.region_sizes[jit.region_count - 1], PROT_READ | PROT_EXEC) == 0;
+}
+
+// bool entry(void* code, const int64_t* args, int64_t* result) calls code with
+// six register arguments. The bailout path restores the stack pointer saved
+// on entry and makes entry return false.
+static bool init_runtime(void) {
+    Code code = {0};
+    EMIT(&code, 0x55, 0x53, 0x41, 0x54, 0x41, 0x55);  // push rbp, rbx, r12, r13
+    EMIT(&code, 0x48, 0x83, 0xEC, 0x08);              // sub rsp, 8
+    EMIT(&code, 0x49, 0x89, 0xD4);                    // mov r12, rdx
+    EMIT(&code, 0x48, 0xB8);                          // mov rax, &saved_rsp
+    emit_u64(&code, (uint64_t)(uintptr_t)&jit.saved_rsp);
+    EMIT(&code, 0x48, 0x89, 0x20);                    // mov [rax], rsp
+    EMIT(&code, 0x48, 0x89, 0xF8);                    // mov rax, rdi
+    EMIT(&code, 0x49, 0x89, 0xF5);                    // mov r13, rsi
+    EMIT(&code, 0x49, 0x8B, 0x7D, 0x00);              // mov rdi, [r13]
+    EMIT(&code, 0x49, 0x8B, 0x75, 0x08);              // mov rsi, [r13 + 8]
+    EMIT(&code, 0x49, 0x8B, 0x55, 0x10);              // mov rdx, [r13 + 16]
+    EMIT(&code, 0x49, 0x8B, 0x4D, 0x18);              // mov rcx, [r13 + 24]
+    EMIT(&code, 0x4D, 0x8B, 0x45, 0x20);              // mov r8, [r13 + 32]
+    EMIT(&code, 0x4D, 0x8B, 0x4D, 0x28);              // mov r9, [r13 + 40]
+    EMIT(&code, 0xFF, 0xD0);                          // call rax
+    EMIT(&code, 0x49, 0x89, 0x04, 0x24);              // mov [r12], rax
+    EMIT(&code, 0xB8, 0x01, 0x00, 0x00, 0x00);        // mov eax, 1
+    size_t done = code.count;
+    EMIT(&code, 0x48, 0x83, 0xC4, 0x08);              // add rsp, 8
+    EMIT(&code, 0x41, 0x5D, 0x41, 0x5C, 0x5B, 0x5D);  // pop r13, r12, rbx, rbp
+    EMIT(&code, 0xC3);                                // ret
+
+    size_t bailout = code.count;
+    EMIT(&code, 0x48, 0xB8);                          // mov rax, &saved_rsp
+    emit_u64(&code, (uint64_t)(uintptr_t)&jit.saved_rsp);
+    EMIT(&code, 0x48, 0x8B, 0x20);                    // mov rsp, [rax]
+    EMIT(&code, 0x31, 0xC0);                          // xor eax, eax
+    emit_loop(&code, done);                           // jmp done
+
+    uint8_t* memory = reserve_code(code.count);
+    bool installed = memory != NULL && install_code(memory, code.bytes, code.count);
+    free(code.bytes);
+    if (!installed) return false;
+
+    jit.entry = memory;
+    jit.bailout = memory + bailout;
+    return true;
+}
+
+#endif
+
+bool jit_compile(FunctionStmt* function, Environment* globals) {
+    Batch batch = {0};
+    batch.globals = globals;
+    call_target(&batch, function);
+
+    bool ok = false;
+    int failed = -1;
+    uint8_t* memory = NULL;
+#ifdef JIT_SUPPORTED
+    ok = jit.entry != NULL || init_runtime();
+    // Functions reached through calls are appended while compiling
+    for (int i = 0; ok && i < batch.count; i++) {
+        if (!compile_function(&batch, batch.functions[i])) {
+            failed = i;
+            ok = false;
+        }
+    }
+
+    memory = ok ? reserve_code(batch.code.count) : NULL;
+    ok = memory != NULL;
+    if (ok) {
+        // Addresses inside the batch are only known now
+        for (int i = 0; i < batch.patch_count; i++) {
+            uint64_t address = (uint64_t)(uintptr_t)(memory + batch.patches[i].target->offset);
+            memcpy(batch.code.bytes + batch.patches[i].at, &address, sizeof(address));
+        }
+        ok = install_code(memory, batch.code.bytes, batch.code.count);
+    }
+#endif
+
+    for (int i = 0; i < batch.count; i++) {
+        JitFunction* compiled = batch.functions[i];
+        if (ok) {
+            compiled->code = memory + compiled->offset;
+            compiled->state = JIT_COMPILED;
+        } else if (failed >= 0 && i != failed) {
+            // Only the function that could not be translated is given up
+            // on, the others may still be compiled when they get hot
+            compiled->function->jit = NULL;
+        } else {
+            compiled->state = JIT_FAILED;
+        }
+    }
+
+    free(batch.code.bytes);
+    free(batch.functions);
+    free(batch.patches);
+    return ok;
+}
+
+JitOutcome jit_call(FunctionStmt* function, Value* args, int max_depth, uintptr_t stack_limit, Value* result) {
+#ifdef JIT_SUPPORTED
+    if (function->jit == NULL || function->jit->state != JIT_COMPILED) return JIT_INTERPRET;
+
+    int64_t values[JIT_MAX_PARAMS] = {0};
+    for (int i = 0; i < function->param_count; i++) {
+        switch (function->param_types[i]) {
+            case TYPE_INT:  values[i] = args[i].value.int_val; break;
+            case TYPE_BOOL: values[i] = args[i].value.bool_val; break;
+            default:        values[i] = args[i].value.long_val; break;
+        }
+    }
+
+    typedef bool (*Entry)(void* code, const int64_t* args, int64_t* result);
+    Entry entry = (Entry)(uintptr_t)jit.entry;
+    int64_t value;
+    // The function's own call is counted already
+    jit.calls_left = (int64_t)max_depth + 1;
+    jit.stack_limit = stack_limit;
+    if (!entry(function->jit->code, values, &value)) {
+        if (jit.calls_left == CALLS_TOO_DEEP) return JIT_STACK_OVERFLOW;
+        return jit.calls_left == CALLS_OUT_OF_STACK ? JIT_OUT_OF_STACK : JIT_INTERPRET;
+    }
+
+    *result = value_default(function->return_type);
+    switch (function->return_type) {
+        case TYPE_INT:  result->value.int_val = (int)value; break;
+        case TYPE_BOOL: result->value.bool_val = (int)value; break;
+        default:        result->value.long_val = (long)value; break;
+    }
+    return JIT_RETURNED;
+#else
+    (void)function;
+    (void)args;
+    (void)max_depth;
+    (void)stack_limit;
+    (void)result;
+    return JIT_INTERPRET;
+#endif
+}
+
+void jit_invalidate(void) {
+    // Nothing compiled can be running: the interpreter is the caller
+    for (int i = 0; i < jit.function_count; i++) {
+        FunctionStmt* function = jit.functions[i]->function;
+        if (function->jit == jit.functions[i]) {
+            function->jit = NULL;
+            function->call_count = 0;
+        }
+    }
+}
+
+void jit_free(void) {
+#ifdef JIT_SUPPORTED
+    for (int i = 0; i < jit.region_count; i++) {
+        munmap(jit.regions[i], jit.region_sizes[i]);
+    }
+#endif
+    free(jit.regions);
+    free(jit.region_sizes);
+
+    for (int i = 0; i < jit.function_count; i++) {
+        jit.functions[i]->function->jit = NULL;
+        free(jit.functions[i]);
+    }
+    free(jit.functions);
+    memset(&jit, 0, sizeof(jit));
+}
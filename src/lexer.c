@@ -8,23 +8,20 @@
 static Token make_token(Lexer* lexer, TokenType type) {
     Token token;
     token.type = type;
+    token.lexeme = &lexer->source[lexer->start];
+    token.length = lexer->current - lexer->start;
     token.line = lexer->line;
     token.column = lexer->column;
-    
-    int length = lexer->current - lexer->start;
-    token.lexeme = (char*)malloc(length + 1);
-    strncpy(token.lexeme, &lexer->source[lexer->start], length);
-    token.lexeme[length] = '\0';
-    
     return token;
 }
 
 static Token error_token(Lexer* lexer, const char* message) {
     Token token;
     token.type = TOKEN_ERROR;
+    token.lexeme = message;
+    token.length = (int)strlen(message);
     token.line = lexer->line;
     token.column = lexer->column;
-    token.lexeme = strdup(message);
     return token;
 }
 
@@ -122,9 +119,7 @@ static void skip_whitespace(Lexer* lexer) {
 }
 
 static Token string(Lexer* lexer) {
-    // Skip the opening quote
-    advance(lexer);
-    
+    // The opening quote has already been consumed
     while (!is_at_end(lexer)) {
         if (peek(lexer) == '\\' && peek_next(lexer) == '"') {
             // Escaped quote, skip both backslash and quote
@@ -148,32 +143,11 @@ static Token string(Lexer* lexer) {
     // The closing quote.
     advance(lexer);
     
-    // Create token with the string content (excluding quotes)
-    Token token;
-    token.type = TOKEN_STRING_LITERAL;
-    token.line = lexer->line;
-    token.column = lexer->column;
-    
-    // Allocate space for the string content
-    int length = lexer->current - lexer->start - 2;  // -2 for the quotes
-    token.lexeme = (char*)malloc(length + 1);
-    
-    // Copy the string content, handling escaped characters
-    int j = 0;
-    for (int i = lexer->start + 1; i < lexer->current - 1; i++) {
-        if (lexer->source[i] == '\\' && i + 1 < lexer->current - 1) {
-            if (lexer->source[i + 1] == '"') {
-                token.lexeme[j++] = '"';
-                i++; // Skip the next character (")
-            } else {
-                token.lexeme[j++] = lexer->source[i];
-            }
-        } else {
-            token.lexeme[j++] = lexer->source[i];
-        }
-    }
-    token.lexeme[j] = '\0';
-    
+    // The lexeme is the raw content between the quotes, escapes are
+    // rewritten when the literal is decoded
+    Token token = make_token(lexer, TOKEN_STRING_LITERAL);
+    token.lexeme++;
+    token.length -= 2;
     return token;
 }
 
@@ -261,11 +235,17 @@ static TokenType identifier_type(Lexer* lexer) {
             else if (lexer->current - lexer->start == 6 &&
                 strncmp(lexer->source + lexer->start + 1, "emove", 5) == 0)
                 return TOKEN_REMOVE;
+            else if (lexer->current - lexer->start == 7 &&
+                strncmp(lexer->source + lexer->start + 1, "eserve", 6) == 0)
+                return TOKEN_RESERVE;
             break;
         case 's':
             if (lexer->current - lexer->start == 6 &&
                 strncmp(lexer->source + lexer->start + 1, "tring", 5) == 0)
                 return TOKEN_STRING;
+            else if (lexer->current - lexer->start == 4 &&
+                strncmp(lexer->source + lexer->start + 1, "ort", 3) == 0)
+                return TOKEN_SORT;
             break;
         case 'v':
             if (lexer->current - lexer->start == 4 &&
@@ -351,6 +331,25 @@ Token lexer_next_token(Lexer* lexer) {
     return error_token(lexer, "Unexpected character.");
 }
 
+Token* lexer_tokenize(Lexer* lexer, int* count) {
+    int capacity = 256;
+    Token* tokens = malloc(sizeof(Token) * capacity);
+    *count = 0;
+    
+    for (;;) {
+        if (*count == capacity) {
+            capacity *= 2;
+            tokens = realloc(tokens, sizeof(Token) * capacity);
+        }
+        
+        Token token = lexer_next_token(lexer);
+        tokens[(*count)++] = token;
+        if (token.type == TOKEN_EOF) break;
+    }
+    
+    return tokens;
+}
+
 Token lexer_peek_token(Lexer* lexer) {
     int current_pos = lexer->current;
     int current_line = lexer->line;
@@ -0,0 +1,220 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "headers/module.h"
+#include "headers/output.h"
+#include "headers/lexer.h"
+#include "headers/parser.h"
+#include "headers/optimizer.h"
+#include "headers/checker.h"
+
+// Every file included by the program, keyed by its canonical path. Modules
+// are never unloaded before module_cache_free, so function declarations in
+// their trees stay valid for the whole run.
+typedef struct {
+    Module** modules;
+    int count;
+    int capacity;
+} ModuleCache;
+
+// Include name as written -> canonical path, so repeated includes of the same
+// name skip the filesystem probing
+typedef struct {
+    char* name;
+    char* path;
+} PathMemo;
+
+typedef struct {
+    PathMemo* entries;
+    int count;
+    int capacity;
+} PathMemoTable;
+
+static ModuleCache cache;
+static PathMemoTable memo;
+
+// Strip the surrounding quotes from an include path literal
+char* module_include_path(const char* lexeme) {
+    char* path = strdup(lexeme);
+    if (path[0] == '"') {
+        // Remove opening quote
+        memmove(path, path + 1, strlen(path));
+    }
+    
+    // Remove closing quote if exists
+    int len = strlen(path);
+    if (len > 0 && path[len - 1] == '"') {
+        path[len - 1] = '\0';
+    }
+    
+    return path;
+}
+
+// Get the full path to a library file
+char* module_resolve_path(const char* filename) {
+    // Check if it's a relative path or stdlib reference
+    if (filename[0] == '/' || 
+        (filename[0] == '.' && filename[1] == '/') || 
+        (filename[0] == '.' && filename[1] == '.' && filename[2] == '/')) {
+        // It's a relative or absolute path, use it directly
+        return strdup(filename);
+    }
+    
+    // Try looking in the standard library
+    char* stdlib_path = malloc(strlen("lib/stdlib/") + strlen(filename) + 1);
+    sprintf(stdlib_path, "lib/stdlib/%s", filename);
+    if (access(stdlib_path, R_OK) == 0) {
+        return stdlib_path;
+    }
+    free(stdlib_path);
+    
+    // Try looking in the current directory
+    if (access(filename, R_OK) == 0) {
+        return strdup(filename);
+    }
+    
+    return NULL;
+}
+
+// Read the contents of a file
+char* module_read_source(const char* path) {
+    FILE* file = fopen(path, "r");
+    if (!file) {
+        output_error("Error: Cannot open file: %s\n", path);
+        return NULL;
+    }
+    
+    // Get file size
+    fseek(file, 0, SEEK_END);
+    long size = ftell(file);
+    rewind(file);
+    
+    // Allocate buffer
+    char* buffer = malloc(size + 1);
+    if (!buffer) {
+        output_error("Error: Memory allocation failed when reading file: %s\n", path);
+        fclose(file);
+        return NULL;
+    }
+    
+    // Read file content
+    size_t bytes_read = fread(buffer, 1, size, file);
+    if (bytes_read < (size_t)size) {
+        output_error("Error: Failed to read entire file: %s (read %zu of %ld bytes)\n", 
+                     path, bytes_read, size);
+        free(buffer);
+        fclose(file);
+        return NULL;
+    }
+    
+    buffer[bytes_read] = '\0';
+    
+    fclose(file);
+    return buffer;
+}
+
+// Resolve an include name to the canonical path that keys the cache
+static const char* canonical_path(const char* name) {
+    for (int i = 0; i < memo.count; i++) {
+        if (strcmp(memo.entries[i].name, name) == 0) return memo.entries[i].path;
+    }
+    
+    char* found = module_resolve_path(name);
+    if (found == NULL) return NULL;
+    
+    char* path = realpath(found, NULL);
+    free(found);
+    if (path == NULL) return NULL;
+    
+    if (memo.count == memo.capacity) {
+        memo.capacity = memo.capacity < 8 ? 8 : memo.capacity * 2;
+        memo.entries = realloc(memo.entries, sizeof(PathMemo) * memo.capacity);
+    }
+    memo.entries[memo.count].name = strdup(name);
+    memo.entries[memo.count].path = path;
+    memo.count++;
+    return path;
+}
+
+static Module* parse_module(const char* path) {
+    char* source = module_read_source(path);
+    if (source == NULL) return NULL;
+    
+    Module* module = malloc(sizeof(Module));
+    module->path = strdup(path);
+    arena_init(&module->arena);
+    
+    Lexer lexer;
+    lexer_init(&lexer, source);
+    Parser parser;
+    parser_init(&parser, &lexer, &module->arena);
+    module->statements = parse(&parser, &module->count);
+    // The tree holds no pointers into the source
+    free(source);
+    
+    if (parser.had_error) {
+        output_error("Error: Failed to parse included file: %s\n", path);
+        arena_free(&module->arena);
+        free(module->path);
+        free(module);
+        return NULL;
+    }
+    optimize(module->statements, module->count);
+    
+    if (!check(module->statements, module->count)) {
+        output_error("Error: Type errors in included file: %s\n", path);
+        arena_free(&module->arena);
+        free(module->path);
+        free(module);
+        return NULL;
+    }
+    return module;
+}
+
+Module* module_load(const char* name, bool* first_load) {
+    const char* path = canonical_path(name);
+    if (path == NULL) {
+        output_error("Error: Could not find library file: %s\n", name);
+        return NULL;
+    }
+    
+    for (int i = 0; i < cache.count; i++) {
+        if (strcmp(cache.modules[i]->path, path) == 0) {
+            *first_load = false;
+            return cache.modules[i];
+        }
+    }
+    
+    Module* module = parse_module(path);
+    if (module == NULL) return NULL;
+    
+    if (cache.count == cache.capacity) {
+        cache.capacity = cache.capacity < 8 ? 8 : cache.capacity * 2;
+        cache.modules = realloc(cache.modules, sizeof(Module*) * cache.capacity);
+    }
+    cache.modules[cache.count++] = module;
+    *first_load = true;
+    return module;
+}
+
+void module_cache_free(void) {
+    for (int i = 0; i < cache.count; i++) {
+        arena_free(&cache.modules[i]->arena);
+        free(cache.modules[i]->path);
+        free(cache.modules[i]);
+    }
+    free(cache.modules);
+    cache.modules = NULL;
+    cache.count = 0;
+    cache.capacity = 0;
+    
+    for (int i = 0; i < memo.count; i++) {
+        free(memo.entries[i].name);
+        free(memo.entries[i].path);
+    }
+    free(memo.entries);
+    memo.entries = NULL;
+    memo.count = 0;
+    memo.capacity = 0;
+}
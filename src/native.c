@@ -0,0 +1,220 @@
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+#include "headers/native.h"
+#include "headers/reduce.h"
+#include "headers/sort.h"
+
+static void print_args(Output* output, Value* args, int arg_count) {
+    for (int i = 0; i < arg_count; i++) {
+        print_value(output, args[i]);
+        if (i < arg_count - 1) {
+            output_char(output, ' ');
+        }
+    }
+}
+
+static bool native_print(Output* output, Value* args, int arg_count, Value* result) {
+    print_args(output, args, arg_count);
+    *result = value_default(TYPE_VOID);
+    return true;
+}
+
+static bool native_println(Output* output, Value* args, int arg_count, Value* result) {
+    print_args(output, args, arg_count);
+    output_char(output, '\n');
+    *result = value_default(TYPE_VOID);
+    return true;
+}
+
+static bool native_flush(Output* output, Value* args, int arg_count, Value* result) {
+    (void)args;
+    (void)arg_count;
+    output_flush(output);
+    *result = value_default(TYPE_VOID);
+    return true;
+}
+
+static bool native_sqrt(Output* output, Value* args, int arg_count, Value* result) {
+    (void)output;
+    (void)arg_count;
+    if (args[0].value.float_val < 0.0f) {
+        output_error("Cannot take the square root of a negative number\n");
+        return false;
+    }
+    *result = value_default(TYPE_FLOAT);
+    result->value.float_val = sqrtf(args[0].value.float_val);
+    return true;
+}
+
+static bool native_int_to_string(Output* output, Value* args, int arg_count, Value* result) {
+    (void)output;
+    (void)arg_count;
+    char buffer[16];
+    int length = snprintf(buffer, sizeof(buffer), "%d", args[0].value.int_val);
+    *result = value_string(buffer, length);
+    return true;
+}
+
+static bool native_join(Output* output, Value* args, int arg_count, Value* result) {
+    (void)output;
+    (void)arg_count;
+    return list_join(args[0].value.list_val, args[1], result);
+}
+
+// The list reductions work on int lists; an empty list counts as one
+static List* int_list(Value value, const char* function) {
+    List* list = value.value.list_val;
+    if (list->count > 0 && list->item_type != TYPE_INT) {
+        output_error("'%s' expects a list of ints\n", function);
+        return NULL;
+    }
+    return list;
+}
+
+static bool native_sum(Output* output, Value* args, int arg_count, Value* result) {
+    (void)output;
+    (void)arg_count;
+    List* list = int_list(args[0], "sum");
+    if (list == NULL) return false;
+    *result = value_default(TYPE_INT);
+    result->value.int_val = reduce_sum(list->items.ints, list->count);
+    return true;
+}
+
+static bool native_min_value(Output* output, Value* args, int arg_count, Value* result) {
+    (void)output;
+    (void)arg_count;
+    List* list = int_list(args[0], "min_value");
+    if (list == NULL) return false;
+    if (list->count == 0) {
+        output_error("Cannot find minimum of empty list\n");
+        return false;
+    }
+    *result = value_default(TYPE_INT);
+    result->value.int_val = reduce_min(list->items.ints, list->count);
+    return true;
+}
+
+static bool native_max_value(Output* output, Value* args, int arg_count, Value* result) {
+    (void)output;
+    (void)arg_count;
+    List* list = int_list(args[0], "max_value");
+    if (list == NULL) return false;
+    if (list->count == 0) {
+        output_error("Cannot find maximum of empty list\n");
+        return false;
+    }
+    *result = value_default(TYPE_INT);
+    result->value.int_val = reduce_max(list->items.ints, list->count);
+    return true;
+}
+
+static bool native_contains(Output* output, Value* args, int arg_count, Value* result) {
+    (void)output;
+    (void)arg_count;
+    List* list = int_list(args[0], "contains");
+    if (list == NULL) return false;
+    *result = value_default(TYPE_BOOL);
+    result->value.bool_val = reduce_index_of(list->items.ints, list->count, args[1].value.int_val) >= 0;
+    return true;
+}
+
+static bool native_index_of(Output* output, Value* args, int arg_count, Value* result) {
+    (void)output;
+    (void)arg_count;
+    List* list = int_list(args[0], "index_of");
+    if (list == NULL) return false;
+    *result = value_default(TYPE_INT);
+    result->value.int_val = reduce_index_of(list->items.ints, list->count, args[1].value.int_val);
+    return true;
+}
+
+// The searches expect the list sorted in ascending order, as list.sort() leaves it
+static bool native_binary_search(Output* output, Value* args, int arg_count, Value* result) {
+    (void)output;
+    (void)arg_count;
+    List* list = int_list(args[0], "binary_search");
+    if (list == NULL) return false;
+    int value = args[1].value.int_val;
+    int index = sort_lower_bound(list->items.ints, list->count, value);
+    *result = value_default(TYPE_INT);
+    result->value.int_val = index < list->count && list->items.ints[index] == value ? index : -1;
+    return true;
+}
+
+static bool native_lower_bound(Output* output, Value* args, int arg_count, Value* result) {
+    (void)output;
+    (void)arg_count;
+    List* list = int_list(args[0], "lower_bound");
+    if (list == NULL) return false;
+    *result = value_default(TYPE_INT);
+    result->value.int_val = sort_lower_bound(list->items.ints, list->count, args[1].value.int_val);
+    return true;
+}
+
+static bool native_upper_bound(Output* output, Value* args, int arg_count, Value* result) {
+    (void)output;
+    (void)arg_count;
+    List* list = int_list(args[0], "upper_bound");
+    if (list == NULL) return false;
+    *result = value_default(TYPE_INT);
+    result->value.int_val = sort_upper_bound(list->items.ints, list->count, args[1].value.int_val);
+    return true;
+}
+
+const Native natives[] = {
+    {"print",         native_print,         -1, TYPE_VOID,   {0}},
+    {"println",       native_println,       -1, TYPE_VOID,   {0}},
+    {"flush",         native_flush,          0, TYPE_VOID,   {0}},
+    {"sqrt",          native_sqrt,           1, TYPE_FLOAT,  {TYPE_FLOAT}},
+    {"int_to_string", native_int_to_string,  1, TYPE_STRING, {TYPE_INT}},
+    {"join",          native_join,           2, TYPE_STRING, {TYPE_LIST, TYPE_STRING}},
+    {"sum",           native_sum,            1, TYPE_INT,    {TYPE_LIST}},
+    {"min_value",     native_min_value,      1, TYPE_INT,    {TYPE_LIST}},
+    {"max_value",     native_max_value,      1, TYPE_INT,    {TYPE_LIST}},
+    {"contains",      native_contains,       2, TYPE_BOOL,   {TYPE_LIST, TYPE_INT}},
+    {"index_of",      native_index_of,       2, TYPE_INT,    {TYPE_LIST, TYPE_INT}},
+    {"binary_search", native_binary_search,  2, TYPE_INT,    {TYPE_LIST, TYPE_INT}},
+    {"lower_bound",   native_lower_bound,    2, TYPE_INT,    {TYPE_LIST, TYPE_INT}},
+    {"upper_bound",   native_upper_bound,    2, TYPE_INT,    {TYPE_LIST, TYPE_INT}},
+    {NULL,            NULL,                  0, TYPE_VOID,   {0}},
+};
+
+const Native* native_lookup(const char* name) {
+    for (const Native* native = natives; native->name != NULL; native++) {
+        if (strcmp(native->name, name) == 0) return native;
+    }
+    return NULL;
+}
+
+// Each builtin is called through a Callable of its own
+static Callable native_callables[sizeof(natives) / sizeof(natives[0])];
+
+Value native_value(const Native* native) {
+    Callable* callable = &native_callables[native - natives];
+    callable->native = native;
+
+    Value value = {0};
+    value.type = native->return_type;
+    value.is_function = true;
+    value.value.function = callable;
+    return value;
+}
+
+bool native_call(const Native* native, Output* output, Value* args, int arg_count, Value* result) {
+    if (native->arity >= 0) {
+        if (arg_count != native->arity) {
+            output_error("Expected %d arguments but got %d\n", native->arity, arg_count);
+            return false;
+        }
+        for (int i = 0; i < arg_count; i++) {
+            if (args[i].is_function || !value_coerce(native->param_types[i], &args[i])) {
+                output_error("Type mismatch in argument %d of '%s'\n", i + 1, native->name);
+                return false;
+            }
+        }
+    }
+
+    return native->function(output, args, arg_count, result);
+}
@@ -0,0 +1,545 @@
+#include <limits.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "headers/optimizer.h"
+#include "headers/pool.h"
+#include "headers/value.h"
+
+// The optimizer rewrites expressions in place. Literal operands are folded
+// with value_binary, the same code every engine runs, and anything that
+// would fail at runtime is left for the runtime to report. Inside functions,
+// a local declared once with a literal initializer and never assigned is
+// replaced by that literal where it is in scope, and additions of zero and
+// multiplications or divisions by one are dropped when the other operand's
+// type is known.
+
+// How often a name is declared in the function being optimized
+typedef struct {
+    const char* name;
+    int declarations;
+} Name;
+
+// A local in scope at the current point of the walk
+typedef struct {
+    const char* name;
+    DataType type;
+    Expr* constant;    // Literal the local always holds, NULL if it may change
+} Local;
+
+typedef struct {
+    const char** assigned;   // Every name assigned anywhere in the program
+    int assigned_count;
+    int assigned_capacity;
+    Name* names;
+    int name_count;
+    int name_capacity;
+    Local* locals;
+    int local_count;
+    int local_capacity;
+    bool in_function;
+} Optimizer;
+
+static Optimizer optimizer;
+static int optimize_level = OPTIMIZE_DEFAULT;
+
+static void optimize_stmt(Stmt* stmt);
+static void optimize_expr(Expr* expr);
+
+void optimizer_set_level(int level) {
+    optimize_level = level;
+}
+
+static bool is_assigned(const char* name) {
+    for (int i = 0; i < optimizer.assigned_count; i++) {
+        if (optimizer.assigned[i] == name) return true;
+    }
+    return false;
+}
+
+static Name* find_name(const char* name) {
+    for (int i = 0; i < optimizer.name_count; i++) {
+        if (optimizer.names[i].name == name) return &optimizer.names[i];
+    }
+    return NULL;
+}
+
+static void count_declaration(const char* name) {
+    Name* entry = find_name(name);
+    if (entry != NULL) {
+        entry->declarations++;
+        return;
+    }
+
+    if (optimizer.name_count == optimizer.name_capacity) {
+        optimizer.name_capacity = optimizer.name_capacity < 8 ? 8 : optimizer.name_capacity * 2;
+        optimizer.names = realloc(optimizer.names, sizeof(Name) * optimizer.name_capacity);
+    }
+    optimizer.names[optimizer.name_count].name = name;
+    optimizer.names[optimizer.name_count].declarations = 1;
+    optimizer.name_count++;
+}
+
+static void collect_expr(Expr* expr) {
+    if (expr == NULL) return;
+
+    switch (expr->type) {
+        case EXPR_LITERAL:
+        case EXPR_VARIABLE:
+            break;
+        case EXPR_BINARY:
+            collect_expr(expr->as.binary.left);
+            collect_expr(expr->as.binary.right);
+            break;
+        case EXPR_UNARY:
+            collect_expr(expr->as.unary.operand);
+            break;
+        case EXPR_ASSIGN:
+            collect_expr(expr->as.assign.value);
+            if (!is_assigned(expr->as.assign.name.lexeme)) {
+                if (optimizer.assigned_count == optimizer.assigned_capacity) {
+                    optimizer.assigned_capacity = optimizer.assigned_capacity < 8 ? 8 : optimizer.assigned_capacity * 2;
+                    optimizer.assigned = realloc(optimizer.assigned, sizeof(const char*) * optimizer.assigned_capacity);
+                }
+                optimizer.assigned[optimizer.assigned_count++] = expr->as.assign.name.lexeme;
+            }
+            break;
+        case EXPR_CALL:
+            collect_expr(expr->as.call.callee);
+            for (int i = 0; i < expr->as.call.arg_count; i++) {
+                collect_expr(expr->as.call.arguments[i]);
+            }
+            break;
+        case EXPR_LIST_ACCESS:
+            collect_expr(expr->as.list_access.list);
+            collect_expr(expr->as.list_access.index);
+            break;
+        case EXPR_LIST_METHOD:
+            collect_expr(expr->as.list_method.list);
+            collect_expr(expr->as.list_method.argument);
+            break;
+        case EXPR_LIST_PROPERTY:
+            collect_expr(expr->as.list_property.list);
+            break;
+    }
+}
+
+// Record assigned names and, inside a function, how often each name is
+// declared. Nested function declarations are counted on their own.
+static void collect_stmt(Stmt* stmt, bool declarations) {
+    if (stmt == NULL) return;
+
+    switch (stmt->type) {
+        case STMT_EXPRESSION:
+            collect_expr(stmt->as.expression);
+            break;
+        case STMT_VAR_DECL:
+            if (declarations) count_declaration(stmt->as.var_decl.name.lexeme);
+            collect_expr(stmt->as.var_decl.initializer);
+            break;
+        case STMT_BLOCK:
+            for (int i = 0; i < stmt->as.block.count; i++) {
+                collect_stmt(stmt->as.block.statements[i], declarations);
+            }
+            break;
+        case STMT_IF:
+            collect_expr(stmt->as.if_stmt.condition);
+            collect_stmt(stmt->as.if_stmt.then_branch, declarations);
+            collect_stmt(stmt->as.if_stmt.else_branch, declarations);
+            break;
+        case STMT_WHILE:
+            collect_expr(stmt->as.while_stmt.condition);
+            collect_stmt(stmt->as.while_stmt.body, declarations);
+            break;
+        case STMT_FOR:
+            collect_stmt(stmt->as.for_stmt.init, declarations);
+            collect_expr(stmt->as.for_stmt.condition);
+            collect_expr(stmt->as.for_stmt.increment);
+            collect_stmt(stmt->as.for_stmt.body, declarations);
+            break;
+        case STMT_RETURN:
+            collect_expr(stmt->as.return_stmt.expression);
+            break;
+        case STMT_FUNCTION:
+            if (!declarations) collect_stmt(stmt->as.function.body, false);
+            break;
+        case STMT_INCLUDE:
+            break;
+    }
+}
+
+static Local* find_local(const char* name) {
+    for (int i = optimizer.local_count - 1; i >= 0; i--) {
+        if (optimizer.locals[i].name == name) return &optimizer.locals[i];
+    }
+    return NULL;
+}
+
+// Only names declared once in the function are tracked, so a local found in
+// scope is the one every engine resolves the name to, however it lays out
+// its environments
+static void declare_local(const char* name, DataType type, Expr* initializer) {
+    Name* entry = find_name(name);
+    if (entry == NULL || entry->declarations != 1) return;
+
+    if (optimizer.local_count == optimizer.local_capacity) {
+        optimizer.local_capacity = optimizer.local_capacity < 8 ? 8 : optimizer.local_capacity * 2;
+        optimizer.locals = realloc(optimizer.locals, sizeof(Local) * optimizer.local_capacity);
+    }
+
+    Local* local = &optimizer.locals[optimizer.local_count++];
+    local->name = name;
+    local->type = type;
+    local->constant = NULL;
+    if (initializer != NULL && initializer->type == EXPR_LITERAL && initializer->as.literal.type == type &&
+        (type == TYPE_INT || type == TYPE_FLOAT || type == TYPE_STRING || type == TYPE_BOOL) &&
+        !is_assigned(name)) {
+        local->constant = initializer;
+    }
+}
+
+static bool is_literal(Expr* expr, DataType type) {
+    return expr->type == EXPR_LITERAL && expr->as.literal.type == type;
+}
+
+static Value literal_value(LiteralExpr* literal) {
+    Value value = {0};
+    value.type = literal->type;
+    switch (literal->type) {
+        case TYPE_INT:
+            value.value.int_val = literal->as.int_val;
+            break;
+        case TYPE_FLOAT:
+            value.value.float_val = literal->as.float_val;
+            break;
+        default:
+            value = value_constant_string(literal->as.string_val);
+            break;
+    }
+    return value;
+}
+
+// Turn expr into a literal holding value, which it takes ownership of
+static void make_literal(Expr* expr, Value value, int line) {
+    char text[64];
+    Token token = {0};
+    token.line = line;
+    LiteralExpr literal = {0};
+    literal.type = value.type;
+
+    switch (value.type) {
+        case TYPE_INT:
+            snprintf(text, sizeof(text), "%d", value.value.int_val);
+            token.type = TOKEN_INTEGER_LITERAL;
+            token.lexeme = pool_intern(text);
+            literal.as.int_val = value.value.int_val;
+            break;
+        case TYPE_FLOAT:
+            snprintf(text, sizeof(text), "%g", value.value.float_val);
+            token.type = TOKEN_FLOAT_LITERAL;
+            token.lexeme = pool_intern(text);
+            literal.as.float_val = value.value.float_val;
+            break;
+        default:
+            token.type = TOKEN_STRING_LITERAL;
+            literal.as.string_val = pool_string(value_chars(&value), value_length(&value));
+            token.lexeme = literal.as.string_val->chars;
+            value_release(&value);
+            break;
+    }
+    token.length = (int)strlen(token.lexeme);
+    literal.value = token;
+
+    expr->type = EXPR_LITERAL;
+    expr->as.literal = literal;
+}
+
+// Operations value_binary completes without an error for these literals
+static bool can_fold(TokenType op, Expr* left, Expr* right) {
+    if (is_literal(left, TYPE_STRING) && is_literal(right, TYPE_STRING)) {
+        return op == TOKEN_PLUS;
+    }
+
+    if (is_literal(left, TYPE_INT) && is_literal(right, TYPE_INT)) {
+        int divisor = right->as.literal.as.int_val;
+        if (op == TOKEN_DIVIDE || op == TOKEN_MODULO) {
+            return divisor != 0 && !(divisor == -1 && left->as.literal.as.int_val == INT_MIN);
+        }
+    } else if (is_literal(left, TYPE_FLOAT) && is_literal(right, TYPE_FLOAT)) {
+        if (op == TOKEN_MODULO) return false;
+        if (op == TOKEN_DIVIDE) return right->as.literal.as.float_val != 0.0;
+    } else {
+        return false;
+    }
+
+    switch (op) {
+        case TOKEN_PLUS:
+        case TOKEN_MINUS:
+        case TOKEN_MULTIPLY:
+        case TOKEN_DIVIDE:
+        case TOKEN_MODULO:
+        case TOKEN_EQUALS:
+        case TOKEN_NOT_EQUALS:
+        case TOKEN_LESS:
+        case TOKEN_LESS_EQUAL:
+        case TOKEN_GREATER:
+        case TOKEN_GREATER_EQUAL:
+            return true;
+        default:
+            return false;
+    }
+}
+
+// The type expr always evaluates to, where that follows from literals and
+// tracked locals alone
+static bool known_type(Expr* expr, DataType* type) {
+    switch (expr->type) {
+        case EXPR_LITERAL:
+            *type = expr->as.literal.type;
+            return true;
+        case EXPR_VARIABLE: {
+            Local* local = find_local(expr->as.variable.name.lexeme);
+            if (local == NULL) return false;
+            *type = local->type;
+            return true;
+        }
+        case EXPR_UNARY:
+            return known_type(expr->as.unary.operand, type) && (*type == TYPE_INT || *type == TYPE_FLOAT);
+        case EXPR_BINARY: {
+            DataType left, right;
+            if (!known_type(expr->as.binary.left, &left) || !known_type(expr->as.binary.right, &right) ||
+                left != right) {
+                return false;
+            }
+            *type = left;
+            switch (expr->as.binary.operator.type) {
+                case TOKEN_PLUS:
+                case TOKEN_MINUS:
+                case TOKEN_MULTIPLY:
+                case TOKEN_DIVIDE:
+                    return left == TYPE_INT || left == TYPE_FLOAT;
+                case TOKEN_MODULO:
+                    return left == TYPE_INT;
+                default:
+                    return false;
+            }
+        }
+        default:
+            return false;
+    }
+}
+
+static bool is_number(Expr* expr, DataType type, int number) {
+    if (type == TYPE_INT) return is_literal(expr, TYPE_INT) && expr->as.literal.as.int_val == number;
+    return is_literal(expr, TYPE_FLOAT) && expr->as.literal.as.float_val == (float)number;
+}
+
+// The operand a binary expression reduces to under an identity, or NULL.
+// x + 0.0 is not x for x = -0.0, so floats only lose subtractions of zero
+// and multiplications and divisions by one.
+static Expr* identity_operand(BinaryExpr* binary) {
+    DataType type;
+    Expr* left = binary->left;
+    Expr* right = binary->right;
+
+    switch (binary->operator.type) {
+        case TOKEN_PLUS:
+            if (is_number(right, TYPE_INT, 0) && known_type(left, &type) && type == TYPE_INT) return left;
+            if (is_number(left, TYPE_INT, 0) && known_type(right, &type) && type == TYPE_INT) return right;
+            break;
+        case TOKEN_MINUS:
+            if (known_type(left, &type) && (type == TYPE_INT || type == TYPE_FLOAT) && is_number(right, type, 0)) return left;
+            break;
+        case TOKEN_MULTIPLY:
+            if (known_type(left, &type) && (type == TYPE_INT || type == TYPE_FLOAT) && is_number(right, type, 1)) return left;
+            if (known_type(right, &type) && (type == TYPE_INT || type == TYPE_FLOAT) && is_number(left, type, 1)) return right;
+            break;
+        case TOKEN_DIVIDE:
+            if (known_type(left, &type) && (type == TYPE_INT || type == TYPE_FLOAT) && is_number(right, type, 1)) return left;
+            break;
+        default:
+            break;
+    }
+    return NULL;
+}
+
+static void optimize_binary(Expr* expr) {
+    BinaryExpr* binary = &expr->as.binary;
+    optimize_expr(binary->left);
+    optimize_expr(binary->right);
+
+    if (can_fold(binary->operator.type, binary->left, binary->right)) {
+        Value result;
+        value_binary(binary->operator.type, literal_value(&binary->left->as.literal),
+                     literal_value(&binary->right->as.literal), &result);
+        make_literal(expr, result, binary->operator.line);
+        return;
+    }
+
+    Expr* operand = identity_operand(binary);
+    if (operand != NULL) {
+        *expr = *operand;
+    }
+}
+
+// Operands that name a list or a function are kept as variables
+static void optimize_operand(Expr* expr) {
+    if (expr->type != EXPR_VARIABLE) {
+        optimize_expr(expr);
+    }
+}
+
+static void optimize_expr(Expr* expr) {
+    if (expr == NULL) return;
+
+    switch (expr->type) {
+        case EXPR_LITERAL:
+            break;
+        case EXPR_BINARY:
+            optimize_binary(expr);
+            break;
+        case EXPR_UNARY: {
+            Expr* operand = expr->as.unary.operand;
+            optimize_expr(operand);
+            if (expr->as.unary.operator.type == TOKEN_MINUS &&
+                (is_literal(operand, TYPE_INT) || is_literal(operand, TYPE_FLOAT))) {
+                Value result;
+                value_negate(literal_value(&operand->as.literal), &result);
+                make_literal(expr, result, expr->as.unary.operator.line);
+            }
+            break;
+        }
+        case EXPR_VARIABLE: {
+            Local* local = find_local(expr->as.variable.name.lexeme);
+            if (local != NULL && local->constant != NULL) {
+                *expr = *local->constant;
+            }
+            break;
+        }
+        case EXPR_ASSIGN:
+            optimize_expr(expr->as.assign.value);
+            break;
+        case EXPR_CALL:
+            optimize_operand(expr->as.call.callee);
+            for (int i = 0; i < expr->as.call.arg_count; i++) {
+                optimize_expr(expr->as.call.arguments[i]);
+            }
+            break;
+        case EXPR_LIST_ACCESS:
+            optimize_operand(expr->as.list_access.list);
+            optimize_expr(expr->as.list_access.index);
+            break;
+        case EXPR_LIST_METHOD:
+            optimize_operand(expr->as.list_method.list);
+            optimize_expr(expr->as.list_method.argument);
+            break;
+        case EXPR_LIST_PROPERTY:
+            optimize_operand(expr->as.list_property.list);
+            break;
+    }
+}
+
+// Locals declared in a nested statement go out of scope after it
+static void optimize_nested(Stmt* stmt) {
+    int local_count = optimizer.local_count;
+    optimize_stmt(stmt);
+    optimizer.local_count = local_count;
+}
+
+static void optimize_function(FunctionStmt* function) {
+    Optimizer enclosing = optimizer;
+    optimizer.names = NULL;
+    optimizer.name_count = 0;
+    optimizer.name_capacity = 0;
+    optimizer.locals = NULL;
+    optimizer.local_count = 0;
+    optimizer.local_capacity = 0;
+    optimizer.in_function = true;
+
+    for (int i = 0; i < function->param_count; i++) {
+        count_declaration(function->params[i].lexeme);
+    }
+    collect_stmt(function->body, true);
+
+    for (int i = 0; i < function->param_count; i++) {
+        declare_local(function->params[i].lexeme, function->param_types[i], NULL);
+    }
+    optimize_stmt(function->body);
+
+    free(optimizer.names);
+    free(optimizer.locals);
+    optimizer.names = enclosing.names;
+    optimizer.name_count = enclosing.name_count;
+    optimizer.name_capacity = enclosing.name_capacity;
+    optimizer.locals = enclosing.locals;
+    optimizer.local_count = enclosing.local_count;
+    optimizer.local_capacity = enclosing.local_capacity;
+    optimizer.in_function = enclosing.in_function;
+}
+
+static void optimize_stmt(Stmt* stmt) {
+    if (stmt == NULL) return;
+
+    switch (stmt->type) {
+        case STMT_EXPRESSION:
+            optimize_expr(stmt->as.expression);
+            break;
+        case STMT_VAR_DECL:
+            optimize_expr(stmt->as.var_decl.initializer);
+            if (optimizer.in_function) {
+                declare_local(stmt->as.var_decl.name.lexeme, stmt->as.var_decl.type, stmt->as.var_decl.initializer);
+            }
+            break;
+        case STMT_BLOCK: {
+            int local_count = optimizer.local_count;
+            for (int i = 0; i < stmt->as.block.count; i++) {
+                optimize_stmt(stmt->as.block.statements[i]);
+            }
+            optimizer.local_count = local_count;
+            break;
+        }
+        case STMT_IF:
+            optimize_expr(stmt->as.if_stmt.condition);
+            optimize_nested(stmt->as.if_stmt.then_branch);
+            optimize_nested(stmt->as.if_stmt.else_branch);
+            break;
+        case STMT_WHILE:
+            optimize_expr(stmt->as.while_stmt.condition);
+            optimize_nested(stmt->as.while_stmt.body);
+            break;
+        case STMT_FOR: {
+            int local_count = optimizer.local_count;
+            optimize_stmt(stmt->as.for_stmt.init);
+            optimize_expr(stmt->as.for_stmt.condition);
+            optimize_expr(stmt->as.for_stmt.increment);
+            optimize_nested(stmt->as.for_stmt.body);
+            optimizer.local_count = local_count;
+            break;
+        }
+        case STMT_RETURN:
+            optimize_expr(stmt->as.return_stmt.expression);
+            break;
+        case STMT_FUNCTION:
+            optimize_function(&stmt->as.function);
+            break;
+        case STMT_INCLUDE:
+            // Included files are optimized when they are loaded
+            break;
+    }
+}
+
+void optimize(Stmt** statements, int count) {
+    if (optimize_level == 0) return;
+
+    optimizer = (Optimizer){0};
+    for (int i = 0; i < count; i++) {
+        collect_stmt(statements[i], false);
+    }
+    for (int i = 0; i < count; i++) {
+        optimize_stmt(statements[i]);
+    }
+
+    free(optimizer.assigned);
+    optimizer.assigned = NULL;
+}
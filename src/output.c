@@ -0,0 +1,140 @@
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "headers/output.h"
+
+// Longest text output_double can produce for "%f"
+#define DOUBLE_MAX_LENGTH 320
+
+static void write_all(int fd, const char* data, size_t length) {
+    while (length > 0) {
+        ssize_t written = write(fd, data, length);
+        if (written < 0) {
+            if (errno == EINTR) continue;
+            return;
+        }
+        data += written;
+        length -= (size_t)written;
+    }
+}
+
+// The output flushed ahead of error messages
+static Output* reporting = NULL;
+
+void output_init(Output* output, int fd, size_t capacity) {
+    if (capacity == 0) capacity = OUTPUT_DEFAULT_SIZE;
+
+    output->fd = fd;
+    output->buffer = malloc(capacity);
+    output->length = 0;
+    output->capacity = capacity;
+    output->line_buffered = isatty(fd);
+    output->owns_fd = false;
+    reporting = output;
+}
+
+bool output_open(Output* output, const char* path, size_t capacity) {
+    int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        fprintf(stderr, "Could not open output file \"%s\".\n", path);
+        return false;
+    }
+
+    output_init(output, fd, capacity);
+    output->owns_fd = true;
+    return true;
+}
+
+void output_flush(Output* output) {
+    // Anything still sitting in stdio was printed first
+    if (output->fd == STDOUT_FILENO) fflush(stdout);
+
+    write_all(output->fd, output->buffer, output->length);
+    output->length = 0;
+}
+
+void output_free(Output* output) {
+    output_flush(output);
+    if (output->owns_fd) close(output->fd);
+    free(output->buffer);
+    output->buffer = NULL;
+    output->capacity = 0;
+    if (reporting == output) reporting = NULL;
+}
+
+void output_verror(const char* format, va_list args) {
+    if (reporting != NULL) output_flush(reporting);
+    vfprintf(stderr, format, args);
+}
+
+void output_error(const char* format, ...) {
+    va_list args;
+    va_start(args, format);
+    output_verror(format, args);
+    va_end(args);
+}
+
+void output_write(Output* output, const char* data, size_t length) {
+    if (length > output->capacity - output->length) {
+        output_flush(output);
+        // Too large to be worth copying, hand it over directly
+        if (length >= output->capacity) {
+            write_all(output->fd, data, length);
+            return;
+        }
+    }
+
+    memcpy(output->buffer + output->length, data, length);
+    output->length += length;
+
+    if (output->line_buffered && memchr(data, '\n', length) != NULL) {
+        output_flush(output);
+    }
+}
+
+void output_char(Output* output, char c) {
+    if (output->length == output->capacity) output_flush(output);
+
+    output->buffer[output->length++] = c;
+    if (output->line_buffered && c == '\n') output_flush(output);
+}
+
+void output_string(Output* output, const char* text) {
+    output_write(output, text, strlen(text));
+}
+
+void output_long(Output* output, long value) {
+    // Digits are produced backwards into a scratch buffer
+    char digits[24];
+    char* end = digits + sizeof(digits);
+    char* start = end;
+    unsigned long magnitude = value < 0 ? 0UL - (unsigned long)value : (unsigned long)value;
+
+    do {
+        *--start = (char)('0' + magnitude % 10);
+        magnitude /= 10;
+    } while (magnitude != 0);
+    if (value < 0) *--start = '-';
+
+    output_write(output, start, (size_t)(end - start));
+}
+
+void output_double(Output* output, double value) {
+    if (output->capacity - output->length < DOUBLE_MAX_LENGTH) {
+        output_flush(output);
+    }
+
+    // Format in place when there is room, otherwise through a scratch buffer
+    if (output->capacity - output->length >= DOUBLE_MAX_LENGTH) {
+        int length = snprintf(output->buffer + output->length, DOUBLE_MAX_LENGTH, "%f", value);
+        output->length += (size_t)length;
+        return;
+    }
+
+    char scratch[DOUBLE_MAX_LENGTH];
+    int length = snprintf(scratch, sizeof(scratch), "%f", value);
+    output_write(output, scratch, (size_t)length);
+}
@@ -2,6 +2,7 @@
 #include <stdlib.h>
 #include <stdbool.h>
 #include <string.h>
+#include "headers/output.h"
 #include "headers/parser.h"
 
 // #define SHL_IMPLEMENTATION
@@ -35,13 +36,61 @@ static Stmt* function_declaration(Parser* parser, DataType return_type, Token na
 // static Stmt* return_statement(Parser* parser);
 // static Stmt* include_statement(Parser* parser);
 
+// Growable array for a list that is still being parsed. Short lists stay in
+// the inline storage and longer ones double on the heap; the finished list is
+// copied into the arena.
+typedef struct {
+    char* items;
+    int count;
+    int capacity;
+    size_t item_size;
+    char inline_items[256];
+} Vector;
+
+static void vector_init(Vector* vector, size_t item_size) {
+    vector->items = vector->inline_items;
+    vector->count = 0;
+    vector->capacity = (int)(sizeof(vector->inline_items) / item_size);
+    vector->item_size = item_size;
+}
+
+static void vector_push(Vector* vector, const void* item) {
+    if (vector->count == vector->capacity) {
+        int capacity = vector->capacity * 2;
+        char* items = malloc(vector->item_size * capacity);
+        memcpy(items, vector->items, vector->item_size * vector->count);
+        if (vector->items != vector->inline_items) free(vector->items);
+        vector->items = items;
+        vector->capacity = capacity;
+    }
+    
+    memcpy(vector->items + vector->item_size * vector->count, item, vector->item_size);
+    vector->count++;
+}
+
+static void* vector_finish(Parser* parser, Vector* vector) {
+    void* items = arena_copy(parser->arena, vector->items, vector->item_size * vector->count);
+    if (vector->items != vector->inline_items) free(vector->items);
+    return items;
+}
+
+static Token next_token(Parser* parser) {
+    if (parser->tokens == NULL) return lexer_next_token(parser->lexer);
+    
+    // The final EOF token is handed out again if the parser asks past it
+    Token token = parser->tokens[parser->token_index];
+    if (token.type != TOKEN_EOF) parser->token_index++;
+    return token;
+}
+
 static void advance(Parser* parser) {
     parser->previous = parser->current;
     
     for (;;) {
-        parser->current = lexer_next_token(parser->lexer);
+        parser->current = next_token(parser);
         if (parser->current.type != TOKEN_ERROR) break;
         
+        // Error tokens carry their message as a NUL-terminated lexeme
         parser_error_at_current(parser, parser->current.lexeme);
     }
 }
@@ -84,9 +133,11 @@ static Expr* parse_primary(Parser* parser) {
         match(parser, TOKEN_FLOAT_LITERAL) ||
         match(parser, TOKEN_STRING_LITERAL) ||
         match(parser, TOKEN_BOOL_LITERAL)) {
-        Token* token = malloc(sizeof(Token));
-        *token = parser->previous;
-        return create_literal_expr(token);
+        Expr* literal = create_literal_expr(parser->arena, parser->previous);
+        if (literal->as.literal.type == TYPE_VOID) {
+            parser_error_at_previous(parser, "Integer literal is too large.");
+        }
+        return literal;
     }
     
     if (match(parser, TOKEN_IDENTIFIER)) {
@@ -94,27 +145,28 @@ static Expr* parse_primary(Parser* parser) {
         
         if (match(parser, TOKEN_LPAREN)) {
             // Function call
-            Expr** arguments = NULL;
-            int arg_count = 0;
+            Vector arguments;
+            vector_init(&arguments, sizeof(Expr*));
             
             if (!check(parser, TOKEN_RPAREN)) {
                 do {
-                    if (arg_count >= 255) {
+                    if (arguments.count >= 255) {
                         parser_error_at_current(parser, "Cannot have more than 255 arguments.");
                     }
                     
-                    arguments = realloc(arguments, sizeof(Expr*) * (arg_count + 1));
-                    arguments[arg_count++] = parse_expression(parser);
+                    Expr* argument = parse_expression(parser);
+                    vector_push(&arguments, &argument);
                 } while (match(parser, TOKEN_COMMA));
             }
             
             consume(parser, TOKEN_RPAREN, "Expect ')' after arguments.");
             
-            return create_call_expr(create_variable_expr(name, TYPE_VOID),
-                                  arguments, arg_count);
+            int arg_count = arguments.count;
+            return create_call_expr(parser->arena, create_variable_expr(parser->arena, name, TYPE_VOID),
+                                  vector_finish(parser, &arguments), arg_count);
         }
         
-        return create_variable_expr(name, TYPE_VOID);
+        return create_variable_expr(parser->arena, name, TYPE_VOID);
     }
     
     if (match(parser, TOKEN_LPAREN)) {
@@ -133,9 +185,10 @@ static Expr* finish_variable(Parser* parser, Expr* expr) {
     if (match(parser, TOKEN_LBRACKET)) {
         Expr* index = parse_expression(parser);
         consume(parser, TOKEN_RBRACKET, "Expect ']' after list index.");
-        expr = create_list_access_expr(expr, index);
+        expr = create_list_access_expr(parser->arena, expr, index);
     }
-    // Handle list methods/properties: list.add(item), list.remove(index), list.length
+    // Handle list methods/properties: list.add(item), list.remove(index), list.reserve(n),
+    // list.sort() or list.sort(descending), list.length
     else if (match(parser, TOKEN_DOT)) {
         Token name = parser->current;
         (void)name;
@@ -144,16 +197,38 @@ static Expr* finish_variable(Parser* parser, Expr* expr) {
             consume(parser, TOKEN_LPAREN, "Expect '(' after list.add.");
             Expr* item = parse_expression(parser);
             consume(parser, TOKEN_RPAREN, "Expect ')' after list.add argument.");
-            expr = create_list_method_expr(expr, TOKEN_ADD, item);
+            expr = create_list_method_expr(parser->arena, expr, TOKEN_ADD, item);
         }
         else if (match(parser, TOKEN_REMOVE)) {
             consume(parser, TOKEN_LPAREN, "Expect '(' after list.remove.");
             Expr* index = parse_expression(parser);
             consume(parser, TOKEN_RPAREN, "Expect ')' after list.remove argument.");
-            expr = create_list_method_expr(expr, TOKEN_REMOVE, index);
+            expr = create_list_method_expr(parser->arena, expr, TOKEN_REMOVE, index);
+        }
+        else if (match(parser, TOKEN_RESERVE)) {
+            consume(parser, TOKEN_LPAREN, "Expect '(' after list.reserve.");
+            Expr* capacity = parse_expression(parser);
+            consume(parser, TOKEN_RPAREN, "Expect ')' after list.reserve argument.");
+            expr = create_list_method_expr(parser->arena, expr, TOKEN_RESERVE, capacity);
+        }
+        else if (match(parser, TOKEN_SORT)) {
+            consume(parser, TOKEN_LPAREN, "Expect '(' after list.sort.");
+            Expr* descending = NULL;
+            if (!check(parser, TOKEN_RPAREN)) {
+                descending = parse_expression(parser);
+            } else {
+                // Without an argument the list is sorted in ascending order
+                Token token = parser->current;
+                token.type = TOKEN_BOOL_LITERAL;
+                token.lexeme = "false";
+                token.length = 5;
+                descending = create_literal_expr(parser->arena, token);
+            }
+            consume(parser, TOKEN_RPAREN, "Expect ')' after list.sort argument.");
+            expr = create_list_method_expr(parser->arena, expr, TOKEN_SORT, descending);
         }
         else if (match(parser, TOKEN_LENGTH)) {
-            expr = create_list_property_expr(expr, TOKEN_LENGTH);
+            expr = create_list_property_expr(parser->arena, expr, TOKEN_LENGTH);
         }
         else {
             parser_error_at_current(parser, "Expect list method or property after '.'");
@@ -167,7 +242,7 @@ static Expr* parse_unary(Parser* parser) {
     if (match(parser, TOKEN_MINUS)) {
         Token operator = parser->previous;
         Expr* right = parse_unary(parser);
-        return create_unary_expr(operator, right);
+        return create_unary_expr(parser->arena, operator, right);
     }
     
     Expr* expr = parse_primary(parser);
@@ -180,7 +255,7 @@ static Expr* parse_factor(Parser* parser) {
     while (match(parser, TOKEN_MULTIPLY) || match(parser, TOKEN_DIVIDE) || match(parser, TOKEN_MODULO)) {
         Token operator = parser->previous;
         Expr* right = parse_unary(parser);
-        expr = create_binary_expr(operator, expr, right);
+        expr = create_binary_expr(parser->arena, operator, expr, right);
     }
     
     return expr;
@@ -192,7 +267,7 @@ static Expr* parse_term(Parser* parser) {
     while (match(parser, TOKEN_PLUS) || match(parser, TOKEN_MINUS)) {
         Token operator = parser->previous;
         Expr* right = parse_factor(parser);
-        expr = create_binary_expr(operator, expr, right);
+        expr = create_binary_expr(parser->arena, operator, expr, right);
     }
     
     return expr;
@@ -205,7 +280,7 @@ static Expr* parse_comparison(Parser* parser) {
            match(parser, TOKEN_GREATER) || match(parser, TOKEN_GREATER_EQUAL)) {
         Token operator = parser->previous;
         Expr* right = parse_term(parser);
-        expr = create_binary_expr(operator, expr, right);
+        expr = create_binary_expr(parser->arena, operator, expr, right);
     }
     
     return expr;
@@ -217,7 +292,7 @@ static Expr* parse_equality(Parser* parser) {
     while (match(parser, TOKEN_EQUALS) || match(parser, TOKEN_NOT_EQUALS)) {
         Token operator = parser->previous;
         Expr* right = parse_comparison(parser);
-        expr = create_binary_expr(operator, expr, right);
+        expr = create_binary_expr(parser->arena, operator, expr, right);
     }
     
     return expr;
@@ -232,10 +307,10 @@ static Expr* parse_assignment(Parser* parser) {
         
         if (expr->type == EXPR_VARIABLE) {
             Token name = expr->as.variable.name;
-            return create_assign_expr(name, value);
+            return create_assign_expr(parser->arena, name, value);
         } else if (expr->type == EXPR_LIST_ACCESS) {
             // Handle list index assignment: list[index] = value
-            return create_binary_expr(equals, expr, value);
+            return create_binary_expr(parser->arena, equals, expr, value);
         }
         
         parser_error_at_previous(parser, "Invalid assignment target.");
@@ -259,14 +334,14 @@ static Stmt* parse_var_declaration(Parser* parser) {
     }
     
     // Create the first variable declaration
-    Stmt* first = create_var_decl_stmt(name, type, initializer);
+    Stmt* first = create_var_decl_stmt(parser->arena, name, type, initializer);
     
     // If there's a comma, parse additional variable declarations
     if (match(parser, TOKEN_COMMA)) {
         // Create a block to hold all declarations
-        Stmt** statements = malloc(sizeof(Stmt*));
-        int count = 1;
-        statements[0] = first;
+        Vector statements;
+        vector_init(&statements, sizeof(Stmt*));
+        vector_push(&statements, &first);
         
         do {
             name = parser->current;
@@ -277,12 +352,13 @@ static Stmt* parse_var_declaration(Parser* parser) {
                 initializer = parse_expression(parser);
             }
             
-            statements = realloc(statements, sizeof(Stmt*) * (count + 1));
-            statements[count++] = create_var_decl_stmt(name, type, initializer);
+            Stmt* decl = create_var_decl_stmt(parser->arena, name, type, initializer);
+            vector_push(&statements, &decl);
         } while (match(parser, TOKEN_COMMA));
         
         consume(parser, TOKEN_SEMICOLON, "Expect ';' after variable declaration.");
-        return create_block_stmt(statements, count);
+        int count = statements.count;
+        return create_block_stmt(parser->arena, vector_finish(parser, &statements), count);
     }
     
     consume(parser, TOKEN_SEMICOLON, "Expect ';' after variable declaration.");
@@ -290,16 +366,17 @@ static Stmt* parse_var_declaration(Parser* parser) {
 }
 
 static Stmt* parse_block(Parser* parser) {
-    Stmt** statements = NULL;
-    int count = 0;
+    Vector statements;
+    vector_init(&statements, sizeof(Stmt*));
     
     while (!check(parser, TOKEN_RBRACE) && !check(parser, TOKEN_EOF)) {
-        statements = realloc(statements, sizeof(Stmt*) * (count + 1));
-        statements[count++] = parse_statement(parser);
+        Stmt* stmt = parse_statement(parser);
+        vector_push(&statements, &stmt);
     }
     
     consume(parser, TOKEN_RBRACE, "Expect '}' after block.");
-    return create_block_stmt(statements, count);
+    int count = statements.count;
+    return create_block_stmt(parser->arena, vector_finish(parser, &statements), count);
 }
 
 static Stmt* parse_if_statement(Parser* parser) {
@@ -314,7 +391,7 @@ static Stmt* parse_if_statement(Parser* parser) {
         else_branch = parse_statement(parser);
     }
     
-    return create_if_stmt(condition, then_branch, else_branch);
+    return create_if_stmt(parser->arena, condition, then_branch, else_branch);
 }
 
 static Stmt* parse_while_statement(Parser* parser) {
@@ -323,7 +400,7 @@ static Stmt* parse_while_statement(Parser* parser) {
     consume(parser, TOKEN_RPAREN, "Expect ')' after condition.");
     Stmt* body = parse_statement(parser);
     
-    return create_while_stmt(condition, body);
+    return create_while_stmt(parser->arena, condition, body);
 }
 
 static Stmt* parse_return_statement(Parser* parser) {
@@ -333,7 +410,7 @@ static Stmt* parse_return_statement(Parser* parser) {
     }
     
     consume(parser, TOKEN_SEMICOLON, "Expect ';' after return value.");
-    return create_return_stmt(value);
+    return create_return_stmt(parser->arena, value);
 }
 
 static Stmt* parse_for_statement(Parser* parser) {
@@ -352,7 +429,7 @@ static Stmt* parse_for_statement(Parser* parser) {
         init = parse_var_declaration(parser);
     } else {
         // Expression statement
-        init = create_expression_stmt(parse_expression(parser));
+        init = create_expression_stmt(parser->arena, parse_expression(parser));
         consume(parser, TOKEN_SEMICOLON, "Expect ';' after loop initialization.");
     }
     
@@ -362,10 +439,11 @@ static Stmt* parse_for_statement(Parser* parser) {
         condition = parse_expression(parser);
     } else {
         // If no condition is provided, use 'true'
-        Token* token = malloc(sizeof(Token));
-        token->type = TOKEN_BOOL_LITERAL;
-        token->lexeme = strdup("true");
-        condition = create_literal_expr(token);
+        Token token = parser->current;
+        token.type = TOKEN_BOOL_LITERAL;
+        token.lexeme = "true";
+        token.length = 4;
+        condition = create_literal_expr(parser->arena, token);
     }
     consume(parser, TOKEN_SEMICOLON, "Expect ';' after loop condition.");
     
@@ -380,7 +458,7 @@ static Stmt* parse_for_statement(Parser* parser) {
     Stmt* body = parse_statement(parser);
     
     // Create and return the for statement
-    return create_for_stmt(init, condition, increment, body);
+    return create_for_stmt(parser->arena, init, condition, increment, body);
 }
 
 static Stmt* parse_statement(Parser* parser) {
@@ -397,7 +475,7 @@ static Stmt* parse_statement(Parser* parser) {
         return parse_var_declaration(parser);
     }
     
-    Stmt* stmt = create_expression_stmt(parse_expression(parser));
+    Stmt* stmt = create_expression_stmt(parser->arena, parse_expression(parser));
     consume(parser, TOKEN_SEMICOLON, "Expect ';' after expression.");
     return stmt;
 }
@@ -409,7 +487,7 @@ static Stmt* parse_declaration(Parser* parser) {
         
         consume(parser, TOKEN_SEMICOLON, "Expected ';' after include statement.");
         
-        return create_include_stmt(path);
+        return create_include_stmt(parser->arena, path);
     }
     
     if (match(parser, TOKEN_INT) || match(parser, TOKEN_FLOAT) ||
@@ -454,12 +532,12 @@ static Stmt* var_declaration(Parser* parser, DataType type, Token name) {
     }
     
     consume(parser, TOKEN_SEMICOLON, "Expect ';' after variable declaration.");
-    return create_var_decl_stmt(name, type, initializer);
+    return create_var_decl_stmt(parser->arena, name, type, initializer);
 }
 
 static Stmt* function_declaration(Parser* parser, DataType return_type, Token name) {
     // Check if this is main function and enforce void return type with no parameters
-    if (strcmp(name.lexeme, "main") == 0) {
+    if (name.length == 4 && memcmp(name.lexeme, "main", 4) == 0) {
         if (return_type != TYPE_VOID) {
             parser_error_at_previous(parser, "Main function must have void return type.");
         }
@@ -473,17 +551,18 @@ static Stmt* function_declaration(Parser* parser, DataType return_type, Token na
         consume(parser, TOKEN_LBRACE, "Expect '{' before function body.");
         Stmt* body = parse_block(parser);
         
-        return create_function_stmt(name, return_type, NULL, NULL, 0, body);
+        return create_function_stmt(parser->arena, name, return_type, NULL, NULL, 0, body);
     }
     
     // Regular function declaration
-    Token* parameters = NULL;
-    DataType* param_types = NULL;
-    int param_count = 0;
+    Vector parameters;
+    Vector param_types;
+    vector_init(&parameters, sizeof(Token));
+    vector_init(&param_types, sizeof(DataType));
     
     if (!check(parser, TOKEN_RPAREN)) {
         do {
-            if (param_count >= 255) {
+            if (parameters.count >= 255) {
                 parser_error_at_current(parser, "Cannot have more than 255 parameters.");
             }
             
@@ -491,12 +570,8 @@ static Stmt* function_declaration(Parser* parser, DataType return_type, Token na
             Token param_name = parser->current;
             consume(parser, TOKEN_IDENTIFIER, "Expect parameter name.");
             
-            parameters = realloc(parameters, sizeof(Token) * (param_count + 1));
-            param_types = realloc(param_types, sizeof(DataType) * (param_count + 1));
-            
-            parameters[param_count] = param_name;
-            param_types[param_count] = param_type;
-            param_count++;
+            vector_push(&parameters, &param_name);
+            vector_push(&param_types, &param_type);
         } while (match(parser, TOKEN_COMMA));
     }
     
@@ -504,27 +579,42 @@ static Stmt* function_declaration(Parser* parser, DataType return_type, Token na
     consume(parser, TOKEN_LBRACE, "Expect '{' before function body.");
     Stmt* body = parse_block(parser);
     
-    return create_function_stmt(name, return_type, parameters, param_types, param_count, body);
+    int param_count = parameters.count;
+    return create_function_stmt(parser->arena, name, return_type, vector_finish(parser, &parameters),
+                                vector_finish(parser, &param_types), param_count, body);
 }
 
-void parser_init(Parser* parser, Lexer* lexer) {
+void parser_init(Parser* parser, Lexer* lexer, Arena* arena) {
     parser->lexer = lexer;
+    parser->arena = arena;
+    parser->tokens = NULL;
+    parser->token_index = 0;
+    parser->had_error = false;
+    parser->panic_mode = false;
+    advance(parser);
+}
+
+void parser_init_tokens(Parser* parser, const Token* tokens, Arena* arena) {
+    parser->lexer = NULL;
+    parser->arena = arena;
+    parser->tokens = tokens;
+    parser->token_index = 0;
     parser->had_error = false;
     parser->panic_mode = false;
     advance(parser);
 }
 
 Stmt** parse(Parser* parser, int* count) {
-    Stmt** statements = NULL;
-    *count = 0;
+    Vector statements;
+    vector_init(&statements, sizeof(Stmt*));
     
     while (!check(parser, TOKEN_EOF)) {
-        statements = realloc(statements, sizeof(Stmt*) * (*count + 1));
-        statements[*count] = parse_declaration(parser);
-        (*count)++;
+        Stmt* stmt = parse_declaration(parser);
+        vector_push(&statements, &stmt);
     }
     
-    return statements;
+    *count = statements.count;
+    return vector_finish(parser, &statements);
 }
 
 void parser_error_at_current(Parser* parser, const char* message) {
@@ -532,8 +622,9 @@ void parser_error_at_current(Parser* parser, const char* message) {
     parser->panic_mode = true;
     parser->had_error = true;
     
-    fprintf(stderr, "[line %d] Error at '%s': %s\n",
+    output_error("[line %d] Error at '%.*s': %s\n",
             parser->current.line,
+            parser->current.length,
             parser->current.lexeme,
             message);
 }
@@ -543,8 +634,9 @@ void parser_error_at_previous(Parser* parser, const char* message) {
     parser->panic_mode = true;
     parser->had_error = true;
     
-    fprintf(stderr, "[line %d] Error at '%s': %s\n",
+    output_error("[line %d] Error at '%.*s': %s\n",
             parser->previous.line,
+            parser->previous.length,
             parser->previous.lexeme,
             message);
 }
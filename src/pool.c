@@ -0,0 +1,73 @@
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include "headers/pool.h"
+#include "headers/value.h"
+
+// Open-addressing hash set of string objects
+typedef struct {
+    String** entries;
+    int count;
+    int capacity;
+} Pool;
+
+static Pool pool;
+
+static String** find_entry(String** entries, int capacity, const char* text, int length, uint32_t hash) {
+    uint32_t index = hash & (capacity - 1);
+    for (;;) {
+        String** entry = &entries[index];
+        if (*entry == NULL) return entry;
+        if ((*entry)->hash == hash && (*entry)->length == length && memcmp((*entry)->chars, text, length) == 0) {
+            return entry;
+        }
+        index = (index + 1) & (capacity - 1);
+    }
+}
+
+static void grow_pool(void) {
+    int capacity = pool.capacity < 64 ? 64 : pool.capacity * 2;
+    String** entries = calloc(capacity, sizeof(String*));
+
+    for (int i = 0; i < pool.capacity; i++) {
+        String* string = pool.entries[i];
+        if (string == NULL) continue;
+        *find_entry(entries, capacity, string->chars, string->length, string->hash) = string;
+    }
+
+    free(pool.entries);
+    pool.entries = entries;
+    pool.capacity = capacity;
+}
+
+const char* pool_intern(const char* text) {
+    return pool_string(text, (int)strlen(text))->chars;
+}
+
+const char* pool_intern_length(const char* text, int length) {
+    return pool_string(text, length)->chars;
+}
+
+String* pool_string(const char* text, int length) {
+    // Keep the load factor at or below 3/4
+    if ((pool.count + 1) * 4 > pool.capacity * 3) grow_pool();
+
+    uint32_t hash = string_hash(text, length);
+    String** entry = find_entry(pool.entries, pool.capacity, text, length, hash);
+    if (*entry == NULL) {
+        *entry = string_new(text, length);
+        (*entry)->hash = hash;
+        pool.count++;
+    }
+    return *entry;
+}
+
+void pool_free(void) {
+    for (int i = 0; i < pool.capacity; i++) {
+        if (pool.entries[i] != NULL) string_free(pool.entries[i]);
+    }
+    free(pool.entries);
+    pool.entries = NULL;
+    pool.count = 0;
+    pool.capacity = 0;
+}
@@ -0,0 +1,166 @@
+#include "headers/reduce.h"
+
+#if defined(__x86_64__) && defined(__GNUC__)
+#define REDUCE_SIMD 1
+#include <immintrin.h>
+#endif
+
+// Each vector kernel handles the whole vectors at the start of the items and
+// leaves the rest to the scalar loop. Sums are taken in unsigned arithmetic,
+// where wrapping around is defined.
+
+#ifdef REDUCE_SIMD
+
+// SSE2 is part of x86-64; AVX2 is checked for, once per call
+static bool has_avx2(void) {
+    return __builtin_cpu_supports("avx2");
+}
+
+// SSE2 has no 32-bit min and max, so they select through a comparison
+static __m128i min_sse2(__m128i a, __m128i b) {
+    __m128i less = _mm_cmplt_epi32(a, b);
+    return _mm_or_si128(_mm_and_si128(less, a), _mm_andnot_si128(less, b));
+}
+
+static __m128i max_sse2(__m128i a, __m128i b) {
+    __m128i greater = _mm_cmpgt_epi32(a, b);
+    return _mm_or_si128(_mm_and_si128(greater, a), _mm_andnot_si128(greater, b));
+}
+
+static unsigned int sum_sse2(const int* items, int vectors) {
+    __m128i total = _mm_setzero_si128();
+    for (int i = 0; i < vectors; i++) {
+        total = _mm_add_epi32(total, _mm_loadu_si128((const __m128i*)items + i));
+    }
+
+    unsigned int lanes[4];
+    _mm_storeu_si128((__m128i*)lanes, total);
+    return lanes[0] + lanes[1] + lanes[2] + lanes[3];
+}
+
+static int extreme_sse2(const int* items, int vectors, bool maximum) {
+    __m128i result = _mm_loadu_si128((const __m128i*)items);
+    for (int i = 1; i < vectors; i++) {
+        __m128i chunk = _mm_loadu_si128((const __m128i*)items + i);
+        result = maximum ? max_sse2(result, chunk) : min_sse2(result, chunk);
+    }
+
+    int lanes[4];
+    _mm_storeu_si128((__m128i*)lanes, result);
+    int extreme = lanes[0];
+    for (int i = 1; i < 4; i++) {
+        if (maximum ? lanes[i] > extreme : lanes[i] < extreme) extreme = lanes[i];
+    }
+    return extreme;
+}
+
+static int index_of_sse2(const int* items, int vectors, int value) {
+    __m128i needle = _mm_set1_epi32(value);
+    for (int i = 0; i < vectors; i++) {
+        __m128i equal = _mm_cmpeq_epi32(_mm_loadu_si128((const __m128i*)items + i), needle);
+        int mask = _mm_movemask_epi8(equal);
+        if (mask != 0) return i * 4 + __builtin_ctz(mask) / 4;
+    }
+    return -1;
+}
+
+__attribute__((target("avx2")))
+static unsigned int sum_avx2(const int* items, int vectors) {
+    __m256i total = _mm256_setzero_si256();
+    for (int i = 0; i < vectors; i++) {
+        total = _mm256_add_epi32(total, _mm256_loadu_si256((const __m256i*)items + i));
+    }
+
+    unsigned int lanes[8];
+    _mm256_storeu_si256((__m256i*)lanes, total);
+    unsigned int sum = 0;
+    for (int i = 0; i < 8; i++) {
+        sum += lanes[i];
+    }
+    return sum;
+}
+
+__attribute__((target("avx2")))
+static int extreme_avx2(const int* items, int vectors, bool maximum) {
+    __m256i result = _mm256_loadu_si256((const __m256i*)items);
+    for (int i = 1; i < vectors; i++) {
+        __m256i chunk = _mm256_loadu_si256((const __m256i*)items + i);
+        result = maximum ? _mm256_max_epi32(result, chunk) : _mm256_min_epi32(result, chunk);
+    }
+
+    int lanes[8];
+    _mm256_storeu_si256((__m256i*)lanes, result);
+    int extreme = lanes[0];
+    for (int i = 1; i < 8; i++) {
+        if (maximum ? lanes[i] > extreme : lanes[i] < extreme) extreme = lanes[i];
+    }
+    return extreme;
+}
+
+__attribute__((target("avx2")))
+static int index_of_avx2(const int* items, int vectors, int value) {
+    __m256i needle = _mm256_set1_epi32(value);
+    for (int i = 0; i < vectors; i++) {
+        __m256i equal = _mm256_cmpeq_epi32(_mm256_loadu_si256((const __m256i*)items + i), needle);
+        int mask = _mm256_movemask_epi8(equal);
+        if (mask != 0) return i * 8 + __builtin_ctz((unsigned int)mask) / 4;
+    }
+    return -1;
+}
+
+#endif // REDUCE_SIMD
+
+int reduce_sum(const int* items, int count) {
+    unsigned int total = 0;
+    int i = 0;
+#ifdef REDUCE_SIMD
+    int width = has_avx2() ? 8 : 4;
+    int vectors = count / width;
+    total = width == 8 ? sum_avx2(items, vectors) : sum_sse2(items, vectors);
+    i = vectors * width;
+#endif
+    for (; i < count; i++) {
+        total += (unsigned int)items[i];
+    }
+    return (int)total;
+}
+
+static int extreme(const int* items, int count, bool maximum) {
+    int result = items[0];
+    int i = 1;
+#ifdef REDUCE_SIMD
+    int width = has_avx2() ? 8 : 4;
+    int vectors = count / width;
+    if (vectors > 0) {
+        result = width == 8 ? extreme_avx2(items, vectors, maximum) : extreme_sse2(items, vectors, maximum);
+        i = vectors * width;
+    }
+#endif
+    for (; i < count; i++) {
+        if (maximum ? items[i] > result : items[i] < result) result = items[i];
+    }
+    return result;
+}
+
+int reduce_min(const int* items, int count) {
+    return extreme(items, count, false);
+}
+
+int reduce_max(const int* items, int count) {
+    return extreme(items, count, true);
+}
+
+int reduce_index_of(const int* items, int count, int value) {
+    int i = 0;
+#ifdef REDUCE_SIMD
+    int width = has_avx2() ? 8 : 4;
+    int vectors = count / width;
+    int found = width == 8 ? index_of_avx2(items, vectors, value) : index_of_sse2(items, vectors, value);
+    if (found >= 0) return found;
+    i = vectors * width;
+#endif
+    for (; i < count; i++) {
+        if (items[i] == value) return i;
+    }
+    return -1;
+}
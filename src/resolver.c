@@ -0,0 +1,252 @@
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include "headers/pool.h"
+#include "headers/resolver.h"
+
+// The resolver mirrors the environments the interpreter creates at runtime:
+// every function call, for loop and scoped block gets one, and a block whose
+// first statement is a declaration shares its enclosing environment. The
+// outermost environment (globals) is not tracked here; names that are not
+// found in any local scope are resolved by name at runtime.
+
+typedef struct {
+    const char** names;   // Slot index -> declared name
+    int count;
+    int capacity;
+} Scope;
+
+typedef struct {
+    Scope* scopes;
+    int scope_count;
+    int scope_capacity;
+    bool in_function;     // Returns here belong to a function call
+    const char* main_name;  // Interned "main"
+} Resolver;
+
+static Resolver resolver;
+
+static void resolve_stmt(Stmt* stmt);
+static void resolve_expr(Expr* expr);
+
+static void begin_scope(void) {
+    if (resolver.scope_count == resolver.scope_capacity) {
+        resolver.scope_capacity = resolver.scope_capacity < 8 ? 8 : resolver.scope_capacity * 2;
+        resolver.scopes = realloc(resolver.scopes, sizeof(Scope) * resolver.scope_capacity);
+    }
+
+    Scope* scope = &resolver.scopes[resolver.scope_count++];
+    scope->names = NULL;
+    scope->count = 0;
+    scope->capacity = 0;
+}
+
+// Returns the number of slots the closed scope needs
+static int end_scope(void) {
+    Scope* scope = &resolver.scopes[--resolver.scope_count];
+    int size = scope->count;
+    free(scope->names);
+    return size;
+}
+
+static int add_slot(Scope* scope, const char* name) {
+    if (scope->count == scope->capacity) {
+        scope->capacity = scope->capacity < 8 ? 8 : scope->capacity * 2;
+        scope->names = realloc(scope->names, sizeof(const char*) * scope->capacity);
+    }
+
+    scope->names[scope->count] = name;
+    return scope->count++;
+}
+
+// Declaring a name twice in one scope reuses its slot, like environment_define
+static int declare(const char* name) {
+    if (resolver.scope_count == 0) return -1;
+
+    Scope* scope = &resolver.scopes[resolver.scope_count - 1];
+    for (int i = 0; i < scope->count; i++) {
+        if (scope->names[i] == name) return i;
+    }
+    return add_slot(scope, name);
+}
+
+static void resolve_local(const char* name, int* depth, int* slot) {
+    for (int i = resolver.scope_count - 1; i >= 0; i--) {
+        Scope* scope = &resolver.scopes[i];
+        for (int j = 0; j < scope->count; j++) {
+            if (scope->names[j] == name) {
+                *depth = resolver.scope_count - 1 - i;
+                *slot = j;
+                return;
+            }
+        }
+    }
+
+    // Global, looked up by name the first time it is used
+    *depth = -1;
+    *slot = -1;
+}
+
+// Whether a resolved expression contains a call
+static bool calls(Expr* expr) {
+    return expr != NULL && expr->calls;
+}
+
+static void resolve_expr(Expr* expr) {
+    if (expr == NULL) return;
+
+    switch (expr->type) {
+        case EXPR_LITERAL:
+            expr->calls = false;
+            break;
+        case EXPR_BINARY:
+            resolve_expr(expr->as.binary.left);
+            resolve_expr(expr->as.binary.right);
+            expr->calls = calls(expr->as.binary.left) || calls(expr->as.binary.right);
+            break;
+        case EXPR_UNARY:
+            resolve_expr(expr->as.unary.operand);
+            expr->calls = calls(expr->as.unary.operand);
+            break;
+        case EXPR_VARIABLE:
+            resolve_local(expr->as.variable.name.lexeme, &expr->as.variable.depth, &expr->as.variable.slot);
+            expr->calls = false;
+            break;
+        case EXPR_ASSIGN:
+            resolve_expr(expr->as.assign.value);
+            resolve_local(expr->as.assign.name.lexeme, &expr->as.assign.depth, &expr->as.assign.slot);
+            expr->calls = calls(expr->as.assign.value);
+            break;
+        case EXPR_CALL:
+            resolve_expr(expr->as.call.callee);
+            for (int i = 0; i < expr->as.call.arg_count; i++) {
+                resolve_expr(expr->as.call.arguments[i]);
+            }
+            expr->calls = true;
+            break;
+        case EXPR_LIST_ACCESS:
+            resolve_expr(expr->as.list_access.list);
+            resolve_expr(expr->as.list_access.index);
+            expr->calls = calls(expr->as.list_access.index);
+            break;
+        case EXPR_LIST_METHOD:
+            resolve_expr(expr->as.list_method.list);
+            resolve_expr(expr->as.list_method.argument);
+            expr->calls = calls(expr->as.list_method.argument);
+            break;
+        case EXPR_LIST_PROPERTY:
+            resolve_expr(expr->as.list_property.list);
+            expr->calls = false;
+            break;
+    }
+}
+
+static void resolve_function(FunctionStmt* function) {
+    bool enclosing = resolver.in_function;
+    resolver.in_function = true;
+
+    // main runs directly in the environment it is declared in
+    if (function->name.lexeme == resolver.main_name) {
+        resolve_stmt(function->body);
+        resolver.in_function = enclosing;
+        return;
+    }
+
+    // Functions are only declared at the top level, so the scope stack is
+    // empty here and the call environment's parent is the globals
+    begin_scope();
+    // Parameters always occupy the first slots, in order
+    for (int i = 0; i < function->param_count; i++) {
+        add_slot(&resolver.scopes[resolver.scope_count - 1], function->params[i].lexeme);
+    }
+    resolve_stmt(function->body);
+    function->scope_size = end_scope();
+    resolver.in_function = enclosing;
+}
+
+// Whether a resolved statement, if there is one, runs straight through
+static bool straight(Stmt* stmt) {
+    return stmt == NULL || stmt->straight;
+}
+
+static void resolve_stmt(Stmt* stmt) {
+    if (stmt == NULL) return;
+
+    switch (stmt->type) {
+        case STMT_EXPRESSION:
+            resolve_expr(stmt->as.expression);
+            stmt->straight = !calls(stmt->as.expression);
+            break;
+        case STMT_VAR_DECL:
+            // The variable is defined before its initializer runs
+            stmt->as.var_decl.slot = declare(stmt->as.var_decl.name.lexeme);
+            resolve_expr(stmt->as.var_decl.initializer);
+            stmt->straight = !calls(stmt->as.var_decl.initializer);
+            break;
+        case STMT_BLOCK: {
+            bool new_scope = stmt->as.block.count == 0 || stmt->as.block.statements[0]->type != STMT_VAR_DECL;
+            if (new_scope) begin_scope();
+
+            stmt->straight = true;
+            for (int i = 0; i < stmt->as.block.count; i++) {
+                resolve_stmt(stmt->as.block.statements[i]);
+                stmt->straight = stmt->straight && straight(stmt->as.block.statements[i]);
+            }
+
+            if (new_scope) stmt->as.block.scope_size = end_scope();
+            break;
+        }
+        case STMT_IF:
+            resolve_expr(stmt->as.if_stmt.condition);
+            resolve_stmt(stmt->as.if_stmt.then_branch);
+            resolve_stmt(stmt->as.if_stmt.else_branch);
+            stmt->straight = !calls(stmt->as.if_stmt.condition) && straight(stmt->as.if_stmt.then_branch) &&
+                             straight(stmt->as.if_stmt.else_branch);
+            break;
+        case STMT_WHILE:
+            resolve_expr(stmt->as.while_stmt.condition);
+            resolve_stmt(stmt->as.while_stmt.body);
+            stmt->straight = !calls(stmt->as.while_stmt.condition) && straight(stmt->as.while_stmt.body);
+            break;
+        case STMT_FOR:
+            begin_scope();
+            resolve_stmt(stmt->as.for_stmt.init);
+            resolve_expr(stmt->as.for_stmt.condition);
+            resolve_stmt(stmt->as.for_stmt.body);
+            resolve_expr(stmt->as.for_stmt.increment);
+            stmt->as.for_stmt.scope_size = end_scope();
+            stmt->straight = straight(stmt->as.for_stmt.init) && !calls(stmt->as.for_stmt.condition) &&
+                             straight(stmt->as.for_stmt.body) && !calls(stmt->as.for_stmt.increment);
+            break;
+        case STMT_RETURN:
+            resolve_expr(stmt->as.return_stmt.expression);
+            // Nothing is left to do in the caller once the call returns
+            stmt->as.return_stmt.tail_call = resolver.in_function && stmt->as.return_stmt.expression != NULL &&
+                                             stmt->as.return_stmt.expression->type == EXPR_CALL;
+            stmt->straight = false;
+            break;
+        case STMT_FUNCTION:
+            resolve_function(&stmt->as.function);
+            stmt->straight = false;
+            break;
+        case STMT_INCLUDE:
+            // Included files are resolved when the interpreter loads them
+            stmt->straight = false;
+            break;
+    }
+}
+
+void resolve(Stmt** statements, int count) {
+    resolver.scopes = NULL;
+    resolver.scope_count = 0;
+    resolver.scope_capacity = 0;
+    resolver.in_function = false;
+    resolver.main_name = pool_intern("main");
+
+    for (int i = 0; i < count; i++) {
+        resolve_stmt(statements[i]);
+    }
+
+    free(resolver.scopes);
+    resolver.scopes = NULL;
+}
@@ -0,0 +1,222 @@
+#include <pthread.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/resource.h>
+#include <unistd.h>
+#include "headers/runtime.h"
+
+Output rt_output;
+int rt_calls_left;
+uintptr_t rt_stack_limit;
+
+typedef struct {
+    void (*script)(void);
+    size_t stack_size;
+} Run;
+
+void rt_init(int max_stack) {
+    output_init(&rt_output, STDOUT_FILENO, OUTPUT_DEFAULT_SIZE);
+    rt_calls_left = max_stack;
+}
+
+static void run_script(Run* run) {
+    // Calls may go as deep into the C stack as leaves a margin at its end
+    char base;
+    rt_stack_limit = (uintptr_t)&base - (run->stack_size - RT_STACK_MARGIN);
+    run->script();
+}
+
+static void* script_thread(void* argument) {
+    run_script(argument);
+    return NULL;
+}
+
+void rt_run(void (*script)(void)) {
+    Run run = {script, (size_t)rt_calls_left * RT_FRAME_BYTES + 4 * RT_STACK_MARGIN};
+
+    pthread_attr_t attributes;
+    pthread_t thread;
+    if (pthread_attr_init(&attributes) == 0) {
+        bool started = pthread_attr_setstacksize(&attributes, run.stack_size) == 0 &&
+                       pthread_create(&thread, &attributes, script_thread, &run) == 0;
+        pthread_attr_destroy(&attributes);
+        if (started) {
+            pthread_join(thread, NULL);
+            return;
+        }
+    }
+
+    // Otherwise calls get the rest of this thread's stack, minus what the
+    // caller may already have used
+    struct rlimit limit;
+    run.stack_size = 8 * 1024 * 1024;
+    if (getrlimit(RLIMIT_STACK, &limit) == 0 && limit.rlim_cur != RLIM_INFINITY) {
+        run.stack_size = (size_t)limit.rlim_cur;
+    }
+    run.stack_size = run.stack_size > 4 * RT_STACK_MARGIN ? run.stack_size - 2 * RT_STACK_MARGIN : RT_STACK_MARGIN;
+    run_script(&run);
+}
+
+int rt_finish(void) {
+    output_free(&rt_output);
+    return 0;
+}
+
+_Noreturn void rt_fail(int line) {
+    output_error("[line %d]\n", line);
+    output_free(&rt_output);
+    exit(70);
+}
+
+_Noreturn void rt_error(int line, const char* format, ...) {
+    va_list args;
+    va_start(args, format);
+    output_verror(format, args);
+    va_end(args);
+    fputs("\n", stderr);
+
+    rt_fail(line);
+}
+
+Value rt_binary(int line, TokenType op, Value left, Value right) {
+    Value result;
+    bool ok = value_binary(op, left, right, &result);
+    value_release(&left);
+    value_release(&right);
+    if (!ok) rt_fail(line);
+    return result;
+}
+
+Value rt_negate(Value operand) {
+    Value result;
+    value_negate(operand, &result);
+    value_release(&operand);
+    return result;
+}
+
+bool rt_truthy(int line, Value condition) {
+    bool is_true;
+    bool ok = value_is_truthy(condition, &is_true);
+    value_release(&condition);
+    if (!ok) rt_error(line, "Condition must be an integer or boolean");
+    return is_true;
+}
+
+int rt_define_int(int line, Value value, DataType type) {
+    if (!value_coerce(type, &value)) {
+        value_release(&value);
+        rt_error(line, "Type mismatch in variable initialization");
+    }
+    return value.value.int_val;
+}
+
+void rt_define(int line, Value* target, DataType type, Value value) {
+    if (!value_coerce(type, &value)) {
+        value_release(&value);
+        rt_error(line, "Type mismatch in variable initialization");
+    }
+    value_release(target);
+    *target = value;
+}
+
+int rt_argument_int(int line, Value value, DataType type, int index, const char* function) {
+    if (!value_coerce(type, &value)) {
+        value_release(&value);
+        rt_error(line, "Type mismatch in argument %d of '%s'", index, function);
+    }
+    return value.value.int_val;
+}
+
+Value rt_argument(int line, Value value, DataType type, int index, const char* function) {
+    if (!value_coerce(type, &value)) {
+        value_release(&value);
+        rt_error(line, "Type mismatch in argument %d of '%s'", index, function);
+    }
+    return value;
+}
+
+void rt_store_int(int* target, DataType type, Value value, const char* name) {
+    if (value.type != type) {
+        fprintf(stderr, "Type mismatch in assignment to '%s'\n", name);
+        return;
+    }
+    *target = value.value.int_val;
+}
+
+void rt_assign(Value* target, Value value, const char* name) {
+    if (target->type != value.type) {
+        fprintf(stderr, "Type mismatch in assignment to '%s'\n", name);
+        return;
+    }
+
+    value_release(target);
+    *target = value_copy(value);
+}
+
+Value rt_append(int line, Value* target, Value left, Value* right, int count, const char* name) {
+    if (value_append(target, left, right, count)) return value_copy(*target);
+
+    Value result = left;
+    for (int i = 0; i < count; i++) {
+        result = rt_binary(line, TOKEN_PLUS, result, right[i]);
+    }
+    rt_assign(target, result, name);
+    return result;
+}
+
+static void check_list(int line, Value* list, const char* message) {
+    if (list->type != TYPE_LIST) rt_error(line, "%s", message);
+}
+
+Value rt_get_index(int line, Value* list, Value index) {
+    check_list(line, list, "Cannot access index on a non-list value");
+    Value result;
+    if (!list_get(list->value.list_val, index, &result)) rt_fail(line);
+    return result;
+}
+
+Value rt_set_index(int line, Value* list, Value index, Value value) {
+    check_list(line, list, "Cannot assign to index of non-list value");
+    if (!list_set(list->value.list_val, index, value)) {
+        value_release(&value);
+        rt_fail(line);
+    }
+    return value;
+}
+
+Value rt_list_add(int line, Value* list, Value item) {
+    check_list(line, list, "Cannot call method on a non-list value");
+    bool ok = list_append(list->value.list_val, item);
+    value_release(&item);
+    if (!ok) rt_fail(line);
+    return value_default(TYPE_VOID);
+}
+
+Value rt_list_remove(int line, Value* list, Value index) {
+    check_list(line, list, "Cannot call method on a non-list value");
+    if (!list_remove(list->value.list_val, index)) rt_fail(line);
+    return value_default(TYPE_VOID);
+}
+
+Value rt_list_reserve(int line, Value* list, Value capacity) {
+    check_list(line, list, "Cannot call method on a non-list value");
+    if (!list_reserve(list->value.list_val, capacity)) rt_fail(line);
+    return value_default(TYPE_VOID);
+}
+
+Value rt_list_sort(int line, Value* list, Value descending) {
+    check_list(line, list, "Cannot call method on a non-list value");
+    if (!list_sort(list->value.list_val, descending)) rt_fail(line);
+    return value_default(TYPE_VOID);
+}
+
+Value rt_native(int line, const Native* native, Value* args, int count) {
+    Value result;
+    bool ok = native_call(native, &rt_output, args, count, &result);
+    for (int i = 0; i < count; i++) {
+        value_release(&args[i]);
+    }
+    if (!ok) rt_fail(line);
+    return result;
+}
@@ -0,0 +1,272 @@
+#include <stdint.h>
+#include "headers/sort.h"
+
+// Below this many items an insertion sort beats either sort's setup
+#define SORT_SMALL 32
+
+// Radix keys are 64 bits wide, sorted a byte per pass
+#define RADIX_PASSES 8
+
+// Radix keys compare as unsigned numbers in the order of the items they come
+// from. Flipping the sign bit does that for integers; a negative float also
+// has its other bits flipped, since its magnitude grows downwards. Keys of
+// 32-bit items stay 32 bits wide, so the radix sort skips the upper passes.
+static uint32_t int_key(int value) {
+    return (uint32_t)value ^ 0x80000000u;
+}
+
+static int key_int(uint32_t key) {
+    return (int)(key ^ 0x80000000u);
+}
+
+static uint32_t float_key(float value) {
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    return bits & 0x80000000u ? ~bits : bits | 0x80000000u;
+}
+
+static float key_float(uint32_t key) {
+    uint32_t bits = key & 0x80000000u ? key & ~0x80000000u : ~key;
+    float value;
+    memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+static uint64_t long_key(long value) {
+    return (uint64_t)(int64_t)value ^ 0x8000000000000000u;
+}
+
+static long key_long(uint64_t key) {
+    return (long)(int64_t)(key ^ 0x8000000000000000u);
+}
+
+static uint64_t double_key(double value) {
+    uint64_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    return bits & 0x8000000000000000u ? ~bits : bits | 0x8000000000000000u;
+}
+
+static double key_double(uint64_t key) {
+    uint64_t bits = key & 0x8000000000000000u ? key & ~0x8000000000000000u : ~key;
+    double value;
+    memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+// LSD radix sort, a byte per pass. The histograms of every pass are counted
+// in one read of the keys, and a pass over a byte that all keys share is
+// skipped, so keys in a narrow range take few passes.
+static void radix_sort(uint64_t* keys, int count) {
+    if (count < SORT_SMALL) {
+        for (int i = 1; i < count; i++) {
+            uint64_t key = keys[i];
+            int j = i;
+            for (; j > 0 && keys[j - 1] > key; j--) {
+                keys[j] = keys[j - 1];
+            }
+            keys[j] = key;
+        }
+        return;
+    }
+
+    // One histogram of 256 digits per pass
+    size_t (*counts)[256] = calloc(RADIX_PASSES, sizeof *counts);
+    for (int i = 0; i < count; i++) {
+        for (int pass = 0; pass < RADIX_PASSES; pass++) {
+            counts[pass][(keys[i] >> (pass * 8)) & 0xff]++;
+        }
+    }
+
+    uint64_t* scratch = malloc(sizeof(uint64_t) * count);
+    uint64_t* from = keys;
+    uint64_t* to = scratch;
+    for (int pass = 0; pass < RADIX_PASSES; pass++) {
+        int shift = pass * 8;
+        size_t* offsets = counts[pass];
+        if (offsets[(from[0] >> shift) & 0xff] == (size_t)count) continue;
+
+        size_t offset = 0;
+        for (int digit = 0; digit < 256; digit++) {
+            size_t digit_count = offsets[digit];
+            offsets[digit] = offset;
+            offset += digit_count;
+        }
+        for (int i = 0; i < count; i++) {
+            to[offsets[(from[i] >> shift) & 0xff]++] = from[i];
+        }
+
+        uint64_t* swap = from;
+        from = to;
+        to = swap;
+    }
+
+    if (from != keys) memcpy(keys, from, sizeof(uint64_t) * count);
+    free(scratch);
+    free(counts);
+}
+
+// Complementing the keys reverses their order while ties keep theirs, so a
+// descending sort stays stable
+static void sort_numbers(List* list, bool descending) {
+    int count = list->count;
+    uint64_t* keys = malloc(sizeof(uint64_t) * count);
+    uint64_t flip = 0;
+    if (descending) {
+        flip = list->item_type == TYPE_LONG || list->item_type == TYPE_DOUBLE ? UINT64_MAX : UINT32_MAX;
+    }
+
+    for (int i = 0; i < count; i++) {
+        switch (list->item_type) {
+            case TYPE_FLOAT:  keys[i] = float_key(list->items.floats[i]); break;
+            case TYPE_LONG:   keys[i] = long_key(list->items.longs[i]); break;
+            case TYPE_DOUBLE: keys[i] = double_key(list->items.doubles[i]); break;
+            default:          keys[i] = int_key(list->items.ints[i]); break;
+        }
+        keys[i] ^= flip;
+    }
+
+    radix_sort(keys, count);
+
+    for (int i = 0; i < count; i++) {
+        uint64_t key = keys[i] ^ flip;
+        switch (list->item_type) {
+            case TYPE_FLOAT:  list->items.floats[i] = key_float((uint32_t)key); break;
+            case TYPE_LONG:   list->items.longs[i] = key_long(key); break;
+            case TYPE_DOUBLE: list->items.doubles[i] = key_double(key); break;
+            default:          list->items.ints[i] = key_int((uint32_t)key); break;
+        }
+    }
+    free(keys);
+}
+
+// Strings order by their bytes, a prefix before the longer string; direction
+// is -1 to reverse that
+static int order(const String* a, const String* b, int direction) {
+    int length = a->length < b->length ? a->length : b->length;
+    int result = memcmp(a->chars, b->chars, length);
+    if (result == 0) result = a->length - b->length;
+    return result < 0 ? -direction : result > 0 ? direction : 0;
+}
+
+static void swap_strings(String** items, int a, int b) {
+    String* swap = items[a];
+    items[a] = items[b];
+    items[b] = swap;
+}
+
+static void insertion_sort(String** items, int count, int direction) {
+    for (int i = 1; i < count; i++) {
+        String* item = items[i];
+        int j = i;
+        for (; j > 0 && order(items[j - 1], item, direction) > 0; j--) {
+            items[j] = items[j - 1];
+        }
+        items[j] = item;
+    }
+}
+
+static void sift_down(String** items, int root, int count, int direction) {
+    for (;;) {
+        int child = 2 * root + 1;
+        if (child >= count) return;
+        if (child + 1 < count && order(items[child], items[child + 1], direction) < 0) child++;
+        if (order(items[root], items[child], direction) >= 0) return;
+        swap_strings(items, root, child);
+        root = child;
+    }
+}
+
+static void heap_sort(String** items, int count, int direction) {
+    for (int i = count / 2 - 1; i >= 0; i--) {
+        sift_down(items, i, count, direction);
+    }
+    for (int end = count - 1; end > 0; end--) {
+        swap_strings(items, 0, end);
+        sift_down(items, 0, end, direction);
+    }
+}
+
+// Quicksort around the median of the first, middle and last items. Once
+// depth runs out the partitions are going badly, and heapsort finishes the
+// range in guaranteed n log n.
+static void introsort(String** items, int count, int depth, int direction) {
+    while (count > SORT_SMALL) {
+        if (depth-- == 0) {
+            heap_sort(items, count, direction);
+            return;
+        }
+
+        int middle = count / 2;
+        int last = count - 1;
+        if (order(items[middle], items[0], direction) < 0) swap_strings(items, middle, 0);
+        if (order(items[last], items[0], direction) < 0) swap_strings(items, last, 0);
+        if (order(items[last], items[middle], direction) < 0) swap_strings(items, last, middle);
+        swap_strings(items, 0, middle);
+
+        // Both scans stop on items equal to the pivot, which keeps runs of
+        // equal strings splitting evenly
+        String* pivot = items[0];
+        int i = 1;
+        int j = last;
+        for (;;) {
+            while (i <= j && order(items[i], pivot, direction) < 0) i++;
+            while (order(items[j], pivot, direction) > 0) j--;
+            if (i >= j) break;
+            swap_strings(items, i++, j--);
+        }
+        swap_strings(items, 0, j);
+
+        // Recurse into the smaller side so the C stack stays logarithmic
+        if (j < count - j - 1) {
+            introsort(items, j, depth, direction);
+            items += j + 1;
+            count -= j + 1;
+        } else {
+            introsort(items + j + 1, count - j - 1, depth, direction);
+            count = j;
+        }
+    }
+    insertion_sort(items, count, direction);
+}
+
+void sort_list(List* list, bool descending) {
+    if (list->count < 2) return;
+
+    if (list->item_type == TYPE_STRING) {
+        int depth = 0;
+        for (int n = list->count; n > 1; n /= 2) {
+            depth += 2;
+        }
+        introsort(list->items.strings, list->count, depth, descending ? -1 : 1);
+    } else {
+        sort_numbers(list, descending);
+    }
+}
+
+int sort_lower_bound(const int* items, int count, int value) {
+    int low = 0;
+    while (count > 0) {
+        int half = count / 2;
+        if (items[low + half] < value) {
+            low += half + 1;
+            count -= half + 1;
+        } else {
+            count = half;
+        }
+    }
+    return low;
+}
+
+int sort_upper_bound(const int* items, int count, int value) {
+    int low = 0;
+    while (count > 0) {
+        int half = count / 2;
+        if (items[low + half] <= value) {
+            low += half + 1;
+            count -= half + 1;
+        } else {
+            count = half;
+        }
+    }
+    return low;
+}
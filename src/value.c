@@ -0,0 +1,724 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "headers/value.h"
+#include "headers/sort.h"
+
+// A string of length characters for the caller to fill in
+static String* string_alloc(int length) {
+    String* string = malloc(sizeof(String) + length + 1);
+    string->ref_count = 1;
+    string->length = length;
+    string->capacity = length;
+    string->hash = 0;
+    string->chars[length] = '\0';
+    return string;
+}
+
+String* string_new(const char* chars, int length) {
+    String* string = string_alloc(length);
+    memcpy(string->chars, chars, length);
+    return string;
+}
+
+void string_free(String* string) {
+    free(string);
+}
+
+uint32_t string_hash(const char* chars, int length) {
+    // FNV-1a
+    uint32_t hash = 2166136261u;
+    for (int i = 0; i < length; i++) {
+        hash ^= (uint8_t)chars[i];
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+Value value_string(const char* chars, int length) {
+    Value value = {0};
+    value.type = TYPE_STRING;
+    if (length <= STRING_INLINE_MAX) {
+        memcpy(value.value.inline_chars, chars, length);
+    } else {
+        value.value.string_val = string_new(chars, length);
+        value.is_object = true;
+    }
+    return value;
+}
+
+Value value_constant_string(String* string) {
+    Value value = {0};
+    value.type = TYPE_STRING;
+    value.value.string_val = string;
+    value.is_object = true;
+    value.is_constant = true;
+    return value;
+}
+
+// Equal strings have equal hashes, so a cached mismatch settles it early
+static bool strings_equal(const Value* left, const Value* right) {
+    int length = value_length(left);
+    if (length != value_length(right)) return false;
+
+    if (left->is_object && right->is_object) {
+        String* a = left->value.string_val;
+        String* b = right->value.string_val;
+        if (a == b) return true;
+        if (a->hash == 0) a->hash = string_hash(a->chars, a->length);
+        if (b->hash == 0) b->hash = string_hash(b->chars, b->length);
+        if (a->hash != b->hash) return false;
+    }
+    return memcmp(value_chars(left), value_chars(right), length) == 0;
+}
+
+Value value_default(DataType type) {
+    Value value = {0};
+    value.type = type;
+    value.is_function = false;
+
+    switch (type) {
+        case TYPE_INT:
+            value.value.int_val = 0;
+            break;
+        case TYPE_FLOAT:
+            value.value.float_val = 0.0;
+            break;
+        case TYPE_STRING:
+            // The zeroed inline characters are the empty string
+            break;
+        case TYPE_BOOL:
+            value.value.bool_val = 0; // false
+            break;
+        case TYPE_LONG:
+            value.value.long_val = 0L;
+            break;
+        case TYPE_DOUBLE:
+            value.value.double_val = 0.0;
+            break;
+        case TYPE_LIST:
+            value.value.list_val = list_new();
+            break;
+        default:
+            break;
+    }
+
+    return value;
+}
+
+bool value_coerce(DataType type, Value* value) {
+    // Special case: implicit int->bool conversion for boolean variables
+    if (type == TYPE_BOOL && value->type == TYPE_INT) {
+        value->value.bool_val = value->value.int_val ? 1 : 0;
+    }
+    // Special case: int->long conversion
+    else if (type == TYPE_LONG && value->type == TYPE_INT) {
+        value->value.long_val = (long)value->value.int_val;
+    }
+    // Special case: float->double conversion
+    else if (type == TYPE_DOUBLE && value->type == TYPE_FLOAT) {
+        value->value.double_val = (double)value->value.float_val;
+    }
+    // Regular case: types match
+    else if (value->type != type) {
+        return false;
+    }
+
+    value->type = type;
+    return true;
+}
+
+bool value_is_truthy(Value condition, bool* is_true) {
+    if (condition.type != TYPE_INT && condition.type != TYPE_BOOL) {
+        return false;
+    }
+
+    *is_true = (condition.type == TYPE_BOOL)
+               ? condition.value.bool_val
+               : condition.value.int_val != 0;
+    return true;
+}
+
+// Arithmetic keeps the operand type, comparisons produce ints
+#define ARITHMETIC(field) \
+    case TOKEN_PLUS:     result->value.field = left.value.field + right.value.field; return true; \
+    case TOKEN_MINUS:    result->value.field = left.value.field - right.value.field; return true; \
+    case TOKEN_MULTIPLY: result->value.field = left.value.field * right.value.field; return true;
+
+#define COMPARISONS(field) \
+    case TOKEN_EQUALS:        result->type = TYPE_INT; result->value.int_val = left.value.field == right.value.field; return true; \
+    case TOKEN_NOT_EQUALS:    result->type = TYPE_INT; result->value.int_val = left.value.field != right.value.field; return true; \
+    case TOKEN_LESS:          result->type = TYPE_INT; result->value.int_val = left.value.field < right.value.field; return true; \
+    case TOKEN_LESS_EQUAL:    result->type = TYPE_INT; result->value.int_val = left.value.field <= right.value.field; return true; \
+    case TOKEN_GREATER:       result->type = TYPE_INT; result->value.int_val = left.value.field > right.value.field; return true; \
+    case TOKEN_GREATER_EQUAL: result->type = TYPE_INT; result->value.int_val = left.value.field >= right.value.field; return true;
+
+#define INTEGER_DIVISION(field) \
+    case TOKEN_DIVIDE: \
+        if (right.value.field == 0) { \
+            output_error("Division by zero\n"); \
+            return false; \
+        } \
+        result->value.field = left.value.field / right.value.field; \
+        return true; \
+    case TOKEN_MODULO: \
+        if (right.value.field == 0) { \
+            output_error("Modulo by zero\n"); \
+            return false; \
+        } \
+        result->value.field = left.value.field % right.value.field; \
+        return true;
+
+#define FLOATING_DIVISION(field, name) \
+    case TOKEN_DIVIDE: \
+        if (right.value.field == 0.0) { \
+            output_error("Division by zero\n"); \
+            return false; \
+        } \
+        result->value.field = left.value.field / right.value.field; \
+        return true; \
+    case TOKEN_MODULO: \
+        output_error("Modulo operation not supported for " name " values\n"); \
+        return false;
+
+bool value_common_type(DataType left, DataType right, DataType* type) {
+    if (left == right) {
+        *type = left;
+    } else if ((left == TYPE_LONG && right == TYPE_INT) || (left == TYPE_INT && right == TYPE_LONG)) {
+        *type = TYPE_LONG;
+    } else if ((left == TYPE_DOUBLE && right == TYPE_FLOAT) || (left == TYPE_FLOAT && right == TYPE_DOUBLE)) {
+        *type = TYPE_DOUBLE;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+bool value_binary_supported(TokenType op, DataType type) {
+    switch (op) {
+        case TOKEN_PLUS:
+            return type != TYPE_BOOL && type != TYPE_LIST && type != TYPE_VOID;
+        case TOKEN_MINUS:
+        case TOKEN_MULTIPLY:
+        case TOKEN_DIVIDE:
+        case TOKEN_LESS:
+        case TOKEN_LESS_EQUAL:
+        case TOKEN_GREATER:
+        case TOKEN_GREATER_EQUAL:
+            return type == TYPE_INT || type == TYPE_LONG || type == TYPE_FLOAT || type == TYPE_DOUBLE;
+        case TOKEN_MODULO:
+            return type == TYPE_INT || type == TYPE_LONG;
+        case TOKEN_EQUALS:
+        case TOKEN_NOT_EQUALS:
+            return type != TYPE_LIST && type != TYPE_VOID;
+        default:
+            return false;
+    }
+}
+
+bool value_binary(TokenType op, Value left, Value right, Value* result) {
+    *result = (Value){0};
+    result->is_function = false;
+
+    // Special handling for string concatenation
+    if (op == TOKEN_PLUS && left.type == TYPE_STRING && right.type == TYPE_STRING) {
+        int len1 = value_length(&left);
+        int len2 = value_length(&right);
+        if (len1 + len2 <= STRING_INLINE_MAX) {
+            char chars[STRING_INLINE_MAX];
+            memcpy(chars, value_chars(&left), len1);
+            memcpy(chars + len1, value_chars(&right), len2);
+            *result = value_string(chars, len1 + len2);
+            return true;
+        }
+
+        String* string = string_alloc(len1 + len2);
+        memcpy(string->chars, value_chars(&left), len1);
+        memcpy(string->chars + len1, value_chars(&right), len2);
+
+        result->type = TYPE_STRING;
+        result->value.string_val = string;
+        result->is_object = true;
+        return true;
+    }
+
+    // Regular numeric operations
+    DataType type;
+    if (!value_common_type(left.type, right.type, &type)) {
+        output_error("Operands must be of the same type\n");
+        return false;
+    }
+    value_coerce(type, &left);
+    value_coerce(type, &right);
+
+    result->type = left.type;
+    switch (left.type) {
+        case TYPE_INT:
+            switch (op) {
+                ARITHMETIC(int_val)
+                INTEGER_DIVISION(int_val)
+                COMPARISONS(int_val)
+                default: break;
+            }
+            break;
+        case TYPE_LONG:
+            switch (op) {
+                ARITHMETIC(long_val)
+                INTEGER_DIVISION(long_val)
+                COMPARISONS(long_val)
+                default: break;
+            }
+            break;
+        case TYPE_FLOAT:
+            switch (op) {
+                ARITHMETIC(float_val)
+                FLOATING_DIVISION(float_val, "float")
+                COMPARISONS(float_val)
+                default: break;
+            }
+            break;
+        case TYPE_DOUBLE:
+            switch (op) {
+                ARITHMETIC(double_val)
+                FLOATING_DIVISION(double_val, "double")
+                COMPARISONS(double_val)
+                default: break;
+            }
+            break;
+        case TYPE_BOOL:
+            if (op == TOKEN_EQUALS || op == TOKEN_NOT_EQUALS) {
+                result->type = TYPE_INT;
+                result->value.int_val = (left.value.bool_val == right.value.bool_val) == (op == TOKEN_EQUALS);
+                return true;
+            }
+            break;
+        case TYPE_STRING:
+            if (op == TOKEN_EQUALS || op == TOKEN_NOT_EQUALS) {
+                result->type = TYPE_INT;
+                result->value.int_val = strings_equal(&left, &right) == (op == TOKEN_EQUALS);
+                return true;
+            }
+            break;
+        default:
+            break;
+    }
+
+    result->type = TYPE_INT;
+    output_error("Invalid operands for binary operator\n");
+    return false;
+}
+
+#undef ARITHMETIC
+#undef COMPARISONS
+#undef INTEGER_DIVISION
+#undef FLOATING_DIVISION
+
+bool value_negate(Value operand, Value* result) {
+    *result = (Value){0};
+    result->type = operand.type;
+    result->is_function = false;
+
+    if (operand.type == TYPE_INT)
+        result->value.int_val = -operand.value.int_val;
+    else if (operand.type == TYPE_FLOAT)
+        result->value.float_val = -operand.value.float_val;
+    else if (operand.type == TYPE_LONG)
+        result->value.long_val = -operand.value.long_val;
+    else if (operand.type == TYPE_DOUBLE)
+        result->value.double_val = -operand.value.double_val;
+    return true;
+}
+
+bool value_append(Value* target, Value left, Value* right, int count) {
+    if (!target->is_object || !left.is_object || left.value.string_val != target->value.string_val) {
+        return false;
+    }
+    int length = target->value.string_val->length;
+    for (int i = 0; i < count; i++) {
+        if (right[i].type != TYPE_STRING || right[i].is_function) return false;
+        length += value_length(&right[i]);
+    }
+
+    // Without the copy in left, target may be the only holder of its string
+    value_release(&left);
+    String* string = target->value.string_val;
+    if (target->is_constant || string->ref_count > 1) {
+        String* shared = string;
+        string = string_alloc(length);
+        memcpy(string->chars, shared->chars, shared->length);
+        string->length = shared->length;
+        value_release(target);
+        target->value.string_val = string;
+        target->is_object = true;
+        target->is_constant = false;
+    } else if (length > string->capacity) {
+        int capacity = string->capacity < 8 ? 8 : string->capacity * 2;
+        if (capacity < length) capacity = length;
+        string = realloc(string, sizeof(String) + capacity + 1);
+        string->capacity = capacity;
+        target->value.string_val = string;
+    }
+
+    for (int i = 0; i < count; i++) {
+        int right_length = value_length(&right[i]);
+        memcpy(string->chars + string->length, value_chars(&right[i]), right_length);
+        string->length += right_length;
+        value_release(&right[i]);
+    }
+    string->chars[length] = '\0';
+    string->hash = 0;
+    return true;
+}
+
+void print_value(Output* output, Value arg) {
+    switch (arg.type) {
+        case TYPE_INT:
+            output_long(output, arg.value.int_val);
+            break;
+        case TYPE_FLOAT:
+            output_double(output, arg.value.float_val);
+            break;
+        case TYPE_STRING:
+            output_write(output, value_chars(&arg), value_length(&arg));
+            break;
+        case TYPE_BOOL:
+            output_string(output, arg.value.bool_val ? "true" : "false");
+            break;
+        case TYPE_LONG:
+            output_long(output, arg.value.long_val);
+            break;
+        case TYPE_DOUBLE:
+            output_double(output, arg.value.double_val);
+            break;
+        case TYPE_LIST: {
+            List* list = arg.value.list_val;
+            output_char(output, '[');
+            for (int j = 0; j < list->count; j++) {
+                // Print the item based on its type
+                switch (list->item_type) {
+                    case TYPE_INT:
+                        output_long(output, list->items.ints[j]);
+                        break;
+                    case TYPE_FLOAT:
+                        output_double(output, list->items.floats[j]);
+                        break;
+                    case TYPE_STRING:
+                        output_char(output, '"');
+                        output_write(output, list->items.strings[j]->chars, list->items.strings[j]->length);
+                        output_char(output, '"');
+                        break;
+                    case TYPE_BOOL:
+                        output_string(output, list->items.ints[j] ? "true" : "false");
+                        break;
+                    case TYPE_LONG:
+                        output_long(output, list->items.longs[j]);
+                        break;
+                    case TYPE_DOUBLE:
+                        output_double(output, list->items.doubles[j]);
+                        break;
+                    default:
+                        output_char(output, '?');
+                        break;
+                }
+
+                if (j < list->count - 1) {
+                    output_write(output, ", ", 2);
+                }
+            }
+            output_char(output, ']');
+            break;
+        }
+        default:
+            break;
+    }
+}
+
+// Bytes per element in a list's buffer, or 0 if the type cannot be stored
+static size_t item_size(DataType type) {
+    switch (type) {
+        case TYPE_INT:
+        case TYPE_BOOL:
+            return sizeof(int);
+        case TYPE_FLOAT:
+            return sizeof(float);
+        case TYPE_LONG:
+            return sizeof(long);
+        case TYPE_DOUBLE:
+            return sizeof(double);
+        case TYPE_STRING:
+            return sizeof(String*);
+        default:
+            return 0;
+    }
+}
+
+List* list_new(void) {
+    List* list = malloc(sizeof(List));
+    list->ref_count = 1;
+    list->item_type = TYPE_INT;
+    list->count = 0;
+    list->capacity = 0;
+    list->offset = 0;
+    list->items.data = NULL;
+    return list;
+}
+
+// Start of the allocation, before any free slots at the front
+static char* list_buffer(List* list) {
+    if (list->offset == 0) return list->items.data;
+    return (char*)list->items.data - list->offset * item_size(list->item_type);
+}
+
+void list_release(List* list) {
+    if (list == NULL || --list->ref_count > 0) return;
+
+    if (list->item_type == TYPE_STRING) {
+        for (int i = 0; i < list->count; i++) {
+            string_release(list->items.strings[i]);
+        }
+    }
+    free(list_buffer(list));
+    free(list);
+}
+
+// Make room for capacity items, moving the items back to the start of the
+// buffer first so that the free slots before them are reused
+static void grow_list(List* list, int capacity) {
+    char* buffer = list_buffer(list);
+    if (list->offset > 0) {
+        memmove(buffer, list->items.data, list->count * item_size(list->item_type));
+        list->items.data = buffer;
+        list->capacity += list->offset;
+        list->offset = 0;
+    }
+
+    if (capacity > list->capacity) {
+        list->items.data = realloc(buffer, item_size(list->item_type) * capacity);
+        list->capacity = capacity;
+    }
+}
+
+bool list_reserve(List* list, Value capacity) {
+    if (capacity.type != TYPE_INT || capacity.value.int_val < 0) {
+        output_error("List capacity must be a non-negative integer\n");
+        return false;
+    }
+
+    if (capacity.value.int_val > list->capacity) {
+        grow_list(list, capacity.value.int_val);
+    }
+    return true;
+}
+
+static bool check_index(List* list, Value index) {
+    if (index.type != TYPE_INT) {
+        output_error("List index must be an integer\n");
+        return false;
+    }
+
+    int idx = index.value.int_val;
+    if (idx < 0 || idx >= list->count) {
+        output_error("List index out of bounds: %d (size: %d)\n",
+                     idx, list->count);
+        return false;
+    }
+    return true;
+}
+
+// Store a value into an element slot the caller has already made room for
+static void store_item(List* list, int index, Value value) {
+    switch (list->item_type) {
+        case TYPE_INT:
+            list->items.ints[index] = value.value.int_val;
+            break;
+        case TYPE_BOOL:
+            list->items.ints[index] = value.value.bool_val;
+            break;
+        case TYPE_FLOAT:
+            list->items.floats[index] = value.value.float_val;
+            break;
+        case TYPE_LONG:
+            list->items.longs[index] = value.value.long_val;
+            break;
+        case TYPE_DOUBLE:
+            list->items.doubles[index] = value.value.double_val;
+            break;
+        case TYPE_STRING:
+            // Lists hold string objects; short strings get one when stored
+            if (value.is_object) {
+                list->items.strings[index] = value.value.string_val;
+                list->items.strings[index]->ref_count++;
+            } else {
+                list->items.strings[index] = string_new(value.value.inline_chars, value_length(&value));
+            }
+            break;
+        default:
+            break;
+    }
+}
+
+bool list_append(List* list, Value item) {
+    // If this is the first item, set the item type
+    if (list->count == 0 && item.type != list->item_type) {
+        if (item_size(item.type) == 0) {
+            output_error("Unsupported item type for list.add\n");
+            return false;
+        }
+        // Reserved space was sized for the old item type; an empty list
+        // has no free slots at the front
+        list->item_type = item.type;
+        if (list->capacity > 0) {
+            list->items.data = realloc(list->items.data, item_size(item.type) * list->capacity);
+        }
+    }
+
+    // Check that the new item matches the existing list type
+    if (item.type != list->item_type) {
+        output_error("Cannot add item of type %d to list of type %d\n",
+                     item.type, list->item_type);
+        return false;
+    }
+
+    // Free slots at the front are reclaimed once there are at least as many
+    // as items to move back, which keeps a list used as a queue from growing
+    if (list->count == list->capacity) {
+        int capacity = list->capacity < 8 ? 8 : list->capacity * 2;
+        grow_list(list, list->offset > 0 && list->offset >= list->count ? list->capacity : capacity);
+    }
+
+    store_item(list, list->count, item);
+    list->count++;
+    return true;
+}
+
+bool list_get(List* list, Value index, Value* result) {
+    if (!check_index(list, index)) return false;
+
+    int idx = index.value.int_val;
+    *result = (Value){0};
+    result->type = list->item_type;
+    result->is_function = false;
+
+    // Copy the value based on its type
+    switch (result->type) {
+        case TYPE_INT:
+            result->value.int_val = list->items.ints[idx];
+            break;
+        case TYPE_FLOAT:
+            result->value.float_val = list->items.floats[idx];
+            break;
+        case TYPE_STRING:
+            result->value.string_val = list->items.strings[idx];
+            result->value.string_val->ref_count++;
+            result->is_object = true;
+            break;
+        case TYPE_BOOL:
+            result->value.bool_val = list->items.ints[idx];
+            break;
+        case TYPE_LONG:
+            result->value.long_val = list->items.longs[idx];
+            break;
+        case TYPE_DOUBLE:
+            result->value.double_val = list->items.doubles[idx];
+            break;
+        default:
+            output_error("Unsupported list item type\n");
+            return false;
+    }
+    return true;
+}
+
+bool list_set(List* list, Value index, Value value) {
+    if (!check_index(list, index)) return false;
+
+    // Check that the value type matches the list item type
+    if (value.type != list->item_type) {
+        output_error("Cannot assign value of type %d to list of type %d\n",
+                     value.type, list->item_type);
+        return false;
+    }
+
+    // Replace the old item
+    int idx = index.value.int_val;
+    String* old = list->item_type == TYPE_STRING ? list->items.strings[idx] : NULL;
+    store_item(list, idx, value);
+    string_release(old);
+    return true;
+}
+
+bool list_remove(List* list, Value index) {
+    if (!check_index(list, index)) return false;
+
+    int idx = index.value.int_val;
+    if (list->item_type == TYPE_STRING) {
+        string_release(list->items.strings[idx]);
+    }
+
+    // Close the gap from the side with fewer items, so removing either the
+    // first or the last item takes constant time
+    size_t size = item_size(list->item_type);
+    char* data = list->items.data;
+    if (idx < list->count / 2) {
+        memmove(data + size, data, idx * size);
+        list->items.data = data + size;
+        list->capacity--;
+        list->offset++;
+    } else {
+        memmove(data + idx * size, data + (idx + 1) * size, (list->count - idx - 1) * size);
+    }
+
+    // Shrink the list size; an empty list starts over at the front of its
+    // buffer, which also lets the next add change its item type
+    list->count--;
+    if (list->count == 0) {
+        list->items.data = list_buffer(list);
+        list->capacity += list->offset;
+        list->offset = 0;
+    }
+    return true;
+}
+
+bool list_sort(List* list, Value descending) {
+    if (descending.type != TYPE_BOOL) {
+        output_error("Sort order must be a boolean\n");
+        return false;
+    }
+
+    sort_list(list, descending.value.bool_val);
+    return true;
+}
+
+// The result is sized up front and filled in one pass
+bool list_join(List* list, Value separator, Value* result) {
+    if (list->count > 0 && list->item_type != TYPE_STRING) {
+        output_error("Can only join a list of strings\n");
+        return false;
+    }
+
+    const char* chars = value_chars(&separator);
+    int separator_length = value_length(&separator);
+    int length = list->count > 0 ? separator_length * (list->count - 1) : 0;
+    for (int i = 0; i < list->count; i++) {
+        length += list->items.strings[i]->length;
+    }
+
+    Value joined = {0};
+    joined.type = TYPE_STRING;
+    char* end = joined.value.inline_chars;
+    if (length > STRING_INLINE_MAX) {
+        joined.value.string_val = string_alloc(length);
+        joined.is_object = true;
+        end = joined.value.string_val->chars;
+    }
+    for (int i = 0; i < list->count; i++) {
+        if (i > 0) {
+            memcpy(end, chars, separator_length);
+            end += separator_length;
+        }
+        memcpy(end, list->items.strings[i]->chars, list->items.strings[i]->length);
+        end += list->items.strings[i]->length;
+    }
+
+    *result = joined;
+    return true;
+}
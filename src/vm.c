@@ -0,0 +1,597 @@
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "headers/vm.h"
+#include "headers/native.h"
+
+// Calls shown at each end of a stack trace
+#define TRACE_FRAMES 10
+
+static void reset_stack(VM* vm) {
+    while (vm->stack_top > vm->stack) {
+        value_release(--vm->stack_top);
+    }
+    vm->frame_count = 0;
+}
+
+// Report the call stack of the failing instruction and unwind
+static void report_location(VM* vm) {
+    for (int i = vm->frame_count - 1; i >= 0; i--) {
+        // Deep recursion only shows the innermost and outermost calls
+        if (vm->frame_count > 2 * TRACE_FRAMES && i == vm->frame_count - 1 - TRACE_FRAMES) {
+            output_error("... %d more calls\n", vm->frame_count - 2 * TRACE_FRAMES);
+            i = TRACE_FRAMES;
+            continue;
+        }
+
+        CallFrame* frame = &vm->frames[i];
+        Function* function = frame->function;
+        size_t instruction = frame->ip - function->chunk.code - 1;
+        output_error("[line %d] in %s()\n", function->chunk.lines[instruction], function->name);
+    }
+
+    vm->had_error = true;
+    reset_stack(vm);
+}
+
+static void runtime_error(VM* vm, const char* format, ...) {
+    va_list args;
+    va_start(args, format);
+    output_verror(format, args);
+    va_end(args);
+    fputs("\n", stderr);
+
+    report_location(vm);
+}
+
+// Assignment semantics of environment_assign in the tree walker
+static void assign_value(Value* target, Value value, const char* name) {
+    if (target->type != value.type && !value.is_function) {
+        output_error("Type mismatch in assignment to '%s'\n", name);
+        return;
+    }
+
+    value_release(target);
+    target->is_constant = false;
+    target->is_object = false;
+    if (value.is_function) {
+        target->is_function = true;
+        target->value.function = value.value.function;
+    } else {
+        target->is_function = false;
+        target->value = value_copy(value).value;
+        target->is_constant = value.is_constant;
+        target->is_object = value.is_object;
+    }
+}
+
+// Run a builtin on the arguments at the top of the stack and replace the
+// callee and arguments with its result
+static bool call_native(VM* vm, const Native* native, int arg_count) {
+    Value* args = vm->stack_top - arg_count;
+    Value result;
+    bool ok = native_call(native, vm->output, args, arg_count, &result);
+
+    while (vm->stack_top > args) {
+        value_release(--vm->stack_top);
+    }
+    if (!ok) {
+        report_location(vm);
+        return false;
+    }
+
+    vm->stack_top[-1] = result;
+    return true;
+}
+
+// Make room for one more frame and for needed value slots above the stack
+// top. Frames point into the value stack, so they are moved along with it.
+static void grow_stacks(VM* vm, size_t needed) {
+    if (vm->frame_count == vm->frame_capacity) {
+        vm->frame_capacity *= 2;
+        if (vm->frame_capacity > vm->max_stack) vm->frame_capacity = vm->max_stack;
+        vm->frames = realloc(vm->frames, sizeof(CallFrame) * vm->frame_capacity);
+    }
+
+    size_t used = (size_t)(vm->stack_top - vm->stack);
+    if (used + needed <= vm->stack_capacity) return;
+
+    size_t capacity = vm->stack_capacity * 2;
+    while (capacity < used + needed) capacity *= 2;
+    Value* stack = realloc(vm->stack, sizeof(Value) * capacity);
+    for (int i = 0; i < vm->frame_count; i++) {
+        vm->frames[i].slots = stack + (vm->frames[i].slots - vm->stack);
+    }
+    vm->stack = stack;
+    vm->stack_top = stack + used;
+    vm->stack_capacity = capacity;
+}
+
+static bool call_function(VM* vm, Value* callee, int arg_count) {
+    if (callee->is_function && callee->value.function->native != NULL) {
+        return call_native(vm, callee->value.function->native, arg_count);
+    }
+    if (!callee->is_function || callee->value.function->compiled == NULL) {
+        runtime_error(vm, "Can only call functions");
+        return false;
+    }
+
+    Function* function = callee->value.function->compiled;
+    if (arg_count != function->arity) {
+        runtime_error(vm, "Expected %d arguments but got %d", function->arity, arg_count);
+        return false;
+    }
+
+    if (vm->frame_count == vm->max_stack) {
+        runtime_error(vm, "Stack overflow");
+        return false;
+    }
+    grow_stacks(vm, function->slot_count - arg_count + FRAME_HEADROOM);
+
+    Value* slots = vm->stack_top - arg_count;
+    for (int i = 0; i < arg_count; i++) {
+        if (!slots[i].is_function && !value_coerce(function->param_types[i], &slots[i])) {
+            runtime_error(vm, "Type mismatch in argument %d of '%s'", i + 1, function->name);
+            return false;
+        }
+    }
+
+    // Locals start out as zeroed ints, which own nothing
+    memset(slots + arg_count, 0, sizeof(Value) * (function->slot_count - arg_count));
+    vm->stack_top = slots + function->slot_count;
+
+    CallFrame* frame = &vm->frames[vm->frame_count++];
+    frame->function = function;
+    frame->ip = function->chunk.code;
+    frame->slots = slots;
+    return true;
+}
+
+// A tail call can take over the caller's frame when it calls compiled code
+// that accepts the arguments. Natives and calls that fail go through the
+// frame as usual, so errors still point at the call.
+static bool reuses_frame(Value* callee, int arg_count) {
+    if (!callee->is_function || callee->value.function->compiled == NULL) return false;
+
+    Function* function = callee->value.function->compiled;
+    if (arg_count != function->arity) return false;
+    for (int i = 0; i < arg_count; i++) {
+        Value* arg = callee + 1 + i;
+        if (!arg->is_function && !value_coerce(function->param_types[i], arg)) return false;
+    }
+    return true;
+}
+
+static bool binary_slow(VM* vm, TokenType op) {
+    Value right = *--vm->stack_top;
+    Value left = *--vm->stack_top;
+    Value result;
+    bool ok = value_binary(op, left, right, &result);
+    value_release(&left);
+    value_release(&right);
+    if (!ok) return false;
+
+    *vm->stack_top++ = result;
+    return true;
+}
+
+// Add the count values at the top of the stack to the one below them, in
+// order, leaving the sum
+static bool add_operands(VM* vm, int count) {
+    Value* operands = vm->stack_top - count - 1;
+    for (int i = 1; i <= count; i++) {
+        if (operands[0].type == TYPE_INT && operands[i].type == TYPE_INT) {
+            operands[0].value.int_val += operands[i].value.int_val;
+            continue;
+        }
+        Value sum;
+        bool ok = value_binary(TOKEN_PLUS, operands[0], operands[i], &sum);
+        value_release(&operands[0]);
+        value_release(&operands[i]);
+        if (!ok) {
+            for (int j = i + 1; j <= count; j++) {
+                value_release(&operands[j]);
+            }
+            vm->stack_top = operands;
+            return false;
+        }
+        operands[0] = sum;
+    }
+    vm->stack_top = operands + 1;
+    return true;
+}
+
+// undefined names the target if it is a global that is not defined yet
+static bool check_list(Value* target, const char* undefined, const char* message) {
+    if (undefined != NULL) {
+        output_error("Undefined variable '%s'\n", undefined);
+        return false;
+    }
+    if (target->type != TYPE_LIST || target->is_function) {
+        output_error("%s\n", message);
+        return false;
+    }
+    return true;
+}
+
+static bool run(VM* vm) {
+    CallFrame* frame = &vm->frames[vm->frame_count - 1];
+    uint8_t* ip = frame->ip;
+    Value* slots = frame->slots;
+    Value* constants = frame->function->chunk.constants;
+
+#define READ_BYTE() (*ip++)
+#define READ_SHORT() (ip += 2, (uint16_t)((ip[-2] << 8) | ip[-1]))
+#define PUSH(value) (*vm->stack_top++ = (value))
+#define POP() (*--vm->stack_top)
+#define PEEK(distance) (vm->stack_top[-1 - (distance)])
+#define SAVE_FRAME() (frame->ip = ip)
+#define LOAD_FRAME() \
+    do { \
+        frame = &vm->frames[vm->frame_count - 1]; \
+        ip = frame->ip; \
+        slots = frame->slots; \
+        constants = frame->function->chunk.constants; \
+    } while (0)
+#define FAIL() do { SAVE_FRAME(); report_location(vm); return false; } while (0)
+#define ERROR(...) do { SAVE_FRAME(); runtime_error(vm, __VA_ARGS__); return false; } while (0)
+// Integer operands take the inline fast path, everything else the shared semantics
+#define BINARY_OP(token, int_expr) \
+    do { \
+        Value* a = &PEEK(1); \
+        Value* b = &PEEK(0); \
+        if (a->type == TYPE_INT && b->type == TYPE_INT) { \
+            int x = a->value.int_val; \
+            int y = b->value.int_val; \
+            a->value.int_val = (int_expr); \
+            vm->stack_top--; \
+        } else if (!binary_slow(vm, token)) { \
+            FAIL(); \
+        } \
+    } while (0)
+#define READ_REF(target, undefined) \
+    do { \
+        uint8_t is_global = READ_BYTE(); \
+        uint16_t index = READ_SHORT(); \
+        target = is_global ? &vm->globals[index] : &slots[index]; \
+        undefined = is_global && !vm->defined[index] ? vm->global_names[index] : NULL; \
+    } while (0)
+
+    for (;;) {
+        switch (READ_BYTE()) {
+            case OP_CONSTANT:
+                PUSH(value_copy(constants[READ_SHORT()]));
+                break;
+            case OP_DEFAULT:
+                PUSH(value_default((DataType)READ_BYTE()));
+                break;
+            case OP_POP:
+                value_release(--vm->stack_top);
+                break;
+            case OP_GET_LOCAL:
+                PUSH(value_copy(slots[READ_BYTE()]));
+                break;
+            case OP_SET_LOCAL: {
+                uint8_t slot = READ_BYTE();
+                assign_value(&slots[slot], PEEK(0), frame->function->slot_names[slot]);
+                break;
+            }
+            case OP_DEFINE_LOCAL: {
+                Value* target = &slots[READ_BYTE()];
+                DataType type = (DataType)READ_BYTE();
+                Value value = POP();
+                if (!value.is_function && !value_coerce(type, &value)) {
+                    value_release(&value);
+                    ERROR("Type mismatch in variable initialization");
+                }
+                value_release(target);
+                *target = value;
+                break;
+            }
+            case OP_GET_GLOBAL: {
+                uint16_t index = READ_SHORT();
+                if (!vm->defined[index]) {
+                    ERROR("Undefined variable '%s'", vm->global_names[index]);
+                }
+                PUSH(value_copy(vm->globals[index]));
+                break;
+            }
+            case OP_SET_GLOBAL: {
+                uint16_t index = READ_SHORT();
+                if (!vm->defined[index]) {
+                    ERROR("Undefined variable '%s'", vm->global_names[index]);
+                }
+                assign_value(&vm->globals[index], PEEK(0), vm->global_names[index]);
+                break;
+            }
+            case OP_DEFINE_GLOBAL: {
+                uint16_t index = READ_SHORT();
+                DataType type = (DataType)READ_BYTE();
+                Value value = POP();
+                if (!value.is_function && !value_coerce(type, &value)) {
+                    value_release(&value);
+                    ERROR("Type mismatch in variable initialization");
+                }
+                Value* global = &vm->globals[index];
+                value_release(global);
+                *global = value;
+                vm->defined[index] = true;
+                break;
+            }
+            case OP_ADD:           BINARY_OP(TOKEN_PLUS, x + y); break;
+            case OP_SUBTRACT:      BINARY_OP(TOKEN_MINUS, x - y); break;
+            case OP_MULTIPLY:      BINARY_OP(TOKEN_MULTIPLY, x * y); break;
+            case OP_EQUAL:         BINARY_OP(TOKEN_EQUALS, x == y); break;
+            case OP_NOT_EQUAL:     BINARY_OP(TOKEN_NOT_EQUALS, x != y); break;
+            case OP_LESS:          BINARY_OP(TOKEN_LESS, x < y); break;
+            case OP_LESS_EQUAL:    BINARY_OP(TOKEN_LESS_EQUAL, x <= y); break;
+            case OP_GREATER:       BINARY_OP(TOKEN_GREATER, x > y); break;
+            case OP_GREATER_EQUAL: BINARY_OP(TOKEN_GREATER_EQUAL, x >= y); break;
+            case OP_DIVIDE:
+                // Division by zero is reported by the shared semantics
+                if (PEEK(0).type == TYPE_INT && PEEK(0).value.int_val == 0) {
+                    if (!binary_slow(vm, TOKEN_DIVIDE)) FAIL();
+                    break;
+                }
+                BINARY_OP(TOKEN_DIVIDE, x / y);
+                break;
+            case OP_MODULO:
+                if (PEEK(0).type == TYPE_INT && PEEK(0).value.int_val == 0) {
+                    if (!binary_slow(vm, TOKEN_MODULO)) FAIL();
+                    break;
+                }
+                BINARY_OP(TOKEN_MODULO, x % y);
+                break;
+            case OP_NEGATE: {
+                Value* operand = &PEEK(0);
+                if (operand->type == TYPE_INT) {
+                    operand->value.int_val = -operand->value.int_val;
+                } else {
+                    Value result;
+                    value_negate(*operand, &result);
+                    value_release(operand);
+                    *operand = result;
+                }
+                break;
+            }
+            case OP_JUMP: {
+                uint16_t offset = READ_SHORT();
+                ip += offset;
+                break;
+            }
+            case OP_JUMP_IF_FALSE: {
+                uint16_t offset = READ_SHORT();
+                Value condition = POP();
+                bool is_true;
+                if (condition.type == TYPE_INT) {
+                    is_true = condition.value.int_val != 0;
+                } else if (!value_is_truthy(condition, &is_true)) {
+                    value_release(&condition);
+                    ERROR("Condition must be an integer or boolean");
+                }
+                if (!is_true) ip += offset;
+                break;
+            }
+            case OP_LOOP: {
+                uint16_t offset = READ_SHORT();
+                ip -= offset;
+                break;
+            }
+            case OP_CALL: {
+                int arg_count = READ_BYTE();
+                SAVE_FRAME();
+                if (!call_function(vm, &PEEK(arg_count), arg_count)) return false;
+                LOAD_FRAME();
+                break;
+            }
+            case OP_TAIL_CALL: {
+                int arg_count = READ_BYTE();
+                SAVE_FRAME();
+                Value* callee = &PEEK(arg_count);
+                if (reuses_frame(callee, arg_count)) {
+                    // Release the caller's locals and move the callee and its
+                    // arguments down over them
+                    for (int i = 0; i < frame->function->slot_count; i++) {
+                        value_release(&slots[i]);
+                    }
+                    memmove(slots - 1, callee, sizeof(Value) * (arg_count + 1));
+                    vm->stack_top = slots + arg_count;
+                    vm->frame_count--;
+                }
+                if (!call_function(vm, &PEEK(arg_count), arg_count)) return false;
+                LOAD_FRAME();
+                break;
+            }
+            case OP_RETURN: {
+                Value result = POP();
+                for (int i = 0; i < frame->function->slot_count; i++) {
+                    value_release(&slots[i]);
+                }
+
+                vm->frame_count--;
+                if (vm->frame_count == 0) {
+                    value_release(&result);
+                    vm->stack_top = vm->stack;
+                    return true;
+                }
+
+                // The callee slot below the arguments receives the result
+                vm->stack_top = slots - 1;
+                PUSH(result);
+                LOAD_FRAME();
+                break;
+            }
+            case OP_GET_INDEX: {
+                Value* list;
+                const char* undefined;
+                READ_REF(list, undefined);
+                if (!check_list(list, undefined, "Cannot access index on a non-list value")) FAIL();
+                Value index = POP();
+                Value result;
+                if (!list_get(list->value.list_val, index, &result)) FAIL();
+                PUSH(result);
+                break;
+            }
+            case OP_SET_INDEX: {
+                Value* list;
+                const char* undefined;
+                READ_REF(list, undefined);
+                if (!check_list(list, undefined, "Cannot assign to index of non-list value")) FAIL();
+                Value value = POP();
+                Value index = POP();
+                if (!list_set(list->value.list_val, index, value)) {
+                    value_release(&value);
+                    FAIL();
+                }
+                PUSH(value);
+                break;
+            }
+            case OP_LIST_ADD: {
+                Value* list;
+                const char* undefined;
+                READ_REF(list, undefined);
+                if (!check_list(list, undefined, "Cannot call method on a non-list value")) FAIL();
+                Value item = POP();
+                bool ok = list_append(list->value.list_val, item);
+                value_release(&item);
+                if (!ok) FAIL();
+                PUSH(value_default(TYPE_VOID));
+                break;
+            }
+            case OP_LIST_REMOVE: {
+                Value* list;
+                const char* undefined;
+                READ_REF(list, undefined);
+                if (!check_list(list, undefined, "Cannot call method on a non-list value")) FAIL();
+                Value index = POP();
+                if (!list_remove(list->value.list_val, index)) FAIL();
+                PUSH(value_default(TYPE_VOID));
+                break;
+            }
+            case OP_LIST_RESERVE: {
+                Value* list;
+                const char* undefined;
+                READ_REF(list, undefined);
+                if (!check_list(list, undefined, "Cannot call method on a non-list value")) FAIL();
+                Value capacity = POP();
+                if (!list_reserve(list->value.list_val, capacity)) FAIL();
+                PUSH(value_default(TYPE_VOID));
+                break;
+            }
+            case OP_LIST_SORT: {
+                Value* list;
+                const char* undefined;
+                READ_REF(list, undefined);
+                if (!check_list(list, undefined, "Cannot call method on a non-list value")) FAIL();
+                Value descending = POP();
+                if (!list_sort(list->value.list_val, descending)) FAIL();
+                PUSH(value_default(TYPE_VOID));
+                break;
+            }
+            case OP_LIST_LENGTH: {
+                Value* list;
+                const char* undefined;
+                READ_REF(list, undefined);
+                if (!check_list(list, undefined, "Cannot access property on a non-list value")) FAIL();
+                Value length = {0};
+                length.type = TYPE_INT;
+                length.value.int_val = list->value.list_val->count;
+                PUSH(length);
+                break;
+            }
+            case OP_APPEND: {
+                uint8_t is_global = READ_BYTE();
+                uint16_t index = READ_SHORT();
+                uint8_t count = READ_BYTE();
+                Value* target = is_global ? &vm->globals[index] : &slots[index];
+                Value* operands = vm->stack_top - count - 1;
+                if (value_append(target, operands[0], operands + 1, count)) {
+                    vm->stack_top = operands;
+                    PUSH(value_copy(*target));
+                    break;
+                }
+                // Anything else adds and assigns as OP_ADD and a set would
+                if (count == 1) {
+                    BINARY_OP(TOKEN_PLUS, x + y);
+                } else if (!add_operands(vm, count)) {
+                    FAIL();
+                }
+                const char* name = is_global ? vm->global_names[index] : frame->function->slot_names[index];
+                assign_value(target, PEEK(0), name);
+                break;
+            }
+            default:
+                ERROR("Unknown opcode %d", ip[-1]);
+        }
+    }
+
+#undef READ_BYTE
+#undef READ_SHORT
+#undef PUSH
+#undef POP
+#undef PEEK
+#undef SAVE_FRAME
+#undef LOAD_FRAME
+#undef FAIL
+#undef ERROR
+#undef BINARY_OP
+#undef READ_REF
+}
+
+void vm_init(VM* vm, Output* output, int max_stack) {
+    vm->max_stack = max_stack;
+    vm->frame_capacity = max_stack < FRAMES_INITIAL ? max_stack : FRAMES_INITIAL;
+    vm->frames = malloc(sizeof(CallFrame) * vm->frame_capacity);
+    vm->frame_count = 0;
+    vm->stack_capacity = (size_t)FRAMES_INITIAL * FRAME_HEADROOM;
+    vm->stack = malloc(sizeof(Value) * vm->stack_capacity);
+    vm->stack_top = vm->stack;
+    vm->globals = NULL;
+    vm->defined = NULL;
+    vm->global_count = 0;
+    vm->global_names = NULL;
+    vm->output = output;
+    vm->had_error = false;
+}
+
+void vm_interpret(VM* vm, Program* program) {
+    vm->global_count = program->global_count;
+    vm->global_names = program->global_names;
+    vm->globals = calloc(program->global_count > 0 ? program->global_count : 1, sizeof(Value));
+    vm->defined = calloc(program->global_count > 0 ? program->global_count : 1, sizeof(bool));
+
+    // Globals that name a builtin start out bound to it
+    for (int i = 0; i < program->global_count; i++) {
+        const Native* native = native_lookup(program->global_names[i]);
+        if (native != NULL) {
+            vm->globals[i] = native_value(native);
+            vm->defined[i] = true;
+        }
+    }
+
+    // The script runs as a zero-argument call of itself
+    Value script = {0};
+    script.type = TYPE_VOID;
+    script.is_function = true;
+    script.value.function = &program->script->callable;
+    *vm->stack_top++ = script;
+
+    if (!call_function(vm, &vm->stack_top[-1], 0)) return;
+    run(vm);
+}
+
+void vm_cleanup(VM* vm) {
+    reset_stack(vm);
+    for (int i = 0; i < vm->global_count; i++) {
+        value_release(&vm->globals[i]);
+    }
+    free(vm->globals);
+    free(vm->defined);
+    free(vm->stack);
+    free(vm->frames);
+    vm->globals = NULL;
+    vm->stack = NULL;
+    vm->frames = NULL;
+    vm->stack_top = NULL;
+}